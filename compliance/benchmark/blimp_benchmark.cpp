@@ -0,0 +1,282 @@
+// Microbenchmarks of the native hot paths: the blimp_equality scan in each of its variants, and the native bank
+// engine (compliance/native) the Python simulator runs its TRAs, bit sliced layouts and hitmap decoding on.
+//
+// The equality scan is swept over the study shapes (1KB to 16KB row buffers, record sizes from a packed 8 byte
+// PI/Key column up to 4KB records spanning rows, PI widths up to 32 byte composite keys and selectivities) on a
+// 32MB bank, and reported for the
+// runtime parameterized (scalar) scan, the SWAR and SIMD kernels of the specialized scan, and the threaded scan,
+// as records/s (items_per_second), bank bytes covered per second (bytes_per_second) and reference cycles per
+// record (cycles_per_record, the TSC on x86). Scans collect the matching indexes, as --indexes does, so their cost
+// follows the selectivity.
+//
+// Build from this directory against Google Benchmark, with the flags the tools are built with:
+//     g++ -O3 -march=native -pthread -o blimp_benchmark blimp_benchmark.cpp ../native/blimp_bank.cpp -lbenchmark
+// and pick benchmarks with --benchmark_filter, e.g. --benchmark_filter='EqualityScan/simd/row_buffer:8192'
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define BLIMP_EQUALITY_NO_MAIN
+#include "../blimp_equality/blimp_equality.cpp"
+
+// The native bank engine, see compliance/native/blimp_bank.cpp
+extern "C" {
+void* blimp_bank_create(int rows, int row_buffer_bytes, int default_byte);
+void blimp_bank_destroy(void* bank);
+uint8_t* blimp_bank_data(void* bank);
+void blimp_bank_tra_rows(void* bank, int row_index_a, int row_index_b, int row_index_c, int invert);
+void blimp_bank_bit_slice_column(void* bank, const uint8_t* column, long long count, int width, int first_row,
+                                 int rows);
+long long blimp_decode_hitmap(const uint8_t* hitmap, long long bits, int* indexes);
+}
+
+// Bank size of the equality sweep, that of the 32mb_* studies
+const long long BENCHMARK_BANK_BYTES = 32LL * 1024 * 1024;
+// The PI/Key size of the swept records, the PI width sweeps the part of it a predicate compares; wider PIs are the
+// whole PI/Key
+const int BENCHMARK_INDEX_BYTES = 8;
+
+// The scan variants; scalar is EqualityScan<0, 0, 0, 0>, which reads its geometry from the runtime layout and
+// serves every layout without a specialization, the others run the specialization select_scan picks, if any
+enum ScanVariant { SCALAR_SCAN, SWAR_SCAN, SIMD_SCAN, THREADED_SCAN };
+const char* variant_names[] = {"scalar", "swar", "simd", "threaded"};
+
+inline uint64_t reference_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Deterministic filler for benchmark data
+struct XorShift {
+    uint64_t state;
+    explicit XorShift(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+// A horizontal layout, a BLIMP code region of two rows followed by as many records as fit the bank next to their
+// three hitmaps, as BlimpBankLayoutConfiguration lays out a study of the same shape
+LayoutConfiguration benchmark_layout(int row_buffer_bytes, int record_bytes, int index_bytes) {
+    LayoutConfiguration layout;
+    layout.bank_size_bytes = BENCHMARK_BANK_BYTES;
+    layout.row_buffer_size_bytes = row_buffer_bytes;
+    layout.bank_rows = (int)(BENCHMARK_BANK_BYTES / row_buffer_bytes);
+    layout.hitmap_count = 3;
+    layout.total_index_size_bytes = index_bytes;
+    layout.total_record_size_bytes = record_bytes;
+    layout.total_data_size_bytes = record_bytes - index_bytes;
+    layout.stored_record_size_bytes = record_bytes;
+    layout.pi_field_base_row = 2;
+    layout.record_base_row = 2;
+
+    long long records_per_hitmap_row = row_buffer_bytes * 8LL;
+    int available_rows = layout.bank_rows - layout.record_base_row;
+    for (int record_rows = available_rows; record_rows > 0; record_rows--) {
+        long long records = layout.records_per_row() > 0 ? (long long) record_rows * layout.records_per_row()
+                                                         : record_rows / layout.rows_per_record();
+        int rows_per_hitmap = (int)((records + records_per_hitmap_row - 1) / records_per_hitmap_row);
+        if (record_rows + layout.hitmap_count * rows_per_hitmap <= available_rows) {
+            layout.total_rows_for_records = record_rows;
+            layout.total_rows_for_hitmaps = layout.hitmap_count * rows_per_hitmap;
+            layout.total_records_processable = (int) records;
+            break;
+        }
+    }
+    layout.hitmap_base_row = layout.record_base_row + layout.total_rows_for_records;
+    return layout;
+}
+
+// Lay out random records into the bank, `selectivity_percent` of them matching the predicate on their first
+// `pi_bytes` PI/Key bytes, and target hitmap 0 with it. The bank is only rebuilt when the shape changes, so the
+// variants of one shape (registered one after another) share it
+void set_up_equality(int row_buffer_bytes, int record_bytes, int pi_bytes, int selectivity_percent) {
+    static std::string current_shape;
+    std::ostringstream shape;
+    shape << row_buffer_bytes << "/" << record_bytes << "/" << pi_bytes << "/" << selectivity_percent;
+    if (shape.str() == current_shape) {
+        return;
+    }
+    current_shape = shape.str();
+
+    layout = benchmark_layout(row_buffer_bytes, record_bytes, max(BENCHMARK_INDEX_BYTES, pi_bytes));
+    memory.allocate(layout.bank_rows, layout.row_buffer_size_bytes);
+    XorShift random(row_buffer_bytes ^ record_bytes << 16 ^ (uint64_t) pi_bytes << 32);
+    for (int row = layout.key_base_row(); row < layout.hitmap_base_row; row++) {
+        uint8_t* bytes = memory_row(row);
+        for (int byte = 0; byte + 8 <= layout.row_buffer_size_bytes; byte += 8) {
+            uint64_t word = random.next();
+            memcpy(bytes + byte, &word, 8);
+        }
+    }
+
+    EqualityQuery query;
+    query.pi_element_size_bytes = pi_bytes;
+    query.value.assign(pi_bytes, 0x5A);
+    query.hitmap_index = 0;
+    query.write_hitmap = true;
+    for (int record = 0; record < layout.total_records_processable; record++) {
+        int records_per_row = layout.keys_per_row();
+        uint8_t* pi = records_per_row > 0
+            ? memory_row(layout.key_row(record)) + record % records_per_row * layout.key_stride_bytes()
+            : memory_row(layout.key_row(record));
+        if ((int)(random.next() % 100) < selectivity_percent) {
+            memcpy(pi, &query.value[0], pi_bytes);
+        }
+        else if (memcmp(pi, &query.value[0], pi_bytes) == 0) {
+            pi[0] ^= 1;
+        }
+    }
+    memset(memory_row(layout.hitmap_base_row), 0xFF,
+           (size_t) layout.total_rows_for_hitmaps * layout.row_buffer_size_bytes);
+
+    queries.assign(1, query);
+    pack_value(queries[0]);
+}
+
+void BM_EqualityScan(benchmark::State& state, ScanVariant variant, int row_buffer_bytes, int record_bytes,
+                     int pi_bytes, int selectivity_percent) {
+    set_up_equality(row_buffer_bytes, record_bytes, pi_bytes, selectivity_percent);
+    pack_value(queries[0]);
+    if (variant == SCALAR_SCAN || variant == SWAR_SCAN) {
+        queries[0].sew = 0;
+    }
+    else if (variant == SIMD_SCAN && queries[0].sew == 0) {
+        state.SkipWithError("no SIMD engine serves this PI width in this build");
+        return;
+    }
+    scan_function scan = variant == SCALAR_SCAN ? EqualityScan<0, 0, 0, 0>::scan : select_scan();
+    int threads = variant == THREADED_SCAN ? 0 : 1;
+
+    long long hits = 0;
+    uint64_t cycles_spent = 0;
+    for (auto _ : state) {
+        std::vector<std::vector<int> > indexes(1);
+        CycleCounters counters;
+        uint64_t start = reference_cycles();
+        run_scan(scan, threads, &indexes, counters);
+        cycles_spent += reference_cycles() - start;
+        hits = (long long) indexes[0].size();
+        benchmark::DoNotOptimize(indexes[0].data());
+    }
+
+    long long records = (long long) state.iterations() * layout.total_records_processable;
+    state.SetItemsProcessed(records);
+    state.SetBytesProcessed(records * layout.key_stride_bytes());
+    state.counters["hits"] = (double) hits;
+    state.counters["records"] = layout.total_records_processable;
+    if (cycles_spent && records) {
+        state.counters["cycles_per_record"] = (double) cycles_spent / records;
+    }
+}
+
+void register_equality_benchmarks() {
+    const int row_buffers[] = {1024, 2048, 4096, 8192, 16384};
+    const int record_sizes[] = {8, 64, 512, 2048, 4096};
+    const int pi_widths[] = {1, 2, 4, 8, 16, 32};
+    const int selectivities[] = {0, 1, 50};
+    for (int row_buffer : row_buffers) {
+        for (int record : record_sizes) {
+            for (int pi : pi_widths) {
+                if (pi > record) {
+                    continue;
+                }
+                for (int selectivity : selectivities) {
+                    for (int variant = SCALAR_SCAN; variant <= THREADED_SCAN; variant++) {
+                        std::ostringstream name;
+                        name << "EqualityScan/" << variant_names[variant] << "/row_buffer:" << row_buffer
+                             << "/record:" << record << "/pi:" << pi << "/selectivity:" << selectivity;
+                        benchmark::RegisterBenchmark(name.str().c_str(), BM_EqualityScan, (ScanVariant) variant,
+                                                     row_buffer, record, pi, selectivity)
+                            ->Unit(benchmark::kMillisecond)
+                            ->UseRealTime();
+                    }
+                }
+            }
+        }
+    }
+}
+
+// An Ambit TRA over three rows of a row buffer, as AmbitBank.tra_rows runs it through the native engine
+void BM_TraRows(benchmark::State& state) {
+    int row_buffer_bytes = (int) state.range(0);
+    void* bank = blimp_bank_create(4, row_buffer_bytes, 0);
+    XorShift random(row_buffer_bytes);
+    uint8_t* data = blimp_bank_data(bank);
+    for (int byte = 0; byte < 3 * row_buffer_bytes; byte++) {
+        data[byte] = (uint8_t) random.next();
+    }
+    for (auto _ : state) {
+        blimp_bank_tra_rows(bank, 0, 1, 2, 0);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * 3LL * row_buffer_bytes);
+    blimp_bank_destroy(bank);
+}
+BENCHMARK(BM_TraRows)->RangeMultiplier(2)->Range(1024, 16384);
+
+// Bit slicing a row buffer's worth of PI fields into their bit rows, the transpose the bit sliced layouts place
+// every PI field with instead of converting each through bitmanip
+void BM_BitSliceColumn(benchmark::State& state) {
+    int row_buffer_bytes = (int) state.range(0), width = (int) state.range(1);
+    long long count = row_buffer_bytes * 8LL;
+    std::vector<uint8_t> column((size_t)(count * width));
+    XorShift random(row_buffer_bytes ^ width);
+    for (size_t byte = 0; byte < column.size(); byte++) {
+        column[byte] = (uint8_t) random.next();
+    }
+    void* bank = blimp_bank_create(width * 8, row_buffer_bytes, 0);
+    for (auto _ : state) {
+        blimp_bank_bit_slice_column(bank, &column[0], count, width, 0, width * 8);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetBytesProcessed(state.iterations() * count * width);
+    blimp_bank_destroy(bank);
+}
+BENCHMARK(BM_BitSliceColumn)->ArgsProduct({{1024, 4096, 16384}, {1, 8}});
+
+// Decoding the indexes of a hitmap of a 32MB bank's worth of 8 byte records at a selectivity (in percent), as
+// SimulationResult.from_hitmap_byte_array decodes query results
+void BM_DecodeHitmap(benchmark::State& state) {
+    long long bits = BENCHMARK_BANK_BYTES / BENCHMARK_INDEX_BYTES;
+    int selectivity_percent = (int) state.range(0);
+    std::vector<uint8_t> hitmap((size_t)(bits / 8), 0);
+    XorShift random(selectivity_percent);
+    for (long long bit = 0; bit < bits; bit++) {
+        if ((int)(random.next() % 100) < selectivity_percent) {
+            hitmap[bit / 8] |= (uint8_t)(0x80 >> (bit % 8));
+        }
+    }
+    std::vector<int> indexes((size_t) bits);
+    long long hits = 0;
+    for (auto _ : state) {
+        hits = blimp_decode_hitmap(&hitmap[0], bits, &indexes[0]);
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations() * bits);
+    state.SetBytesProcessed(state.iterations() * bits / 8);
+    state.counters["hits"] = (double) hits;
+}
+BENCHMARK(BM_DecodeHitmap)->Arg(0)->Arg(1)->Arg(50)->Arg(100);
+
+int main(int argc, char** argv) {
+    register_equality_benchmarks();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,334 @@
+#include <iostream>
+#include <stdio.h>
+#include <random>
+#include <string.h>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+#include "../common/bank.h"
+#include "../common/bank_image.h"
+#include "../common/configuration.h"
+#include "../common/cycle_accounting.h"
+#include "../common/dram_timing.h"
+#include "../common/tool_common.h"
+#include "simd_aggregate.h"
+
+// Meta Directives
+//#define DEBUG
+//#define SCALAR  // Force the scalar kernel even if built with AVX2/AVX-512 (-mavx2, -mavx512bw, -march=native)
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+
+// Hitmap words with fewer hits than this are folded one record at a time rather than through the vector engine
+#define DENSE_WORD_HITS 8
+
+// Query Specifics; COUNT counts the records hit in a hitmap, SUM, MIN and MAX reduce an unsigned, most significant
+// byte first field of those records
+struct AggregateQuery {
+    bool count;
+    simd_aggregate::Operation operation;
+    int field_offset_bytes;
+    int field_size_bytes;
+    int hitmap_index;
+
+    // Where the field is stored, see LayoutConfiguration::field_region; the first row of its region, the stride
+    // between records and the field's offset within each
+    int region_base_row;
+    int region_stride_bytes;
+    int region_offset_bytes;
+
+    AggregateQuery() : count(false), operation(simd_aggregate::SUM), field_offset_bytes(0), field_size_bytes(0),
+                       hitmap_index(0), region_base_row(0), region_stride_bytes(0), region_offset_bytes(0) {}
+};
+
+LayoutConfiguration layout;
+AggregateQuery query;
+Bank memory;
+int number_of_valus = 1;
+int processor_bit_architecture = 64;
+// The row buffer policy and subarrays of the hardware block
+RowBufferTiming dram_timing;
+
+// Records or rows represented per row or record of the field's region, respectively
+inline int region_records_per_row() { return layout.row_buffer_size_bytes / query.region_stride_bytes; }
+inline int region_rows_per_record() { return query.region_stride_bytes / layout.row_buffer_size_bytes; }
+
+// The row holding the field of a record, located as src/queries/blimpv_aggregate.py locates it
+inline int field_row(int record_index) {
+    int records_per_row = region_records_per_row();
+    if (records_per_row <= 0) { // Multi-row per record
+        return query.region_base_row + record_index * region_rows_per_record()
+            + query.region_offset_bytes / layout.row_buffer_size_bytes;
+    }
+    // Multi-record per row
+    return query.region_base_row + record_index / records_per_row;
+}
+
+// The field of a record
+inline const uint8_t* field_of(int record_index) {
+    int records_per_row = region_records_per_row();
+    if (records_per_row <= 0) { // Multi-row per record
+        return memory_row(field_row(record_index)) + query.region_offset_bytes % layout.row_buffer_size_bytes;
+    }
+    return memory_row(field_row(record_index)) + record_index % records_per_row * query.region_stride_bytes
+        + query.region_offset_bytes;
+}
+
+// The hitmap word of the 64 records starting at `word_base`, the first record in the MSB
+inline uint64_t hitmap_word(int word_base, int count) {
+    uint64_t word = load_native(memory_row(layout.hitmap_row(query.hitmap_index)) + word_base / 8, 8);
+    return count < 64 ? word & ~(~0ULL >> count) : word;
+}
+
+// Hit each record of the targeted hitmap of a generated bank with the given probability
+void draw_hits(double selectivity) {
+    if (selectivity < 1) {
+        uint8_t* hitmap = memory_row(layout.hitmap_row(query.hitmap_index));
+        for (int record = 0; record < layout.total_records_processable; record++) {
+            if ((double) rand() / ((double) RAND_MAX + 1) >= selectivity) {
+                hitmap[record / 8] &= (uint8_t) ~(0x80 >> (record % 8));
+            }
+        }
+    }
+}
+
+// Cycle accounting, the operations src/queries/blimpv_aggregate.py issues for the same hitmap. Every record row costs
+// the same but for its hits, so only the hits of each row are taken from the hitmap
+struct AggregateCycleModel {
+    // A BLIMP-V element-wise operation over the row buffer
+    static long long alu_cycles(int sew) {
+        return 1 + (layout.row_buffer_size_bytes / sew + number_of_valus - 1) / number_of_valus;
+    }
+
+    // A BLIMP-V tree reduction (MAX or SUM) over the row buffer
+    static long long reduction_cycles(int sew) {
+        long long cycles = 1;
+        for (int pairs = layout.row_buffer_size_bytes / sew / 2; pairs > 0; pairs /= 2) {
+            cycles += (pairs + number_of_valus - 1) / number_of_valus;
+        }
+        return cycles;
+    }
+
+    static CycleCounters scan() {
+        CycleCounters counters;
+        RowBufferTiming dram = dram_timing;
+        long long records = layout.total_records_processable;
+        long long bits_per_row = (long long) layout.row_buffer_size_bytes * 8;
+        int hitmap_row = layout.hitmap_row(query.hitmap_index);
+        long long hitmap_rows = min((records + bits_per_row - 1) / bits_per_row, (long long) layout.rows_per_hitmap());
+
+        // BLIMP enable, setup, initialization and the loop start
+        counters.row_activate += 1;
+        counters.blimp_cycle += 5 + 5 + 1;
+
+        if (query.count) {
+            // Row calculation, load, a popcount per processor word and the loop return per hitmap row
+            long long words_per_row = bits_per_row / processor_bit_architecture;
+            counters.blimp_cycle += hitmap_rows * (3 + 4 * words_per_row + 2);
+            for (long long row = 0; row < hitmap_rows; row++) {
+                dram.register_transfer(counters, hitmap_row + (int) row);
+            }
+        }
+        else {
+            int sew = query.field_size_bytes;
+            int records_per_row = max(1, region_records_per_row());
+            int loaded_hitmap_row = -1;
+
+            // Every record is bit tested, every hit masked into v2, and every hitmap row loaded once, before the
+            // first record it holds
+            counters.blimp_cycle += 3 * records;
+
+            for (int first_record = 0; first_record < records; first_record += records_per_row) {
+                int last_record = min(first_record + records_per_row, (int) records);
+                int hits = 0;
+                for (int record = first_record; record < last_record; record++) {
+                    int row = hitmap_row + (int)(record / bits_per_row);
+                    if (row != loaded_hitmap_row) {
+                        dram.register_transfer(counters, row);
+                        loaded_hitmap_row = row;
+                    }
+                    const uint8_t* hitmap = memory_row(hitmap_row);
+                    hits += (hitmap[record / 8] >> (7 - record % 8)) & 1;
+                }
+
+                // Row calculation and clearing v2
+                counters.blimp_cycle += 3 + alu_cycles(sew) + 2 * hits;
+                if (!hits) {
+                    counters.blimp_cycle += 1;
+                    continue;
+                }
+
+                // Load the fields, complement them for MIN, mask, reduce and accumulate
+                dram.register_transfer(counters, field_row(first_record));
+                counters.blimp_cycle += (query.operation == simd_aggregate::MIN ? alu_cycles(sew) : 0)
+                    + alu_cycles(sew) + reduction_cycles(sew) + 3;
+            }
+        }
+
+        // The return and BLIMP disable
+        counters.blimp_cycle += 1;
+        dram.precharge_all(counters);
+        counters.row_activate += 1;
+        return counters;
+    }
+};
+
+// Fold the field of every record hit in `word` one at a time, most significant (first) record first
+uint64_t fold_word_scalar(uint64_t value, uint64_t word, int word_base) {
+    while (word) {
+        int record_index = word_base + __builtin_clzll(word);
+        word &= ~(0x8000000000000000ULL >> __builtin_clzll(word));
+        uint64_t field = load_native(field_of(record_index), query.field_size_bytes);
+        value = simd_aggregate::fold(query.operation, value, field);
+
+#ifdef DEBUG
+        std::cout << "record=" << std::dec << record_index << " field=" << std::hex << field << "\n";
+#endif // DEBUG
+    }
+    return value;
+}
+
+// Scan the hitmap 64 records at a time; return the hits, and through `value` the reduction of their fields
+long long scan(uint64_t* value) {
+    long long hits = 0;
+    uint64_t scalar = simd_aggregate::identity(query.operation);
+
+#if SIMD_EQUALITY_AVAILABLE && !defined(SCALAR) && !defined(DEBUG)
+    // The vector engine needs the fields of a word one stride apart
+    bool strided = layout.row_buffer_size_bytes % query.region_stride_bytes == 0 ||
+                   query.region_stride_bytes % layout.row_buffer_size_bytes == 0;
+    simd_aggregate::Accumulator accumulator = simd_aggregate::start(query.operation);
+#endif
+
+    for (int word_base = 0; word_base < layout.total_records_processable; word_base += 64) {
+        int records_in_word = min(64, layout.total_records_processable - word_base);
+        uint64_t word = hitmap_word(word_base, records_in_word);
+        if (!word) {
+            continue;
+        }
+        int word_hits = __builtin_popcountll(word);
+        hits += word_hits;
+        if (query.count) {
+            continue;
+        }
+#if SIMD_EQUALITY_AVAILABLE && !defined(SCALAR) && !defined(DEBUG)
+        if (strided && word_hits >= DENSE_WORD_HITS) {
+            simd_aggregate::accumulate_word(accumulator, field_of(word_base), query.region_stride_bytes,
+                                            query.field_size_bytes, word, records_in_word);
+            continue;
+        }
+#endif
+        scalar = fold_word_scalar(scalar, word, word_base);
+    }
+
+#if SIMD_EQUALITY_AVAILABLE && !defined(SCALAR) && !defined(DEBUG)
+    scalar = simd_aggregate::fold(query.operation, scalar, simd_aggregate::finish(accumulator));
+#endif
+    *value = query.count ? (uint64_t) hits : scalar;
+    return hits;
+}
+
+void usage(const char* program) {
+    print_tool_usage(program, "[--op count|sum|min|max] [--field-offset bytes] [--field-width bytes]\n"
+                     "       [--selectivity fraction]", false);
+    printf("Counts the records hit in a hitmap (count), or reduces an unsigned big-endian field of 1, 2, 4 or 8\n");
+    printf("bytes over them (sum, min, max) and prints the result as JSON. Sums wrap at 64 bits.\n");
+    printf("The field defaults to the index. A mapped image holds the hitmap left by an earlier selection query;\n");
+    printf("generated hitmaps hit each record with the probability --selectivity (default 1).\n");
+    printf("--cycles reports the operations and runtime of the equivalent BlimpVCount, BlimpVSum, BlimpVMin or\n");
+    printf("BlimpVMax simulation as JSON.\n");
+}
+
+
+
+int main(int argc, char** argv)
+{
+    ToolOptions options(false);
+    std::string op = "count";
+    double selectivity = 1;
+    int field_offset = 0, field_width = -1;
+    for (int arg = 1; arg < argc; arg++) {
+        std::string option = argv[arg];
+        if (option == "--help" || option == "-h") { usage(argv[0]); return 0; }
+        else if (arg + 1 < argc && option == "--op") { op = argv[++arg]; }
+        else if (arg + 1 < argc && option == "--field-offset") { field_offset = atoi(argv[++arg]); }
+        else if (arg + 1 < argc && option == "--field-width") { field_width = atoi(argv[++arg]); }
+        else if (arg + 1 < argc && option == "--selectivity") { selectivity = atof(argv[++arg]); }
+        else if (!options.parse(argc, argv, arg)) { usage(argv[0]); return 1; }
+    }
+
+    try {
+        layout = options.load_layout();
+        ConfigurationReader hardware(layout.hardware_json.empty() ? std::string("{}") : layout.hardware_json);
+        number_of_valus = max(1, (int) hardware.number("number_of_vALUs", 1));
+        processor_bit_architecture = max(1, (int) hardware.number("processor_bit_architecture", 64));
+        dram_timing = row_buffer_from_hardware(layout.hardware_json, layout.bank_rows);
+
+        query.count = op == "count";
+        if (op == "sum") { query.operation = simd_aggregate::SUM; }
+        else if (op == "min") { query.operation = simd_aggregate::MIN; }
+        else if (op == "max") { query.operation = simd_aggregate::MAX; }
+        else if (!query.count) {
+            throw std::runtime_error("unknown aggregate '" + op + "', expected count, sum, min or max");
+        }
+        query.field_offset_bytes = field_offset;
+        query.field_size_bytes = field_width > 0 ? field_width : min(8, layout.total_index_size_bytes);
+        query.hitmap_index = options.target_hitmap();
+
+        int width = query.field_size_bytes;
+        if (width != 1 && width != 2 && width != 4 && width != 8) {
+            throw std::runtime_error("the field must be 1, 2, 4 or 8 bytes");
+        }
+        if (field_offset < 0 || field_offset + width > layout.total_record_size_bytes) {
+            throw std::runtime_error("the field does not fit within the record");
+        }
+        layout.field_region(field_offset, query.region_base_row, query.region_stride_bytes, query.region_offset_bytes);
+        if (query.region_offset_bytes + width > query.region_stride_bytes) {
+            throw std::runtime_error("the field spans both the PI/Key column and the data of the record");
+        }
+        if (query.region_offset_bytes % width != 0 ||
+            (region_records_per_row() > 1 && query.region_stride_bytes % width != 0)) {
+            throw std::runtime_error("the field is not aligned to its size within the row");
+        }
+        if (query.hitmap_index >= layout.hitmap_count) {
+            throw std::runtime_error("the targeted hitmap is not present in this layout");
+        }
+        if (selectivity < 0 || selectivity > 1) {
+            throw std::runtime_error("the selectivity must be within [0, 1]");
+        }
+    }
+    catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    printf("Creating memory...\n");
+    try {
+        if (create_memory(Bank::storage_from_name(options.storage_name), options.image_path, options.image_offset)) {
+            draw_hits(selectivity);
+        }
+    }
+    catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    printf("Starting compliance...\n");
+    uint64_t value = 0;
+    long long hits = scan(&value);
+
+    // MIN and MAX have no value over no records
+    if (!query.count && query.operation != simd_aggregate::SUM && !hits) {
+        printf("{\"op\": \"%s\", \"hits\": %lld, \"value\": null}\n", op.c_str(), hits);
+    }
+    else {
+        printf("{\"op\": \"%s\", \"hits\": %lld, \"value\": %llu}\n", op.c_str(), hits, (unsigned long long) value);
+    }
+
+    if (options.report_cycles) {
+        print_cycle_report(stdout, AggregateCycleModel::scan(), timing_from_hardware(layout.hardware_json));
+    }
+    return 0;
+}
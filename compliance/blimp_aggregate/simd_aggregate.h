@@ -0,0 +1,118 @@
+#ifndef BLIMP_SIMD_AGGREGATE_H
+#define BLIMP_SIMD_AGGREGATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../blimp_range/simd_range.h"
+
+// BLIMP-V styled aggregation engine, the native counterpart of the tree reductions of src/queries/blimpv_aggregate.py.
+// Fields of up to 8 bytes are widened into 64-bit lanes and folded into a vector accumulator, one lane per record,
+// under the lane mask of a hitmap word; the lanes are only reduced to one value at the end of the scan. Sums wrap at
+// 64 bits, MIN and MAX compare the fields as unsigned values.
+//
+// Hitmap words are MSB aligned as everywhere else: the first record of a word is bit 63.
+namespace simd_aggregate {
+
+enum Operation { SUM, MIN, MAX };
+
+// The value folding leaves unchanged
+inline uint64_t identity(Operation operation) {
+    return operation == MIN ? ~0ULL : 0;
+}
+
+inline uint64_t fold(Operation operation, uint64_t a, uint64_t b) {
+    switch (operation) {
+        case SUM: return a + b;
+        case MIN: return a < b ? a : b;
+        default: return a > b ? a : b;
+    }
+}
+
+#if SIMD_EQUALITY_AVAILABLE
+
+using simd_equality::vector_t;
+using simd_equality::load_vector;
+
+const int LANES = SIMD_EQUALITY_VECTOR_BYTES / 8;
+
+struct Accumulator {
+    Operation operation;
+    vector_t lanes;
+};
+
+inline Accumulator start(Operation operation) {
+    Accumulator accumulator;
+    accumulator.operation = operation;
+    accumulator.lanes = simd_range::broadcast_native<8>(identity(operation));
+    return accumulator;
+}
+
+// Fold the lanes of `values` selected by the low LANES bits of `mask` into the accumulator
+inline void fold_lanes(Accumulator& accumulator, vector_t values, unsigned mask) {
+#if defined(__AVX512BW__)
+    switch (accumulator.operation) {
+        case SUM: accumulator.lanes = _mm512_mask_add_epi64(accumulator.lanes, mask, accumulator.lanes, values); break;
+        case MIN: accumulator.lanes = _mm512_mask_min_epu64(accumulator.lanes, mask, accumulator.lanes, values); break;
+        case MAX: accumulator.lanes = _mm512_mask_max_epu64(accumulator.lanes, mask, accumulator.lanes, values); break;
+    }
+#else
+    // Expand the mask bits into whole lanes; AVX2 has no unsigned 64-bit compare, so both sides are biased first
+    const __m256i bits = _mm256_set_epi64x(8, 4, 2, 1);
+    __m256i selected = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(mask), bits), bits);
+    const __m256i bias = _mm256_set1_epi64x((long long) 0x8000000000000000ULL);
+    __m256i greater = _mm256_cmpgt_epi64(_mm256_xor_si256(values, bias), _mm256_xor_si256(accumulator.lanes, bias));
+    switch (accumulator.operation) {
+        case SUM:
+            accumulator.lanes = _mm256_add_epi64(accumulator.lanes, _mm256_and_si256(values, selected));
+            break;
+        case MIN:
+            accumulator.lanes = _mm256_blendv_epi8(accumulator.lanes, values, _mm256_andnot_si256(greater, selected));
+            break;
+        case MAX:
+            accumulator.lanes = _mm256_blendv_epi8(accumulator.lanes, values, _mm256_and_si256(greater, selected));
+            break;
+    }
+#endif
+}
+
+// Fold the fields of every record hit in `word`, the fields `count` (<= 64) records one stride apart. Each field
+// lands in the low bytes of its lane, most significant byte first, and is swapped into native order
+inline void accumulate_word(Accumulator& accumulator, const uint8_t* first_field, size_t stride, int width,
+                            uint64_t word, int count) {
+    uint64_t bits = simd_equality::reverse_bits(word);
+    if (count < 64) {
+        bits &= (1ULL << count) - 1;
+    }
+    for (int base = 0; base < count; base += LANES) {
+        unsigned mask = (unsigned)(bits >> base) & ((1U << LANES) - 1);
+        if (!mask) {
+            continue;
+        }
+        uint8_t fields[SIMD_EQUALITY_VECTOR_BYTES] = {0};
+        for (int lane = 0; lane < LANES; lane++) {
+            if (mask & (1U << lane)) {
+                memcpy(fields + lane * 8 + 8 - width, first_field + (size_t)(base + lane) * stride, width);
+            }
+        }
+        fold_lanes(accumulator, simd_range::to_native<8>(load_vector(fields)), mask);
+    }
+}
+
+// Reduce the lanes of the accumulator to one value
+inline uint64_t finish(const Accumulator& accumulator) {
+    uint64_t lanes[LANES];
+    memcpy(lanes, &accumulator.lanes, sizeof(lanes));
+    uint64_t value = identity(accumulator.operation);
+    for (int lane = 0; lane < LANES; lane++) {
+        value = fold(accumulator.operation, value, lanes[lane]);
+    }
+    return value;
+}
+
+#endif // SIMD_EQUALITY_AVAILABLE
+
+} // namespace simd_aggregate
+
+#endif // BLIMP_SIMD_AGGREGATE_H
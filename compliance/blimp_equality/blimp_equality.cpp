@@ -4,208 +4,733 @@
 #include <string.h>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "../common/bank.h"
+#include "../common/bank_image.h"
+#include "../common/configuration.h"
+#include "../common/cycle_accounting.h"
+#include "../common/dram_timing.h"
+#include "../common/hitmap_writer.h"
+#include "../common/instrumentation.h"
+#include "../common/tool_common.h"
+#include "simd_equality.h"
 
 // Meta Directives
 //#define DEBUG
+//#define SCALAR  // Force the SWAR kernel even if built with AVX2/AVX-512 (-mavx2, -mavx512bw, -march=native)
 
-// Hardware Specifics
-#define BANK_SIZE_BYTES 33554432
-#define ROW_BUFFER_BYTES 1024
-#define BANK_ROWS 32768  // bank size / row buffer
-
-// Database Specifics
-#define HITMAP_COUNT 3
-#define INDEX_SIZE_BYTES 8
-#define RECORD_SIZE_BYTES 512
-#define DATA_SIZE_BYTES 504  // record size - index size
-
-// Layout Specifics
-#define ROWS_FOR_RECORDS 32220
-#define ROWS_FOR_HITMAPS 24
-#define RECORDS_PROCESSABLE 64440
-#define HITMAP_BASE_ROW 32734
-#define RECORD_BASE_ROW 514
-
-// Query Specifics
-#define PI_SUBINDEX_OFFSET_BYTES 0
-#define PI_ELEMENT_SIZE_BYTES 8
-#define _VALUE {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
-#define NEGATE 0
-#define HITMAP_INDEX 1
+// Words of 64 records ahead of the scan whose PI fields are prefetched, tunable per host (-DPREFETCH_DISTANCE_WORDS=n)
+#ifndef PREFETCH_DISTANCE_WORDS
+#define PREFETCH_DISTANCE_WORDS 2
+#endif
 
 #define min(a,b) ((a)<(b)?(a):(b))
 #define max(a,b) ((a)>(b)?(a):(b))
 
+// Query Specifics; one EQUAL/NOTEQUAL predicate of the scan, several predicates are evaluated in one pass
+struct EqualityQuery {
+    int pi_subindex_offset_bytes;
+    int pi_element_size_bytes;
+    std::vector<uint8_t> value;
+    int negate;
+    int hitmap_index;
+    bool write_hitmap;
+
+    // SWAR comparison lanes, the query value packed into native uint64_t words
+    std::vector<uint64_t> value_lanes;
+    // The SEW of the SIMD engine serving this predicate, the PI width for 16 or 32 byte keys the engine compares
+    // whole, 0 for the SWAR kernel
+    int sew;
+#if SIMD_EQUALITY_AVAILABLE
+    simd_equality::vector_t value_vector;
+#endif
+
+    EqualityQuery() : pi_subindex_offset_bytes(0), pi_element_size_bytes(0), negate(0), hitmap_index(0),
+                      write_hitmap(true), sew(0) {
+#if SIMD_EQUALITY_AVAILABLE
+        memset(&value_vector, 0, sizeof(value_vector));
+#endif
+    }
+};
+
+LayoutConfiguration layout;
+std::vector<EqualityQuery> queries;
+// BLIMP-V ALUs merging hitmap segments, from the hardware block of the layout
+int number_of_valus = 1;
+// The row buffer policy and subarrays of the hardware block, every worker models its own copy
+RowBufferTiming dram_timing;
+
+Bank memory;
+
+// Each scan worker owns its row buffer, cycle counters, row buffer timing and engine events, see start_worker
+thread_local RowBuffer rowbuffer;
+thread_local CycleCounters cycles;
+thread_local RowBufferTiming dram;
+thread_local EngineEvents engine_events;
+
+// Pack the query value for the SWAR kernel and pick the engine comparing it
+void pack_value(EqualityQuery& query) {
+    query.value_lanes.assign(query.pi_element_size_bytes / 8 + 1, 0);
+    memcpy(&query.value_lanes[0], &query.value[0], query.pi_element_size_bytes);
+
+    query.sew = 0;
+#if SIMD_EQUALITY_AVAILABLE && !defined(SCALAR) && !defined(DEBUG)
+    switch (query.pi_element_size_bytes) {
+        case 1: query.value_vector = simd_equality::broadcast<1>(&query.value[0]); query.sew = 1; break;
+        case 2: query.value_vector = simd_equality::broadcast<2>(&query.value[0]); query.sew = 2; break;
+        case 4: query.value_vector = simd_equality::broadcast<4>(&query.value[0]); query.sew = 4; break;
+        case 8: query.value_vector = simd_equality::broadcast<8>(&query.value[0]); query.sew = 8; break;
+        case 16: query.sew = 16; break;
+        case 32: query.sew = 32; break;
+    }
+#endif
+}
 
-uint8_t memory[BANK_ROWS][ROW_BUFFER_BYTES];
-uint8_t rowbuffer[ROW_BUFFER_BYTES];
-int current_row;
-uint8_t VALUE[] = _VALUE;
+// Compare a PI field against the query value one uint64_t lane at a time, return 1 if equal and 0 otherwise
+template <int PI_ELEMENT_SIZE_BYTES>
+inline uint64_t pi_equal(const uint8_t* pi, int pi_element_size_bytes, const std::vector<uint64_t>& value_lanes) {
+    const int pi_bytes = PI_ELEMENT_SIZE_BYTES ? PI_ELEMENT_SIZE_BYTES : pi_element_size_bytes;
+    const int pi_lanes = pi_bytes / 8;
+    const int pi_tail_bytes = pi_bytes % 8;
+    uint64_t difference = 0;
+    for (int lane = 0; lane < pi_lanes; lane++) {
+        uint64_t word;
+        memcpy(&word, pi + lane * 8, 8);
+        difference |= word ^ value_lanes[lane];
+    }
+    if (pi_tail_bytes > 0) {
+        uint64_t word = 0;
+        memcpy(&word, pi + pi_lanes * 8, pi_tail_bytes);
+        difference |= word ^ value_lanes[pi_lanes];
+    }
+    // Branch-free zero test, the high bit of (d | -d) is set for any non-zero d
+    return ((difference | (0 - difference)) >> 63) ^ 1;
+}
 
-uint8_t v0[ROW_BUFFER_BYTES];
+// Give the calling thread its own row buffer
+void start_worker() {
+    rowbuffer = RowBuffer();
+    cycles = CycleCounters();
+    dram = dram_timing;
+    engine_events = EngineEvents();
+}
 
-void load_row(int row_index) {
-    for (int byte = 0; byte < ROW_BUFFER_BYTES; byte++) {
-        rowbuffer[byte] = memory[row_index][byte];
+// Place a sentinel in a generated bank
+void place_sentinel() {
+    if (layout.key_end_row() - layout.key_base_row() > 10) {
+        memset(memory_row(layout.key_end_row() - 10), 0, min(8, layout.row_buffer_size_bytes));
     }
-    current_row = row_index;
 }
 
-void store_v0(int row_index) {
-    for (int byte = 0; byte < ROW_BUFFER_BYTES; byte++) {
-        memory[row_index][byte] = v0[byte];
+// Cycle accounting hook, the operations src/queries/blimp_multi_equality.py issues for the same scan (with one
+// predicate, exactly those of src/queries/blimp_equality.py). Charged per hitmap word rather than per record, so the
+// kernels stay free to compare records in any order and width.
+struct EqualityCycleModel {
+    // Bytes of v1 staging each predicate's hitmap, the row buffer split in a power of two segments
+    static int segment_bytes() {
+        int segment = layout.row_buffer_size_bytes;
+        for (size_t predicates = 1; predicates < queries.size(); predicates *= 2) {
+            segment /= 2;
+        }
+        return segment;
+    }
+
+    // The row a record's PI/Key is read from
+    static int key_row(int record_index) {
+        return layout.key_row(record_index);
+    }
+
+    // The hitmap row of a predicate the `flush`th set of segments is written back to
+    static int flush_row(const EqualityQuery& query, long long flush) {
+        return layout.hitmap_row(query.hitmap_index) + (int)(flush * segment_bytes() / layout.row_buffer_size_bytes);
+    }
+
+    // BLIMP enable, setup and initialization, up to the first loop iteration
+    static void begin(CycleCounters& counters) {
+        counters.row_activate += 1;
+        counters.blimp_cycle += 5 + 5 + 1;
+        dram.reset();
     }
-}
 
-void create_memory() {
-    for (int row = 0; row < BANK_ROWS; row++) {
-        // Utility rows
-        if (row < RECORD_BASE_ROW) {
-            for (int byte = 0; byte < ROW_BUFFER_BYTES; byte++) {
-                memory[row][byte] = 0;  // don't care
+    // Replay, uncharged, the row accesses a scan of the records before `first_record` would have made, so the rows
+    // it left open and its subarray timelines carry over and a worker starting there accounts its row accesses as a
+    // single scan of every record would; `first_record` ends a set of segments
+    static void resume(int first_record) {
+        CycleCounters replayed;
+        int loaded_row = -1;
+        begin(replayed);
+        records(replayed, 0, first_record, loaded_row);
+    }
+
+    // Every predicate's segment is written back; the whole row from v1, otherwise merged into its row through v2
+    static void flush_segments(CycleCounters& counters, long long flush) {
+        for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+            int row = flush_row(queries[predicate], flush);
+            if (segment_bytes() != layout.row_buffer_size_bytes) {
+                dram.register_transfer(counters, row);
+                counters.blimp_cycle += 1 + (segment_bytes() + number_of_valus - 1) / number_of_valus;
             }
+            dram.register_transfer(counters, row);
         }
-        // Data row generation
-        else if (row < HITMAP_BASE_ROW) {
-            for (int byte = 0; byte < ROW_BUFFER_BYTES; byte++) {
-                memory[row][byte] = (uint8_t)(rand() % 256);  // random data
+    }
+
+    // Records [first_record, first_record + count); `loaded_row` is the PI/Key row currently in the scratchpad
+    static void records(CycleCounters& counters, int first_record, int count, int& loaded_row) {
+        int last_record = first_record + count;
+        long long records_per_segment = segment_bytes() * 8LL;
+        int keys_per_row = layout.keys_per_row();
+
+        // Row, offset calculation and row check per record, sub-offset, memcmp and bookkeeping per predicate
+        long long record_cycles = 3 + 3 + 3;
+        for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+            record_cycles += 2 + 2 * queries[predicate].pi_element_size_bytes + 4;
+        }
+        counters.blimp_cycle += (long long) count * record_cycles;
+        // Hitmap bookkeeping for every completed hitmap byte of every predicate
+        counters.blimp_cycle += 4LL * queries.size() * (last_record / 8 - first_record / 8);
+
+        // Every new record (or PI/Key column) row is loaded into the scratchpad through v0 before its first record,
+        // every completed set of segments is written back after its last; in order, as the open page policy keeps
+        // the rows of one access open for the next
+        for (int record = first_record; record < last_record;) {
+            int row = key_row(record);
+            if (row != loaded_row) {
+                dram.register_transfer(counters, row);
+                loaded_row = row;
+            }
+            long long next_record = keys_per_row > 0 ? (record / keys_per_row + 1) * (long long) keys_per_row
+                                                     : record + 1LL;
+            next_record = min(next_record, (record / records_per_segment + 1) * records_per_segment);
+            next_record = min(next_record, (long long) last_record);
+            if (next_record % records_per_segment == 0) {
+                flush_segments(counters, next_record / records_per_segment - 1);
             }
+            record = (int) next_record;
         }
-        // Hitmap row generation and other utilities
-        else if (row < HITMAP_BASE_ROW + ROWS_FOR_HITMAPS) {
-            for (int byte = 0; byte < ROW_BUFFER_BYTES; byte++) {
-                memory[row][byte] = 0xFF;  // initialize all hitmaps to true
+    }
+
+    // Padding of the final segments, their write back and BLIMP disable, after `total_records` records
+    static void end(CycleCounters& counters, int total_records) {
+        long long records_per_segment = segment_bytes() * 8LL;
+        long long padded_records = (total_records + records_per_segment - 1) / records_per_segment
+            * records_per_segment;
+        counters.blimp_cycle += 1 + (long long) queries.size()
+            * (3 * (padded_records - total_records) + 4 * (padded_records / 8 - total_records / 8));
+        flush_segments(counters, padded_records / records_per_segment - 1);
+        dram.precharge_all(counters);
+        counters.row_activate += 1;
+    }
+};
+
+// Equality scan specialized over (row buffer, keys per row, rows per key, PI width); a zero parameter is read from
+// the runtime layout (or each predicate) instead, so EqualityScan<0, 0, 0, 0> serves any configuration. Keys are the
+// records, or the PI/Keys of a packed column the scan reads densely. Either several keys share a row, or a key spans
+// several rows and only its first row is read; both are the same walk with one of the two counts at 1, so no scan
+// branches on the layout inside its loops
+template <int ROW_BUFFER_BYTES, int KEYS_PER_ROW, int ROWS_PER_KEY, int PI_ELEMENT_SIZE_BYTES>
+struct EqualityScan {
+    static int row_buffer_bytes() { return ROW_BUFFER_BYTES ? ROW_BUFFER_BYTES : layout.row_buffer_size_bytes; }
+    static int keys_per_row() { return KEYS_PER_ROW ? KEYS_PER_ROW : max(1, layout.keys_per_row()); }
+    static int rows_per_key() { return ROWS_PER_KEY ? ROWS_PER_KEY : max(1, layout.rows_per_key()); }
+    // Layouts keep key strides dividing, or multiples of, the row buffer
+    static int key_stride_bytes() { return row_buffer_bytes() * rows_per_key() / keys_per_row(); }
+    static int pi_element_size_bytes(const EqualityQuery& query) {
+        return PI_ELEMENT_SIZE_BYTES ? PI_ELEMENT_SIZE_BYTES : query.pi_element_size_bytes;
+    }
+
+    // Compare `count` records starting at `word_base` against every SWAR predicate, a row of keys at a time so each
+    // row is loaded once; each predicate's MSB aligned hitmap word is set in hitwords
+    static void scan_words_swar(int word_base, int count, uint64_t* hitwords) {
+        const int keys_in_row = keys_per_row(), key_stride = key_stride_bytes();
+        for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+            hitwords[predicate] = 0;
+        }
+
+        for (int record_index = word_base; record_index < word_base + count;) {
+            // The row this record (or its packed PI/Key) starts in, and the keys of the word it holds
+            int row = layout.key_base_row() + record_index / keys_in_row * rows_per_key();
+            int first_key = record_index % keys_in_row;
+            int keys = min(keys_in_row - first_key, word_base + count - record_index);
+
+            // Fetch the row
+            if (rowbuffer.load(row)) {
+                engine_events.row_loads += 1;
+            }
+
+            const uint8_t* key = rowbuffer.bytes + first_key * key_stride;
+            for (int key_index = 0; key_index < keys; key_index++, key += key_stride) {
+                for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+                    const EqualityQuery& query = queries[predicate];
+                    if (query.sew) {
+                        continue;
+                    }
+
+                    // Perform the operation on the index and shift the result into the hitmap word
+                    const uint8_t* pi = key + query.pi_subindex_offset_bytes;
+                    uint64_t hit = pi_equal<PI_ELEMENT_SIZE_BYTES>(pi, pi_element_size_bytes(query), query.value_lanes)
+                        ^ query.negate;
+                    hitwords[predicate] = (hitwords[predicate] << 1) | hit;
+
+#ifdef DEBUG
+                    for (int z = 0; z < pi_element_size_bytes(query); z++) {
+                        std::cout << std::hex << std::setfill('0') << std::setw(2) << unsigned(pi[z]) << " ";
+                    }
+                    std::cout << " = ";
+                    for (int z = 0; z < pi_element_size_bytes(query); z++) {
+                        std::cout << std::hex << std::setfill('0') << std::setw(2) << unsigned(query.value[z]) << " ";
+                    }
+                    std::cout << "? " << (hit ? "yes" : "no") << "\nrecord=" << std::dec << record_index + key_index
+                              << "\n";
+#endif // DEBUG
+                }
             }
+            record_index += keys;
         }
-        else {
-            for (int byte = 0; byte < ROW_BUFFER_BYTES; byte++) {
-                memory[row][byte] = 0;  // everything else is null
+        if (count < 64) {
+            for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+                hitwords[predicate] <<= 64 - count;
             }
         }
     }
 
-    // Place a sentinel
-    memory[HITMAP_BASE_ROW - 10][0] = 0;
-    memory[HITMAP_BASE_ROW - 10][1] = 0;
-    memory[HITMAP_BASE_ROW - 10][2] = 0;
-    memory[HITMAP_BASE_ROW - 10][3] = 0;
-    memory[HITMAP_BASE_ROW - 10][4] = 0;
-    memory[HITMAP_BASE_ROW - 10][5] = 0;
-    memory[HITMAP_BASE_ROW - 10][6] = 0;
-    memory[HITMAP_BASE_ROW - 10][7] = 0;
-
-    // Initialize v0 to zero
-    for (int byte = 0; byte < ROW_BUFFER_BYTES; byte++) {
-        v0[byte] = 0x00;
+    // Open the rows holding the keys of records [word_base, word_base + count) in order, as scan_words_swar does,
+    // counting the row loads; the SIMD engine reads the same rows straight out of bank memory
+    static void open_word_rows(int word_base, int count) {
+        const int keys_in_row = keys_per_row();
+        int first_key_row = word_base / keys_in_row, last_key_row = (word_base + count - 1) / keys_in_row;
+        int first_row = layout.key_base_row() + first_key_row * rows_per_key();
+        engine_events.row_loads += last_key_row - first_key_row + (rowbuffer.row != first_row ? 1 : 0);
+        rowbuffer.load(layout.key_base_row() + last_key_row * rows_per_key());
     }
-    // Set the row buffer initially to row zero
-    load_row(0);
-}
 
-void dump_memory(std::string path) {
-    std::ofstream dump_file;
-    dump_file.open(path);
-    for (int row = 0; row < BANK_ROWS; row++) {
-        dump_file << std::hex << std::setfill('0') << std::setw(8) << (uint8_t) row * ROW_BUFFER_BYTES << ":  ";
-        for (int byte = 0; byte < ROW_BUFFER_BYTES; byte++) {
-            dump_file << std::hex << std::setfill('0') << std::setw(2) << unsigned(memory[row][byte]) << " ";
+#if SIMD_EQUALITY_AVAILABLE
+    // Compare `count` records starting at `word_base` with the SIMD engine directly out of bank memory
+    template <int SEW>
+    static uint64_t scan_word_simd(const EqualityQuery& query, int word_base, int count) {
+        const uint8_t* first_record = memory_row(layout.key_base_row()) + (size_t) word_base * key_stride_bytes();
+        uint64_t hitword;
+
+        if (simd_equality::packable<SEW>(key_stride_bytes(), query.pi_subindex_offset_bytes)) {
+            hitword = simd_equality::compare_packed<SEW>(
+                first_record, key_stride_bytes(), query.pi_subindex_offset_bytes, count, query.value_vector);
         }
-        dump_file << "\n";
+        else {
+            hitword = simd_equality::compare_strided<SEW>(
+                first_record + query.pi_subindex_offset_bytes, key_stride_bytes(), count, query.value_vector);
+        }
+
+        // Negate only the bits that belong to records
+        return query.negate ? hitword ^ (~0ULL << (64 - count)) : hitword;
     }
-    dump_file.close();
-}
 
+    // Compare `count` records starting at `word_base` on their whole KEY_BYTES wide PI field
+    template <int KEY_BYTES>
+    static uint64_t scan_word_wide(const EqualityQuery& query, int word_base, int count) {
+        const uint8_t* first_pi = memory_row(layout.key_base_row()) + (size_t) word_base * key_stride_bytes()
+            + query.pi_subindex_offset_bytes;
+        uint64_t hitword = simd_equality::compare_wide<KEY_BYTES>(first_pi, key_stride_bytes(), count,
+                                                                  &query.value[0]);
+        return query.negate ? hitword ^ (~0ULL << (64 - count)) : hitword;
+    }
 
-int main()
-{
-    printf("Creating memory...\n");
-    create_memory();
+    static uint64_t scan_word_simd(const EqualityQuery& query, int word_base, int count) {
+        switch (query.sew) {
+            case 1: return scan_word_simd<1>(query, word_base, count);
+            case 2: return scan_word_simd<2>(query, word_base, count);
+            case 4: return scan_word_simd<4>(query, word_base, count);
+            case 16: return scan_word_wide<16>(query, word_base, count);
+            case 32: return scan_word_wide<32>(query, word_base, count);
+            default: return scan_word_simd<8>(query, word_base, count);
+        }
+    }
+#endif // SIMD_EQUALITY_AVAILABLE
+
+    // Prefetch the cache lines holding the bytes [pi_first_byte, pi_last_byte] of the keys of records
+    // [first_record, last_record). Only keys strided across cache lines within a page are prefetched: densely packed
+    // keys are a sequential stream the hardware prefetchers already follow, and keys a page or more apart would take
+    // a page walk per prefetch on top of the one of their load
+    static void prefetch_keys(int first_record, int last_record, int pi_first_byte, int pi_last_byte) {
+        const int line_bytes = 64, page_bytes = 4096;
+        if (key_stride_bytes() <= line_bytes || key_stride_bytes() >= page_bytes) {
+            return;
+        }
+        const uint8_t* first_key = memory_row(layout.key_base_row()) + (size_t) first_record * key_stride_bytes();
+        bool spans_lines = pi_last_byte / line_bytes != pi_first_byte / line_bytes;
+        for (int record = 0; record < last_record - first_record; record++) {
+            const uint8_t* key = first_key + (size_t) record * key_stride_bytes();
+            __builtin_prefetch(key + pi_first_byte, 0, 3);
+            if (spans_lines) {
+                __builtin_prefetch(key + pi_last_byte, 0, 3);
+            }
+        }
+    }
 
-    printf("Starting compliance...\n");
-    int rows_per_hitmap = ROWS_FOR_HITMAPS / HITMAP_COUNT;
-    int targeted_hitmap_base = HITMAP_BASE_ROW + rows_per_hitmap * HITMAP_INDEX;
-    
-    int records_per_row = ROW_BUFFER_BYTES / RECORD_SIZE_BYTES;
-    int rows_per_record = RECORD_SIZE_BYTES / ROW_BUFFER_BYTES;
+    // Iterate over the records of hitmap rows [first_row, last_row) of the targeted hitmaps, 64 at a time to fill
+    // one hitmap word per predicate, streaming words into each predicate's hitmap and optionally collecting
+    // matching record indexes (one list per predicate). Predicates served by the SIMD engine compare the same 64
+    // records straight out of bank memory, the rest share one SWAR pass over the row buffer. Both read bank memory in
+    // place, so the PI fields PREFETCH_DISTANCE_WORDS words ahead are prefetched before a word is compared, and
+    // its hitmap words (streamed past the cache) are stored while those loads are in flight.
+    static void scan(int first_row, int last_row, std::vector<std::vector<int> >* indexes) {
+        long long records_per_hitmap_row = row_buffer_bytes() * 8LL;
+        int first_record = (int)(first_row * records_per_hitmap_row);
+        int last_record = (int) min(last_row * records_per_hitmap_row, (long long) layout.total_records_processable);
+        bool any_swar = false;
+        int pi_first_byte = layout.total_index_size_bytes, pi_last_byte = 0;
+        std::vector<HitmapWriter> writers;
+        for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+            const EqualityQuery& query = queries[predicate];
+            any_swar = any_swar || query.sew == 0;
+            pi_first_byte = min(pi_first_byte, query.pi_subindex_offset_bytes);
+            pi_last_byte = max(pi_last_byte, query.pi_subindex_offset_bytes + query.pi_element_size_bytes - 1);
+            writers.push_back(HitmapWriter(memory_row(layout.hitmap_row(query.hitmap_index) + first_row),
+                                           row_buffer_bytes(), first_record, query.write_hitmap,
+                                           indexes ? &(*indexes)[predicate] : NULL));
+        }
+        std::vector<uint64_t> hitwords(queries.size());
+        long long row_loads = engine_events.row_loads;
+        int loaded_row = first_record > 0 ? EqualityCycleModel::key_row(first_record - 1) : -1;
+        if (first_record == 0) {
+            EqualityCycleModel::begin(cycles);
+        }
+        else {
+            EqualityCycleModel::resume(first_record);
+        }
 
-    uint8_t bitmap = 0x0;
-    int bitdex = 0;
-    int hitdex = 0;
+        const int prefetch_records = PREFETCH_DISTANCE_WORDS * 64;
+        prefetch_keys(first_record, min(first_record + prefetch_records, last_record), pi_first_byte, pi_last_byte);
+        for (int word_base = first_record; word_base < last_record; word_base += 64) {
+            int records_in_word = min(64, last_record - word_base);
+            int prefetch_base = word_base + prefetch_records;
+            prefetch_keys(prefetch_base, min(prefetch_base + 64, last_record), pi_first_byte, pi_last_byte);
 
+            if (any_swar) {
+                scan_words_swar(word_base, records_in_word, &hitwords[0]);
+            }
+            else {
+                open_word_rows(word_base, records_in_word);
+            }
+#if SIMD_EQUALITY_AVAILABLE
+            for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+                if (queries[predicate].sew) {
+                    hitwords[predicate] = scan_word_simd(queries[predicate], word_base, records_in_word);
+                }
+            }
+#endif
 
-    // Iterate over all records
-    for (int record_index = 0; record_index < RECORDS_PROCESSABLE; record_index += 1) {
-        int row, offset = 0;
+            for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+                writers[predicate].write(hitwords[predicate], records_in_word);
+            }
+            EqualityCycleModel::records(cycles, word_base, records_in_word, loaded_row);
+        }
 
-        // Calculate the row this record starts in
-        // Calculate the offset the record starts in the row
-        
-        if (records_per_row <= 0) { // Are we dealing with multi-rows per record
-            row = RECORD_BASE_ROW + record_index * rows_per_record;
-            offset = 0;
+        // All records finished processing, pad the last row
+        double flush_started_ns = wall_clock_ns();
+        for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+            writers[predicate].finish();
+            engine_events.hitmap_flushes += queries[predicate].write_hitmap ? writers[predicate].written_rows() : 0;
         }
-        else { // Are we dealing with multi-records per row
-            row = RECORD_BASE_ROW + record_index / records_per_row;
-            offset = record_index % records_per_row * RECORD_SIZE_BYTES;
+        engine_events.hitmap_flush_ns += wall_clock_ns() - flush_started_ns;
+        if (last_record > first_record) {
+            engine_events.row_hits += last_record - first_record - (engine_events.row_loads - row_loads);
         }
-        
-        // Fetch the record
-        if (current_row != row) {
-            load_row(row);
+        if (last_record == layout.total_records_processable) {
+            EqualityCycleModel::end(cycles, last_record);
         }
+    }
+};
+
+typedef void (*scan_function)(int first_row, int last_row, std::vector<std::vector<int> >* indexes);
+
+struct ScanSpecialization {
+    int row_buffer_size_bytes;
+    int keys_per_row;
+    int rows_per_key;
+    int pi_element_size_bytes;
+    scan_function scan;
+};
+
+// Fully unrolled fast paths for the common study layouts, see studies/equal_runtime/*/configuration.json, their
+// packed 8 byte PI/Key columns, and 2KB and 4KB records spanning rows; then scans over any layout specialized only
+// to a PI width, for the SIMD widths and 16 and 32 byte composite keys. A zero field serves any layout
+const ScanSpecialization specializations[] = {
+    {1024, 2, 1, 8, EqualityScan<1024, 2, 1, 8>::scan},
+    {2048, 4, 1, 8, EqualityScan<2048, 4, 1, 8>::scan},
+    {4096, 8, 1, 8, EqualityScan<4096, 8, 1, 8>::scan},
+    {8192, 16, 1, 8, EqualityScan<8192, 16, 1, 8>::scan},
+    {16384, 32, 1, 8, EqualityScan<16384, 32, 1, 8>::scan},
+    {1024, 128, 1, 8, EqualityScan<1024, 128, 1, 8>::scan},
+    {2048, 256, 1, 8, EqualityScan<2048, 256, 1, 8>::scan},
+    {4096, 512, 1, 8, EqualityScan<4096, 512, 1, 8>::scan},
+    {8192, 1024, 1, 8, EqualityScan<8192, 1024, 1, 8>::scan},
+    {16384, 2048, 1, 8, EqualityScan<16384, 2048, 1, 8>::scan},
+    {1024, 1, 2, 8, EqualityScan<1024, 1, 2, 8>::scan},
+    {1024, 1, 4, 8, EqualityScan<1024, 1, 4, 8>::scan},
+    {2048, 1, 1, 8, EqualityScan<2048, 1, 1, 8>::scan},
+    {2048, 1, 2, 8, EqualityScan<2048, 1, 2, 8>::scan},
+    {4096, 1, 1, 8, EqualityScan<4096, 1, 1, 8>::scan},
+    {0, 0, 0, 1, EqualityScan<0, 0, 0, 1>::scan},
+    {0, 0, 0, 2, EqualityScan<0, 0, 0, 2>::scan},
+    {0, 0, 0, 4, EqualityScan<0, 0, 0, 4>::scan},
+    {0, 0, 0, 8, EqualityScan<0, 0, 0, 8>::scan},
+    {0, 0, 0, 16, EqualityScan<0, 0, 0, 16>::scan},
+    {0, 0, 0, 32, EqualityScan<0, 0, 0, 32>::scan},
+};
+
+// The first specialization serving the layout with every predicate's PI width, picked once ahead of the scan
+scan_function select_scan() {
+    for (size_t i = 0; i < sizeof(specializations) / sizeof(specializations[0]); i++) {
+        const ScanSpecialization& specialization = specializations[i];
+        bool matches = specialization.row_buffer_size_bytes == 0 || (
+            specialization.row_buffer_size_bytes == layout.row_buffer_size_bytes &&
+            specialization.keys_per_row == max(1, layout.keys_per_row()) &&
+            specialization.rows_per_key == max(1, layout.rows_per_key()));
+        for (size_t predicate = 0; matches && predicate < queries.size(); predicate++) {
+            matches = specialization.pi_element_size_bytes == queries[predicate].pi_element_size_bytes;
+        }
+        if (matches) {
+            return specialization.scan;
+        }
+    }
+    return EqualityScan<0, 0, 0, 0>::scan;
+}
 
-        // Point to the index
-        int index_sub_offset = offset + PI_SUBINDEX_OFFSET_BYTES;
-
-        // Perform the operation
-        int equal = memcmp(rowbuffer + index_sub_offset, VALUE, PI_ELEMENT_SIZE_BYTES);
+// Split the scan over `threads` workers on hitmap row boundaries. Every hitmap row covers row_buffer_size_bytes * 8
+// whole records, so workers read disjoint record ranges and write disjoint hitmap rows with no synchronization
+// beyond the final join; only the worker holding the last row pads it. With `indexes` (one list per predicate), each
+// worker collects the hits of its range and the ranges are concatenated in record order. Worker cycle counters are
+// summed into `totals`, and their engine events into `event_totals` if given.
+void run_scan(scan_function scan, int threads, std::vector<std::vector<int> >* indexes, CycleCounters& totals,
+              EngineEvents* event_totals = NULL) {
+    long long records_per_hitmap_row = layout.row_buffer_size_bytes * 8LL;
+    int hitmap_rows = (int)((layout.total_records_processable + records_per_hitmap_row - 1) / records_per_hitmap_row);
+    if (threads <= 0) {
+        threads = (int) std::thread::hardware_concurrency();
+    }
+    threads = max(1, min(threads, hitmap_rows));
+
+    if (threads == 1) {
+        start_worker();
+        scan(0, hitmap_rows, indexes);
+        totals += cycles;
+        if (event_totals) {
+            *event_totals += engine_events;
+        }
+        return;
+    }
 
-#ifdef DEBUG
-        for (int z = 0; z < PI_ELEMENT_SIZE_BYTES; z++) {
-            std::cout << std::hex << std::setfill('0') << std::setw(2) << unsigned(rowbuffer[index_sub_offset + z]) << " ";
+    std::vector<std::thread> workers;
+    std::vector<std::vector<std::vector<int> > > worker_indexes(threads,
+        std::vector<std::vector<int> >(queries.size()));
+    std::vector<CycleCounters> worker_cycles(threads);
+    std::vector<EngineEvents> worker_events(threads);
+    for (int worker = 0; worker < threads; worker++) {
+        int first_row = (int)((long long) hitmap_rows * worker / threads);
+        int last_row = (int)((long long) hitmap_rows * (worker + 1) / threads);
+        std::vector<std::vector<int> >* range_indexes = indexes ? &worker_indexes[worker] : NULL;
+        CycleCounters* range_cycles = &worker_cycles[worker];
+        EngineEvents* range_events = &worker_events[worker];
+        workers.push_back(std::thread([scan, first_row, last_row, range_indexes, range_cycles, range_events]() {
+            start_worker();
+            scan(first_row, last_row, range_indexes);
+            *range_cycles = cycles;
+            *range_events = engine_events;
+        }));
+    }
+    for (size_t worker = 0; worker < workers.size(); worker++) {
+        workers[worker].join();
+        totals += worker_cycles[worker];
+        if (event_totals) {
+            *event_totals += worker_events[worker];
         }
-        std::cout << " = ";
-        for (int z = 0; z < PI_ELEMENT_SIZE_BYTES; z++) {
-            std::cout << std::hex << std::setfill('0') << std::setw(2) << unsigned(VALUE[z]) << " ";
+        for (size_t predicate = 0; indexes && predicate < queries.size(); predicate++) {
+            (*indexes)[predicate].insert((*indexes)[predicate].end(), worker_indexes[worker][predicate].begin(),
+                                         worker_indexes[worker][predicate].end());
         }
-#endif // DEBUG
+    }
+}
+
+// Parse an offset:width:value:hitmap[:not] predicate; a zero width is the configured index size
+EqualityQuery parse_predicate(const std::string& text) {
+    std::vector<std::string> fields;
+    std::stringstream stream(text);
+    std::string field;
+    while (std::getline(stream, field, ':')) {
+        fields.push_back(field);
+    }
+    if (fields.size() < 4 || fields.size() > 5 || (fields.size() == 5 && fields[4] != "not")) {
+        throw std::runtime_error("predicate '" + text + "' is not offset:width:value:hitmap[:not]");
+    }
+    EqualityQuery predicate;
+    predicate.pi_subindex_offset_bytes = atoi(fields[0].c_str());
+    predicate.pi_element_size_bytes = atoi(fields[1].c_str()) > 0 ? atoi(fields[1].c_str())
+                                                                  : layout.total_index_size_bytes;
+    predicate.value = parse_value(fields[2], predicate.pi_element_size_bytes);
+    predicate.hitmap_index = atoi(fields[3].c_str());
+    predicate.negate = fields.size() == 5 ? 1 : 0;
+    return predicate;
+}
 
-        // Update bookeeping
-        bitmap <<= 1;
-        bitmap += equal == 0 ? 1 : 0;
-        bitdex += 1;
+void usage(const char* program) {
+    print_tool_usage(program, "[--offset bytes] [--width bytes] [--value hex] [--negate] [--threads count]\n"
+                     "       [--predicate offset:width:value:hitmap[:not]]... [--indexes-only] [--profile path]", true);
+    printf("The PI width defaults to the configured index size and the value to zero.\n");
+    printf("--predicate may be repeated to evaluate several predicates in one pass over the records, each into its\n");
+    printf("own hitmap; it replaces --offset/--width/--value/--negate/--hitmap.\n");
+    printf("--indexes-only saves the matching record indexes without writing the hitmap. With several predicates\n");
+    printf("the indexes of each are saved to path.<hitmap>.\n");
+    printf("--cycles reports the operations and runtime of the equivalent BlimpEqual (or, with several\n");
+    printf("predicates, BlimpMultiEqual) simulation as JSON.\n");
+    printf("--profile saves the wall time and hardware counters of every phase of the run, the native engine's row\n");
+    printf("loads, row hits and hitmap flushes, and the --cycles report of the modeled hardware, as JSON.\n");
+    printf("--threads splits the scan on hitmap row boundaries, 0 uses every hardware thread.\n");
+}
 
-#ifdef DEBUG
-        std::cout << "? " << (equal == 0 ? "yes" : "no") << "\nbitdex=" << bitdex << " bitmap=" << std::hex << std::setfill('0') << std::setw(2) << bitmap << "\n";
-#endif // DEBUG
 
-        // Manage bookeeping
-        if (bitdex % 8 == 0) {
-            v0[hitdex % ROW_BUFFER_BYTES] = bitmap;
-            hitdex += 1;
-            // Filled v0 hitmap? Save it
-            if (hitdex % ROW_BUFFER_BYTES == 0) {
-                store_v0(targeted_hitmap_base + ((hitdex - 1) / ROW_BUFFER_BYTES));
+// The benchmark suite (compliance/benchmark) builds the scan in with BLIMP_EQUALITY_NO_MAIN defined
+#ifndef BLIMP_EQUALITY_NO_MAIN
+int main(int argc, char** argv)
+{
+    ToolOptions options(true);
+    std::string value_text = "0", profile_path;
+    std::vector<std::string> predicate_texts;
+    bool indexes_only = false;
+    int offset = 0, width = -1, negate = 0, threads = 1;
+    for (int arg = 1; arg < argc; arg++) {
+        std::string option = argv[arg];
+        if (option == "--help" || option == "-h") { usage(argv[0]); return 0; }
+        else if (option == "--negate") { negate = 1; }
+        else if (arg + 1 < argc && option == "--offset") { offset = atoi(argv[++arg]); }
+        else if (arg + 1 < argc && option == "--width") { width = atoi(argv[++arg]); }
+        else if (arg + 1 < argc && option == "--value") { value_text = argv[++arg]; }
+        else if (arg + 1 < argc && option == "--predicate") { predicate_texts.push_back(argv[++arg]); }
+        else if (arg + 1 < argc && option == "--threads") { threads = atoi(argv[++arg]); }
+        else if (option == "--indexes-only") { indexes_only = true; }
+        else if (arg + 1 < argc && option == "--profile") { profile_path = argv[++arg]; }
+        else if (!options.parse(argc, argv, arg)) { usage(argv[0]); return 1; }
+    }
+
+    PhaseProfiler profiler;
+    profiler.begin("layout");
+    try {
+        layout = options.load_layout();
+        ConfigurationReader hardware(layout.hardware_json.empty() ? std::string("{}") : layout.hardware_json);
+        number_of_valus = max(1, (int) hardware.number("number_of_vALUs", 1));
+        dram_timing = row_buffer_from_hardware(layout.hardware_json, layout.bank_rows);
+
+        for (size_t predicate = 0; predicate < predicate_texts.size(); predicate++) {
+            queries.push_back(parse_predicate(predicate_texts[predicate]));
+        }
+        if (queries.empty()) {
+            EqualityQuery query;
+            query.pi_subindex_offset_bytes = offset;
+            query.pi_element_size_bytes = width > 0 ? width : layout.total_index_size_bytes;
+            query.value = parse_value(value_text, query.pi_element_size_bytes);
+            query.negate = negate;
+            query.hitmap_index = options.target_hitmap();
+            queries.push_back(query);
+        }
+
+        if (indexes_only && options.indexes_path.empty()) {
+            throw std::runtime_error("--indexes-only needs --indexes");
+        }
+        if (EqualityCycleModel::segment_bytes() == 0) {
+            throw std::runtime_error("too many predicates to stage a hitmap byte of each in v1");
+        }
+
+        for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+            EqualityQuery& query = queries[predicate];
+            query.write_hitmap = !indexes_only;
+            if (query.pi_subindex_offset_bytes + query.pi_element_size_bytes > layout.total_index_size_bytes) {
+                throw std::runtime_error("the PI element does not fit in the index field");
+            }
+            if (query.hitmap_index < 0 || query.hitmap_index >= layout.hitmap_count) {
+                throw std::runtime_error("the targeted hitmap is not present in this layout");
+            }
+            for (size_t other = 0; other < predicate; other++) {
+                if (queries[other].hitmap_index == query.hitmap_index) {
+                    throw std::runtime_error("every predicate must target a different hitmap");
+                }
             }
+            pack_value(query);
+        }
+    }
+    catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    printf("Creating memory...\n");
+    try {
+        if (create_memory(Bank::storage_from_name(options.storage_name), options.image_path, options.image_offset)) {
+            place_sentinel();
         }
     }
+    catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
 
-    // All records finished processing, save last row
-    while (hitdex % ROW_BUFFER_BYTES != 0) {
-        bitmap <<= 1;
-        bitmap += 1;
-        bitdex += 1;
+    printf("Starting compliance...\n");
+    profiler.begin("scan");
+    std::vector<std::vector<int> > indexes(queries.size());
+    CycleCounters counters;
+    EngineEvents events;
+    run_scan(select_scan(), threads, options.indexes_path.empty() ? NULL : &indexes, counters, &events);
+
+    if (options.report_cycles) {
+        print_cycle_report(stdout, counters, timing_from_hardware(layout.hardware_json));
+    }
+
+    if (!options.indexes_path.empty()) {
+        profiler.begin("indexes");
+        try {
+            for (size_t predicate = 0; predicate < queries.size(); predicate++) {
+                std::string path = options.indexes_path;
+                if (queries.size() > 1) {
+                    std::ostringstream suffix;
+                    suffix << "." << queries[predicate].hitmap_index;
+                    path += suffix.str();
+                }
+                printf("Saving %zu matching indexes...\n", indexes[predicate].size());
+                save_indexes(path, indexes[predicate]);
+            }
+        }
+        catch (const std::exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+    }
 
-        // Manage bookeeping
-        if (bitdex % 8 == 0) {
-            v0[hitdex % ROW_BUFFER_BYTES] = bitmap;
-            hitdex += 1;
+    if (!options.output_path.empty()) {
+        printf("Dumping data...\n");
+        profiler.begin("dump");
+        dump_memory(options.output_path);
+    }
+    if (!options.output_image_path.empty()) {
+        profiler.begin("image");
+        printf("Saving bank image...\n");
+        try {
+            write_bank_image(options.output_image_path, memory, layout);
+        }
+        catch (const std::exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
         }
     }
-    store_v0(targeted_hitmap_base + ((hitdex - 1) / ROW_BUFFER_BYTES));
 
-    printf("Dumping data...\n");
-    dump_memory("test.memdump");
+    if (!profile_path.empty()) {
+        std::ofstream profile(profile_path.c_str());
+        profile << profiler.json(events, counters, timing_from_hardware(layout.hardware_json)) << "\n";
+        if (!profile) {
+            fprintf(stderr, "unable to write the profile to %s\n", profile_path.c_str());
+            return 1;
+        }
+    }
 
     return 0;
 }
+#endif // BLIMP_EQUALITY_NO_MAIN
@@ -0,0 +1,175 @@
+#ifndef BLIMP_SIMD_EQUALITY_H
+#define BLIMP_SIMD_EQUALITY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_EQUALITY_AVAILABLE 1
+#else
+#define SIMD_EQUALITY_AVAILABLE 0
+#endif
+
+// BLIMP-V styled equality engine. An element of SEW bytes (1, 2, 4 or 8, matching blimpv_sew_min_bytes through
+// blimpv_sew_max_bytes) is compared per vector lane and the lane results are collected with a movemask.
+//
+// Records are uniformly strided in bank memory; record i starts at records + i * record_size_bytes regardless
+// of whether that is a multi-record or multi-row layout. Two load strategies are used:
+//     strided: one SEW element is pulled from every record and packed into a vector with scalar loads, no
+//              gathers. Used whenever a record is larger than half a vector, which covers every study
+//              configuration both when several records share a row and when a record spans rows.
+//     packed:  records are small enough that one full vector load covers several of them, lanes holding
+//              PI elements are selected out of the compare mask.
+//
+// Keys wider than an element, 16 or 32 byte composite keys, are compared whole instead: one vector load of the key
+// per record, a byte compare against the query value, and the record matches when every byte does.
+//
+// All strategies return up to 64 hitmap bits per call, MSB aligned: the first record lands in bit 63 and unused
+// low bits are zero, ready to be written into a hitmap row most significant byte first.
+namespace simd_equality {
+
+#if SIMD_EQUALITY_AVAILABLE
+
+#if defined(__AVX512BW__)
+#define SIMD_EQUALITY_VECTOR_BYTES 64
+typedef __m512i vector_t;
+#else
+#define SIMD_EQUALITY_VECTOR_BYTES 32
+typedef __m256i vector_t;
+#endif
+
+inline vector_t load_vector(const uint8_t* source) {
+#if defined(__AVX512BW__)
+    return _mm512_loadu_si512((const void*) source);
+#else
+    return _mm256_loadu_si256((const __m256i*) source);
+#endif
+}
+
+// Compare two vectors on SEW-wide lanes, bit i of the result is set if lane i is equal
+template <int SEW> inline uint64_t lane_mask(vector_t a, vector_t b);
+
+#if defined(__AVX512BW__)
+template <> inline uint64_t lane_mask<1>(vector_t a, vector_t b) { return _mm512_cmpeq_epi8_mask(a, b); }
+template <> inline uint64_t lane_mask<2>(vector_t a, vector_t b) { return _mm512_cmpeq_epi16_mask(a, b); }
+template <> inline uint64_t lane_mask<4>(vector_t a, vector_t b) { return _mm512_cmpeq_epi32_mask(a, b); }
+template <> inline uint64_t lane_mask<8>(vector_t a, vector_t b) { return _mm512_cmpeq_epi64_mask(a, b); }
+#else
+template <> inline uint64_t lane_mask<1>(vector_t a, vector_t b) {
+    return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+}
+template <> inline uint64_t lane_mask<2>(vector_t a, vector_t b) {
+    // No 16-bit movemask, narrow the 16-bit lanes to bytes first then fix up the 128-bit lane interleave
+    __m256i equal = _mm256_cmpeq_epi16(a, b);
+    __m256i narrow = _mm256_permute4x64_epi64(_mm256_packs_epi16(equal, _mm256_setzero_si256()), 0xD8);
+    return (uint16_t) _mm256_movemask_epi8(narrow);
+}
+template <> inline uint64_t lane_mask<4>(vector_t a, vector_t b) {
+    return (uint8_t) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)));
+}
+template <> inline uint64_t lane_mask<8>(vector_t a, vector_t b) {
+    return (uint8_t) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b)));
+}
+#endif
+
+// Reverse the bit order of a word, turning LSB-first record bits into an MSB aligned hitmap word
+inline uint64_t reverse_bits(uint64_t word) {
+    word = ((word >> 1) & 0x5555555555555555ULL) | ((word & 0x5555555555555555ULL) << 1);
+    word = ((word >> 2) & 0x3333333333333333ULL) | ((word & 0x3333333333333333ULL) << 2);
+    word = ((word >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((word & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return __builtin_bswap64(word);
+}
+
+// Broadcast a SEW-wide value (in memory byte order) across every lane of a vector
+template <int SEW> inline vector_t broadcast(const uint8_t* value) {
+    uint8_t pattern[SIMD_EQUALITY_VECTOR_BYTES];
+    for (int lane = 0; lane < SIMD_EQUALITY_VECTOR_BYTES / SEW; lane++) {
+        memcpy(pattern + lane * SEW, value, SEW);
+    }
+    return load_vector(pattern);
+}
+
+// Whether the packed strategy can serve this layout
+template <int SEW> inline bool packable(size_t record_size_bytes, size_t pi_offset_bytes) {
+    return record_size_bytes <= SIMD_EQUALITY_VECTOR_BYTES / 2
+        && SIMD_EQUALITY_VECTOR_BYTES % record_size_bytes == 0
+        && pi_offset_bytes % SEW == 0;
+}
+
+// Compare the PI elements of `count` (<= 64) records, one element per record stride
+template <int SEW> inline uint64_t compare_strided(const uint8_t* first_pi, size_t record_size_bytes, int count,
+                                                   vector_t value) {
+    const int lanes = SIMD_EQUALITY_VECTOR_BYTES / SEW;
+    uint64_t bits = 0;
+    for (int base = 0; base < count; base += lanes) {
+        uint8_t elements[SIMD_EQUALITY_VECTOR_BYTES] = {0};
+        int filled = count - base < lanes ? count - base : lanes;
+        for (int lane = 0; lane < filled; lane++) {
+            memcpy(elements + lane * SEW, first_pi + (size_t)(base + lane) * record_size_bytes, SEW);
+        }
+        uint64_t mask = lane_mask<SEW>(load_vector(elements), value);
+        if (filled < 64) {
+            mask &= (1ULL << filled) - 1;
+        }
+        bits |= mask << base;
+    }
+    return reverse_bits(bits);
+}
+
+// Compare the PI elements of `count` (<= 64) records where several records fit in one vector load
+template <int SEW> inline uint64_t compare_packed(const uint8_t* first_record, size_t record_size_bytes,
+                                                  size_t pi_offset_bytes, int count, vector_t value) {
+    const int records_per_vector = SIMD_EQUALITY_VECTOR_BYTES / record_size_bytes;
+    const int lanes_per_record = record_size_bytes / SEW;
+    const int pi_lane = pi_offset_bytes / SEW;
+    uint64_t bits = 0;
+    for (int base = 0; base < count; base += records_per_vector) {
+        uint64_t mask = lane_mask<SEW>(load_vector(first_record + (size_t) base * record_size_bytes), value);
+        if (lanes_per_record == 1) {  // A packed PI/Key column, every lane is a record
+            bits |= mask << base;
+            continue;
+        }
+        for (int record = 0; record < records_per_vector; record++) {
+            bits |= ((mask >> (record * lanes_per_record + pi_lane)) & 1) << (base + record);
+        }
+    }
+    if (count < 64) {
+        bits &= (1ULL << count) - 1;
+    }
+    return reverse_bits(bits);
+}
+
+// Compare the KEY_BYTES wide (16 or 32) PI fields of `count` (<= 64) records, one record stride apart
+template <int KEY_BYTES> inline uint64_t compare_wide(const uint8_t* first_pi, size_t record_size_bytes, int count,
+                                                      const uint8_t* value);
+
+template <> inline uint64_t compare_wide<16>(const uint8_t* first_pi, size_t record_size_bytes, int count,
+                                             const uint8_t* value) {
+    __m128i key = _mm_loadu_si128((const __m128i*) value);
+    uint64_t bits = 0;
+    for (int record = 0; record < count; record++) {
+        __m128i pi = _mm_loadu_si128((const __m128i*)(first_pi + (size_t) record * record_size_bytes));
+        bits |= (uint64_t)(_mm_movemask_epi8(_mm_cmpeq_epi8(pi, key)) == 0xFFFF) << (63 - record);
+    }
+    return bits;
+}
+
+template <> inline uint64_t compare_wide<32>(const uint8_t* first_pi, size_t record_size_bytes, int count,
+                                             const uint8_t* value) {
+    __m256i key = _mm256_loadu_si256((const __m256i*) value);
+    uint64_t bits = 0;
+    for (int record = 0; record < count; record++) {
+        __m256i pi = _mm256_loadu_si256((const __m256i*)(first_pi + (size_t) record * record_size_bytes));
+        bits |= (uint64_t)((uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(pi, key)) == 0xFFFFFFFFu)
+            << (63 - record);
+    }
+    return bits;
+}
+
+#endif // SIMD_EQUALITY_AVAILABLE
+
+} // namespace simd_equality
+
+#endif // BLIMP_SIMD_EQUALITY_H
@@ -0,0 +1,362 @@
+#include <iostream>
+#include <stdio.h>
+#include <random>
+#include <string.h>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+#include "../common/bank.h"
+#include "../common/bank_image.h"
+#include "../common/configuration.h"
+#include "../common/cycle_accounting.h"
+#include "../common/dram_timing.h"
+#include "../common/hitmap_writer.h"
+#include "../common/tool_common.h"
+#include "simd_range.h"
+
+// Meta Directives
+//#define DEBUG
+//#define SCALAR  // Force the scalar kernel even if built with AVX2/AVX-512 (-mavx2, -mavx512bw, -march=native)
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+
+// Query Specifics; a PI element is a hit when it lies within the inclusive range [low, high], compared as an
+// unsigned most significant byte first value. <, <= and > are ranges with one open side, BETWEEN has two bounds
+struct RangeQuery {
+    int pi_subindex_offset_bytes;
+    int pi_element_size_bytes;
+    std::vector<uint8_t> low;
+    std::vector<uint8_t> high;
+    // Whether no value lies in the range, e.g. < 0
+    bool empty;
+    // The bounds the equivalent BLIMP program compares against, 1 for <, <= and >, 2 for BETWEEN
+    int bounds;
+    int hitmap_index;
+    bool write_hitmap;
+
+    // The range in native order, for PI elements of up to 8 bytes
+    uint64_t native_low;
+    uint64_t native_high;
+    // The SEW of the SIMD engine serving this query, 0 for the scalar kernel
+    int sew;
+#if SIMD_EQUALITY_AVAILABLE
+    simd_range::RangeVectors range_vectors;
+#endif
+
+    RangeQuery() : pi_subindex_offset_bytes(0), pi_element_size_bytes(0), empty(false), bounds(1), hitmap_index(0),
+                   write_hitmap(true), native_low(0), native_high(0), sew(0) {
+#if SIMD_EQUALITY_AVAILABLE
+        memset(&range_vectors, 0, sizeof(range_vectors));
+#endif
+    }
+};
+
+LayoutConfiguration layout;
+RangeQuery query;
+Bank memory;
+// The row buffer policy and subarrays of the hardware block
+RowBufferTiming dram_timing;
+
+RowBuffer rowbuffer;
+
+// Convert the range to native order and pick the engine testing it
+void prepare_range() {
+    int width = query.pi_element_size_bytes;
+    if (width <= 8) {
+        query.native_low = load_native(&query.low[0], width);
+        query.native_high = load_native(&query.high[0], width);
+    }
+
+    query.sew = 0;
+#if SIMD_EQUALITY_AVAILABLE && !defined(SCALAR) && !defined(DEBUG)
+    switch (width) {
+        case 1: query.range_vectors = simd_range::prepare<1>(query.native_low, query.native_high); query.sew = 1; break;
+        case 2: query.range_vectors = simd_range::prepare<2>(query.native_low, query.native_high); query.sew = 2; break;
+        case 4: query.range_vectors = simd_range::prepare<4>(query.native_low, query.native_high); query.sew = 4; break;
+        case 8: query.range_vectors = simd_range::prepare<8>(query.native_low, query.native_high); query.sew = 8; break;
+    }
+#endif
+}
+
+// Test a PI element against the query range, return 1 if within it and 0 otherwise
+inline uint64_t pi_in_range(const uint8_t* pi) {
+    int width = query.pi_element_size_bytes;
+    if (width <= 8) {
+        // One unsigned compare covers both bounds, elements below low wrap around past the span
+        return load_native(pi, width) - query.native_low <= query.native_high - query.native_low;
+    }
+    return memcmp(pi, &query.low[0], width) >= 0 && memcmp(pi, &query.high[0], width) <= 0;
+}
+
+// Cycle accounting, the operations src/queries/blimp_range.py issues for the same scan. These match BlimpEqual but
+// for the memcmp, which is made (with a bound check) once per bound of the range
+struct RangeCycleModel {
+    static CycleCounters scan() {
+        CycleCounters counters;
+        RowBufferTiming dram = dram_timing;
+        long long records = layout.total_records_processable;
+        long long row_buffer_bytes = layout.row_buffer_size_bytes;
+        long long records_per_hitmap_row = row_buffer_bytes * 8;
+        int hitmap_row = layout.hitmap_row(query.hitmap_index);
+
+        // BLIMP enable, setup, initialization and the loop start
+        counters.row_activate += 1;
+        counters.blimp_cycle += 5 + 5 + 1;
+
+        // Row, offset and suboffset calculation, row check, memcmp and bound check per bound, and bookkeeping
+        counters.blimp_cycle += records * (3 + 3 + 2 + 3 + query.bounds * (query.pi_element_size_bytes * 2 + 2) + 4);
+
+        // Every new record (or PI/Key column) row is loaded into the scratchpad through v0 before its first record,
+        // every filled hitmap row saved from v1 after its last; the scan starts out assuming row 0 is loaded, so a
+        // region at row 0 skips its first load
+        int keys_per_row = layout.keys_per_row();
+        int loaded_row = 0;
+        for (long long record = 0; record < records;) {
+            int row = layout.key_row((int) record);
+            if (row != loaded_row) {
+                dram.register_transfer(counters, row);
+                loaded_row = row;
+            }
+            long long next_record = keys_per_row > 0 ? (record / keys_per_row + 1) * keys_per_row : record + 1;
+            next_record = min(next_record, (record / records_per_hitmap_row + 1) * records_per_hitmap_row);
+            next_record = min(next_record, records);
+            if (next_record % records_per_hitmap_row == 0) {
+                dram.register_transfer(counters, hitmap_row + (int)(next_record / records_per_hitmap_row - 1));
+            }
+            record = next_record;
+        }
+
+        // Every completed hitmap byte
+        long long full_bytes = records / 8;
+        counters.blimp_cycle += 4 * full_bytes;
+
+        // Padding of the last hitmap row one bit at a time, its save and BLIMP disable
+        counters.blimp_cycle += 1;
+        long long padded_bytes = full_bytes;
+        if (full_bytes % row_buffer_bytes != 0) {
+            long long padding_bytes = row_buffer_bytes - full_bytes % row_buffer_bytes;
+            counters.blimp_cycle += 3 * (padding_bytes * 8 - records % 8) + 4 * padding_bytes;
+            padded_bytes += padding_bytes;
+        }
+        dram.register_transfer(counters, hitmap_row + (int)((padded_bytes - 1) / row_buffer_bytes));
+        dram.precharge_all(counters);
+        counters.row_activate += 1;
+        return counters;
+    }
+};
+
+#if SIMD_EQUALITY_AVAILABLE
+// Test `count` records starting at `word_base` with the SIMD engine directly out of bank memory
+template <int SEW>
+uint64_t scan_word_simd(int word_base, int count) {
+    const uint8_t* first_record = memory_row(layout.key_base_row()) + (size_t) word_base * layout.key_stride_bytes();
+    if (simd_equality::packable<SEW>(layout.key_stride_bytes(), query.pi_subindex_offset_bytes)) {
+        return simd_range::range_packed<SEW>(first_record, layout.key_stride_bytes(),
+                                             query.pi_subindex_offset_bytes, count, query.range_vectors);
+    }
+    return simd_range::range_strided<SEW>(first_record + query.pi_subindex_offset_bytes,
+                                           layout.key_stride_bytes(), count, query.range_vectors);
+}
+#endif // SIMD_EQUALITY_AVAILABLE
+
+// Test `count` records starting at `word_base` one at a time out of the row buffer
+uint64_t scan_word_scalar(int word_base, int count) {
+    int records_per_row = layout.keys_per_row();
+    int rows_per_record = layout.rows_per_key();
+    uint64_t hitword = 0;
+
+    for (int record_index = word_base; record_index < word_base + count; record_index++) {
+        int row, offset;
+        if (records_per_row <= 0) { // Are we dealing with multi-rows per record
+            row = layout.key_base_row() + record_index * rows_per_record;
+            offset = 0;
+        }
+        else { // Are we dealing with multi-records per row
+            row = layout.key_base_row() + record_index / records_per_row;
+            offset = record_index % records_per_row * layout.key_stride_bytes();
+        }
+
+        // Fetch the record
+        rowbuffer.load(row);
+
+        const uint8_t* pi = rowbuffer.bytes + offset + query.pi_subindex_offset_bytes;
+        uint64_t hit = pi_in_range(pi);
+        hitword = (hitword << 1) | hit;
+
+#ifdef DEBUG
+        for (int z = 0; z < query.pi_element_size_bytes; z++) {
+            std::cout << std::hex << std::setfill('0') << std::setw(2) << unsigned(pi[z]) << " ";
+        }
+        std::cout << "in range? " << (hit ? "yes" : "no") << "\nrecord=" << std::dec << record_index << "\n";
+#endif // DEBUG
+    }
+    return count < 64 ? hitword << (64 - count) : hitword;
+}
+
+// Scan every record 64 at a time, streaming each hitmap word into the targeted hitmap
+void scan(std::vector<int>* indexes) {
+    rowbuffer = RowBuffer();
+    HitmapWriter writer(memory_row(layout.hitmap_row(query.hitmap_index)), layout.row_buffer_size_bytes, 0,
+                        query.write_hitmap, indexes);
+
+    for (int word_base = 0; word_base < layout.total_records_processable; word_base += 64) {
+        int records_in_word = min(64, layout.total_records_processable - word_base);
+        uint64_t hitword;
+        if (query.empty) {
+            hitword = 0;
+        }
+#if SIMD_EQUALITY_AVAILABLE
+        else if (query.sew == 1) { hitword = scan_word_simd<1>(word_base, records_in_word); }
+        else if (query.sew == 2) { hitword = scan_word_simd<2>(word_base, records_in_word); }
+        else if (query.sew == 4) { hitword = scan_word_simd<4>(word_base, records_in_word); }
+        else if (query.sew == 8) { hitword = scan_word_simd<8>(word_base, records_in_word); }
+#endif
+        else {
+            hitword = scan_word_scalar(word_base, records_in_word);
+        }
+        writer.write(hitword, records_in_word);
+    }
+    writer.finish();
+}
+
+// Step a big-endian value up (or down) by one; return false, leaving it unchanged, if it would wrap around
+bool step_value(std::vector<uint8_t>& value, bool up) {
+    std::vector<uint8_t> stepped = value;
+    for (int byte = (int) stepped.size() - 1; byte >= 0; byte--) {
+        stepped[byte] += up ? 1 : -1;
+        if (stepped[byte] != (up ? 0x00 : 0xFF)) {
+            value = stepped;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Express the comparison as an inclusive range over the PI element
+void set_range(const std::string& op, const std::string& value_text, const std::string& high_text) {
+    int width = query.pi_element_size_bytes;
+    std::vector<uint8_t> value = parse_value(value_text, width);
+    query.low.assign(width, 0x00);
+    query.high.assign(width, 0xFF);
+    query.bounds = 1;
+    if (op == "lt") {
+        query.high = value;
+        query.empty = !step_value(query.high, false);
+    }
+    else if (op == "le") {
+        query.high = value;
+    }
+    else if (op == "gt") {
+        query.low = value;
+        query.empty = !step_value(query.low, true);
+    }
+    else if (op == "between") {
+        query.low = value;
+        query.high = parse_value(high_text, width);
+        query.empty = query.low > query.high;
+        query.bounds = 2;
+    }
+    else {
+        throw std::runtime_error("unknown comparison '" + op + "', expected lt, le, gt or between");
+    }
+}
+
+void usage(const char* program) {
+    print_tool_usage(program, "[--op lt|le|gt|between] [--value hex] [--high hex] [--offset bytes] [--width bytes]",
+                     true);
+    printf("Hits every record whose PI element, as an unsigned big-endian value, is less than (lt), at most (le) or\n");
+    printf("greater than (gt) the value, or within [value, high] (between).\n");
+    printf("The PI width defaults to the configured index size and the value to zero.\n");
+    printf("--cycles reports the operations and runtime of the equivalent BlimpLessThan, BlimpLessThanOrEqual,\n");
+    printf("BlimpGreaterThan or BlimpBetween simulation as JSON.\n");
+}
+
+
+
+int main(int argc, char** argv)
+{
+    ToolOptions options(true);
+    std::string op = "lt", value_text = "0", high_text;
+    int offset = 0, width = -1;
+    for (int arg = 1; arg < argc; arg++) {
+        std::string option = argv[arg];
+        if (option == "--help" || option == "-h") { usage(argv[0]); return 0; }
+        else if (arg + 1 < argc && option == "--op") { op = argv[++arg]; }
+        else if (arg + 1 < argc && option == "--value") { value_text = argv[++arg]; }
+        else if (arg + 1 < argc && option == "--high") { high_text = argv[++arg]; }
+        else if (arg + 1 < argc && option == "--offset") { offset = atoi(argv[++arg]); }
+        else if (arg + 1 < argc && option == "--width") { width = atoi(argv[++arg]); }
+        else if (!options.parse(argc, argv, arg)) { usage(argv[0]); return 1; }
+    }
+
+    try {
+        layout = options.load_layout();
+        dram_timing = row_buffer_from_hardware(layout.hardware_json, layout.bank_rows);
+        query.pi_subindex_offset_bytes = offset;
+        query.pi_element_size_bytes = width > 0 ? width : layout.total_index_size_bytes;
+        query.hitmap_index = options.target_hitmap();
+        if (op == "between" && high_text.empty()) {
+            throw std::runtime_error("--op between needs --high");
+        }
+        set_range(op, value_text, high_text);
+
+        if (query.pi_subindex_offset_bytes + query.pi_element_size_bytes > layout.total_index_size_bytes) {
+            throw std::runtime_error("the PI element does not fit in the index field");
+        }
+        if (query.hitmap_index >= layout.hitmap_count) {
+            throw std::runtime_error("the targeted hitmap is not present in this layout");
+        }
+        prepare_range();
+    }
+    catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    printf("Creating memory...\n");
+    try {
+        create_memory(Bank::storage_from_name(options.storage_name), options.image_path, options.image_offset);
+    }
+    catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    printf("Starting compliance...\n");
+    std::vector<int> indexes;
+    scan(options.indexes_path.empty() ? NULL : &indexes);
+
+    if (options.report_cycles) {
+        print_cycle_report(stdout, RangeCycleModel::scan(), timing_from_hardware(layout.hardware_json));
+    }
+
+    if (!options.indexes_path.empty()) {
+        printf("Saving %zu matching indexes...\n", indexes.size());
+        try {
+            save_indexes(options.indexes_path, indexes);
+        }
+        catch (const std::exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+    }
+
+    if (!options.output_path.empty()) {
+        printf("Dumping data...\n");
+        dump_memory(options.output_path);
+    }
+    if (!options.output_image_path.empty()) {
+        printf("Saving bank image...\n");
+        try {
+            write_bank_image(options.output_image_path, memory, layout);
+        }
+        catch (const std::exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef BLIMP_SIMD_RANGE_H
+#define BLIMP_SIMD_RANGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../blimp_equality/simd_equality.h"
+
+// BLIMP-V styled range engine, built on the vectors and load strategies of simd_equality.h. An element of SEW bytes
+// (1, 2, 4 or 8) is tested per vector lane against an inclusive range [low, high] of unsigned values.
+//
+// PI elements are stored most significant byte first, so every lane is byte swapped into native order after it is
+// loaded. A lane is in range when (element - low) <= (high - low) as unsigned values: one subtraction and one
+// unsigned compare per lane serves <, <=, > and BETWEEN alike. AVX2 has only signed compares, so both sides are
+// biased by the lane's sign bit first.
+//
+// As with the equality engine, up to 64 hitmap bits are returned per call, MSB aligned: the first record lands in
+// bit 63 and unused low bits are zero.
+namespace simd_range {
+
+#if SIMD_EQUALITY_AVAILABLE
+
+using simd_equality::vector_t;
+using simd_equality::load_vector;
+
+// The range of a query, broadcast across every lane; see prepare
+struct RangeVectors {
+    vector_t low;
+    vector_t span;
+};
+
+// Swap every SEW-wide lane from memory (most significant byte first) into native order
+template <int SEW> inline vector_t to_native(vector_t v) {
+    if (SEW == 1) {
+        return v;
+    }
+    uint8_t order[SIMD_EQUALITY_VECTOR_BYTES];
+    for (int byte = 0; byte < SIMD_EQUALITY_VECTOR_BYTES; byte++) {
+        // Shuffles index within 128-bit lanes, which SEW always divides
+        order[byte] = (uint8_t)((byte % 16) / SEW * SEW + SEW - 1 - byte % SEW);
+    }
+#if defined(__AVX512BW__)
+    return _mm512_shuffle_epi8(v, load_vector(order));
+#else
+    return _mm256_shuffle_epi8(v, load_vector(order));
+#endif
+}
+
+// Broadcast a native SEW-wide value across every lane of a vector
+template <int SEW> inline vector_t broadcast_native(uint64_t value) {
+    uint8_t pattern[SIMD_EQUALITY_VECTOR_BYTES];
+    for (int lane = 0; lane < SIMD_EQUALITY_VECTOR_BYTES / SEW; lane++) {
+        memcpy(pattern + lane * SEW, &value, SEW);
+    }
+    return load_vector(pattern);
+}
+
+// Bit i of the result is set if lane i of `elements` (native order) is within the range
+template <int SEW> inline uint64_t range_mask(vector_t elements, const RangeVectors& range);
+
+#if defined(__AVX512BW__)
+template <> inline uint64_t range_mask<1>(vector_t elements, const RangeVectors& range) {
+    return _mm512_cmple_epu8_mask(_mm512_sub_epi8(elements, range.low), range.span);
+}
+template <> inline uint64_t range_mask<2>(vector_t elements, const RangeVectors& range) {
+    return _mm512_cmple_epu16_mask(_mm512_sub_epi16(elements, range.low), range.span);
+}
+template <> inline uint64_t range_mask<4>(vector_t elements, const RangeVectors& range) {
+    return _mm512_cmple_epu32_mask(_mm512_sub_epi32(elements, range.low), range.span);
+}
+template <> inline uint64_t range_mask<8>(vector_t elements, const RangeVectors& range) {
+    return _mm512_cmple_epu64_mask(_mm512_sub_epi64(elements, range.low), range.span);
+}
+#else
+// The span is biased by prepare, the offsets here; a lane is out of range when its biased offset is greater
+template <> inline uint64_t range_mask<1>(vector_t elements, const RangeVectors& range) {
+    __m256i offset = _mm256_xor_si256(_mm256_sub_epi8(elements, range.low), _mm256_set1_epi8((char) 0x80));
+    return ~(uint64_t)(uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi8(offset, range.span)) & 0xFFFFFFFFULL;
+}
+template <> inline uint64_t range_mask<2>(vector_t elements, const RangeVectors& range) {
+    __m256i offset = _mm256_xor_si256(_mm256_sub_epi16(elements, range.low), _mm256_set1_epi16((short) 0x8000));
+    // No 16-bit movemask, narrow the 16-bit lanes to bytes first then fix up the 128-bit lane interleave
+    __m256i outside = _mm256_cmpgt_epi16(offset, range.span);
+    __m256i narrow = _mm256_permute4x64_epi64(_mm256_packs_epi16(outside, _mm256_setzero_si256()), 0xD8);
+    return ~(uint64_t)(uint16_t) _mm256_movemask_epi8(narrow) & 0xFFFFULL;
+}
+template <> inline uint64_t range_mask<4>(vector_t elements, const RangeVectors& range) {
+    __m256i offset = _mm256_xor_si256(_mm256_sub_epi32(elements, range.low), _mm256_set1_epi32((int) 0x80000000));
+    __m256i outside = _mm256_cmpgt_epi32(offset, range.span);
+    return ~(uint64_t)(uint8_t) _mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFFULL;
+}
+template <> inline uint64_t range_mask<8>(vector_t elements, const RangeVectors& range) {
+    __m256i offset = _mm256_xor_si256(_mm256_sub_epi64(elements, range.low),
+                                      _mm256_set1_epi64x((long long) 0x8000000000000000ULL));
+    __m256i outside = _mm256_cmpgt_epi64(offset, range.span);
+    return ~(uint64_t)(uint8_t) _mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xFULL;
+}
+#endif
+
+// Broadcast the native range [low, high] for range_mask
+template <int SEW> inline RangeVectors prepare(uint64_t low, uint64_t high) {
+    RangeVectors range;
+    uint64_t span = high - low;
+#if !defined(__AVX512BW__)
+    span ^= 1ULL << (SEW * 8 - 1);
+#endif
+    range.low = broadcast_native<SEW>(low);
+    range.span = broadcast_native<SEW>(span);
+    return range;
+}
+
+// Test the PI elements of `count` (<= 64) records, one element per record stride
+template <int SEW> inline uint64_t range_strided(const uint8_t* first_pi, size_t record_size_bytes, int count,
+                                                 const RangeVectors& range) {
+    const int lanes = SIMD_EQUALITY_VECTOR_BYTES / SEW;
+    uint64_t bits = 0;
+    for (int base = 0; base < count; base += lanes) {
+        uint8_t elements[SIMD_EQUALITY_VECTOR_BYTES] = {0};
+        int filled = count - base < lanes ? count - base : lanes;
+        for (int lane = 0; lane < filled; lane++) {
+            memcpy(elements + lane * SEW, first_pi + (size_t)(base + lane) * record_size_bytes, SEW);
+        }
+        uint64_t mask = range_mask<SEW>(to_native<SEW>(load_vector(elements)), range);
+        if (filled < 64) {
+            mask &= (1ULL << filled) - 1;
+        }
+        bits |= mask << base;
+    }
+    return simd_equality::reverse_bits(bits);
+}
+
+// Test the PI elements of `count` (<= 64) records where several records fit in one vector load
+template <int SEW> inline uint64_t range_packed(const uint8_t* first_record, size_t record_size_bytes,
+                                                size_t pi_offset_bytes, int count, const RangeVectors& range) {
+    const int records_per_vector = SIMD_EQUALITY_VECTOR_BYTES / record_size_bytes;
+    const int lanes_per_record = record_size_bytes / SEW;
+    const int pi_lane = pi_offset_bytes / SEW;
+    uint64_t bits = 0;
+    for (int base = 0; base < count; base += records_per_vector) {
+        vector_t records = to_native<SEW>(load_vector(first_record + (size_t) base * record_size_bytes));
+        uint64_t mask = range_mask<SEW>(records, range);
+        if (lanes_per_record == 1) {  // A packed PI/Key column, every lane is a record
+            bits |= mask << base;
+            continue;
+        }
+        for (int record = 0; record < records_per_vector; record++) {
+            bits |= ((mask >> (record * lanes_per_record + pi_lane)) & 1) << (base + record);
+        }
+    }
+    if (count < 64) {
+        bits &= (1ULL << count) - 1;
+    }
+    return simd_equality::reverse_bits(bits);
+}
+
+#endif // SIMD_EQUALITY_AVAILABLE
+
+} // namespace simd_range
+
+#endif // BLIMP_SIMD_RANGE_H
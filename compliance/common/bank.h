@@ -0,0 +1,148 @@
+#ifndef BLIMP_BANK_H
+#define BLIMP_BANK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <string>
+
+// Row storage for a simulated DRAM bank.
+//
+// Memory is never allocated or zeroed up front: anonymous mappings are zero-filled by the kernel on first touch,
+// so only rows that are actually written (records, hitmaps) count towards RSS and startup is O(1) in bank size.
+// An existing bank image can instead be mapped straight from disk, privately (copy-on-write) by default so a
+// compliance run never modifies the image it reads.
+class Bank {
+public:
+    enum Storage {
+        ANONYMOUS,   // page-aligned anonymous mapping
+        HUGE_PAGES,  // 2MB aligned mapping backed by hugetlbfs if reserved, otherwise transparent huge pages
+        IMAGE        // file-backed mapping of an existing bank image
+    };
+
+    static const size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+    Bank() : data_(NULL), mapped_bytes_(0), mapping_offset_(0), rows_(0), row_buffer_bytes_(0), storage_(ANONYMOUS) {}
+
+    Bank(int rows, int row_buffer_bytes, Storage storage = ANONYMOUS) : Bank() {
+        allocate(rows, row_buffer_bytes, storage);
+    }
+
+    ~Bank() { release(); }
+
+    Bank(const Bank&) = delete;
+    Bank& operator=(const Bank&) = delete;
+
+    // Reserve zero-initialized storage for a bank
+    void allocate(int rows, int row_buffer_bytes, Storage storage = ANONYMOUS) {
+        release();
+        rows_ = rows;
+        row_buffer_bytes_ = row_buffer_bytes;
+        storage_ = storage;
+
+        size_t bytes = size_bytes();
+        void* mapping = MAP_FAILED;
+        if (storage == HUGE_PAGES) {
+            bytes = (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+#ifdef MAP_HUGETLB
+            mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+            if (mapping == MAP_FAILED) {
+                // No reserved huge pages, over-allocate to align the bank to a huge page boundary and ask for THP
+                size_t padded = bytes + HUGE_PAGE_BYTES;
+                uint8_t* base = (uint8_t*) mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (base != (uint8_t*) MAP_FAILED) {
+                    uint8_t* aligned = (uint8_t*)(((uintptr_t) base + HUGE_PAGE_BYTES - 1) & ~(uintptr_t)(HUGE_PAGE_BYTES - 1));
+                    if (aligned > base) {
+                        munmap(base, aligned - base);
+                    }
+                    munmap(aligned + bytes, base + padded - (aligned + bytes));
+                    mapping = aligned;
+#ifdef MADV_HUGEPAGE
+                    madvise(mapping, bytes, MADV_HUGEPAGE);
+#endif
+                }
+            }
+        }
+        else {
+            mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        }
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error(std::string("unable to allocate bank memory: ") + strerror(errno));
+        }
+        data_ = (uint8_t*) mapping;
+        mapped_bytes_ = bytes;
+        mapping_offset_ = 0;
+    }
+
+    // Map the rows of an existing bank image, starting `offset` bytes into the file
+    void map_image(const std::string& path, int rows, int row_buffer_bytes, size_t offset = 0, bool writable = false) {
+        release();
+        rows_ = rows;
+        row_buffer_bytes_ = row_buffer_bytes;
+        storage_ = IMAGE;
+
+        int fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("unable to open bank image " + path + ": " + strerror(errno));
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < offset + size_bytes()) {
+            close(fd);
+            throw std::runtime_error("bank image " + path + " is smaller than the configured bank");
+        }
+
+        // mmap offsets must be page aligned, map from the enclosing page and step over the difference
+        size_t page = (size_t) sysconf(_SC_PAGESIZE);
+        size_t aligned_offset = offset / page * page;
+        mapping_offset_ = offset - aligned_offset;
+        mapped_bytes_ = size_bytes() + mapping_offset_;
+        void* mapping = mmap(NULL, mapped_bytes_, PROT_READ | PROT_WRITE, writable ? MAP_SHARED : MAP_PRIVATE,
+                             fd, (off_t) aligned_offset);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("unable to map bank image " + path + ": " + strerror(errno));
+        }
+        data_ = (uint8_t*) mapping;
+    }
+
+    inline uint8_t* row(int row_index) { return data() + (size_t) row_index * row_buffer_bytes_; }
+    inline const uint8_t* row(int row_index) const { return data() + (size_t) row_index * row_buffer_bytes_; }
+
+    inline uint8_t* data() { return data_ + mapping_offset_; }
+    inline const uint8_t* data() const { return data_ + mapping_offset_; }
+
+    int rows() const { return rows_; }
+    int row_buffer_bytes() const { return row_buffer_bytes_; }
+    size_t size_bytes() const { return (size_t) rows_ * row_buffer_bytes_; }
+    Storage storage() const { return storage_; }
+
+    static Storage storage_from_name(const std::string& name) {
+        if (name == "anonymous") return ANONYMOUS;
+        if (name == "hugepages") return HUGE_PAGES;
+        throw std::runtime_error("unknown bank storage '" + name + "', expected anonymous or hugepages");
+    }
+
+private:
+    void release() {
+        if (data_) {
+            munmap(data_, mapped_bytes_);
+            data_ = NULL;
+        }
+    }
+
+    uint8_t* data_;
+    size_t mapped_bytes_;
+    size_t mapping_offset_;
+    int rows_;
+    int row_buffer_bytes_;
+    Storage storage_;
+};
+
+#endif // BLIMP_BANK_H
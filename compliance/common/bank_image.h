@@ -0,0 +1,119 @@
+#ifndef BLIMP_BANK_IMAGE_H
+#define BLIMP_BANK_IMAGE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bank.h"
+#include "configuration.h"
+
+// Binary bank image, shared with src/hardware/image.py
+//
+//     8 bytes     magic, "BLIMPBNK"
+//     4 bytes     little-endian length of the JSON header
+//     n bytes     JSON header; {"hardware": {...}, "image": {...}}
+//     padding     zero bytes up to the next BANK_IMAGE_ALIGNMENT boundary
+//     data        bank_rows * row_buffer_size_bytes raw row bytes, row 0 first
+//
+// Row data is page aligned, so an uncompressed image maps straight into a Bank with no parsing or copying.
+// zstd compressed images (written by Python with compression="zstd") must be decompressed with Bank.load and
+// saved again uncompressed before the native tools can map them.
+#define BANK_IMAGE_MAGIC "BLIMPBNK"
+#define BANK_IMAGE_MAGIC_BYTES 8
+#define BANK_IMAGE_VERSION 1
+#define BANK_IMAGE_ALIGNMENT 4096
+
+struct BankImageHeader {
+    int bank_rows;
+    int row_buffer_size_bytes;
+    std::string compression;
+    size_t data_offset;
+};
+
+inline size_t bank_image_data_offset(size_t header_length) {
+    size_t end = BANK_IMAGE_MAGIC_BYTES + 4 + header_length;
+    return (end + BANK_IMAGE_ALIGNMENT - 1) / BANK_IMAGE_ALIGNMENT * BANK_IMAGE_ALIGNMENT;
+}
+
+// Whether the file at path is a binary bank image
+inline bool is_bank_image(const std::string& path) {
+    char magic[BANK_IMAGE_MAGIC_BYTES] = {0};
+    std::ifstream file(path.c_str(), std::ios::binary);
+    file.read(magic, BANK_IMAGE_MAGIC_BYTES);
+    return file && memcmp(magic, BANK_IMAGE_MAGIC, BANK_IMAGE_MAGIC_BYTES) == 0;
+}
+
+inline BankImageHeader read_bank_image_header(const std::string& path) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("unable to open bank image " + path);
+    }
+    char magic[BANK_IMAGE_MAGIC_BYTES];
+    uint8_t length_bytes[4];
+    file.read(magic, BANK_IMAGE_MAGIC_BYTES);
+    file.read((char*) length_bytes, 4);
+    if (!file || memcmp(magic, BANK_IMAGE_MAGIC, BANK_IMAGE_MAGIC_BYTES) != 0) {
+        throw std::runtime_error(path + " is not a bank image");
+    }
+    uint32_t header_length = length_bytes[0] | length_bytes[1] << 8 | length_bytes[2] << 16 | (uint32_t) length_bytes[3] << 24;
+    std::string text(header_length, '\0');
+    file.read(&text[0], header_length);
+    if (!file) {
+        throw std::runtime_error("bank image " + path + " has a truncated header");
+    }
+
+    ConfigurationReader reader(text);
+    if ((int) reader.number("image.version") != BANK_IMAGE_VERSION) {
+        throw std::runtime_error("bank image " + path + " has an unsupported version");
+    }
+    BankImageHeader header;
+    header.bank_rows = (int) reader.number("image.bank_rows");
+    header.row_buffer_size_bytes = (int) reader.number("image.row_buffer_size_bytes");
+    header.compression = reader.text("image.compression");
+    header.data_offset = bank_image_data_offset(header_length);
+    return header;
+}
+
+// Map the rows of a bank image into `bank`, copy-on-write; the image must match the layout dimensions
+inline void map_bank_image(Bank& bank, const std::string& path, const LayoutConfiguration& layout) {
+    BankImageHeader header = read_bank_image_header(path);
+    if (header.compression != "none") {
+        throw std::runtime_error("bank image " + path + " is " + header.compression
+                                 + " compressed, save it uncompressed to map it");
+    }
+    if (header.bank_rows != layout.bank_rows || header.row_buffer_size_bytes != layout.row_buffer_size_bytes) {
+        throw std::runtime_error("bank image " + path + " does not match the configured bank dimensions");
+    }
+    bank.map_image(path, header.bank_rows, header.row_buffer_size_bytes, header.data_offset);
+}
+
+// Write the bank as an uncompressed bank image
+inline void write_bank_image(const std::string& path, const Bank& bank, const LayoutConfiguration& layout) {
+    std::string header = "{\"hardware\": " + (layout.hardware_json.empty() ? std::string("{}") : layout.hardware_json)
+        + ", \"image\": {\"version\": " + std::to_string(BANK_IMAGE_VERSION)
+        + ", \"bank_rows\": " + std::to_string(bank.rows())
+        + ", \"row_buffer_size_bytes\": " + std::to_string(bank.row_buffer_bytes())
+        + ", \"compression\": \"none\"}}";
+    uint32_t header_length = (uint32_t) header.size();
+    uint8_t length_bytes[4] = {
+        (uint8_t) header_length, (uint8_t)(header_length >> 8), (uint8_t)(header_length >> 16), (uint8_t)(header_length >> 24)
+    };
+    std::vector<char> padding(bank_image_data_offset(header_length) - BANK_IMAGE_MAGIC_BYTES - 4 - header_length, 0);
+
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file.write(BANK_IMAGE_MAGIC, BANK_IMAGE_MAGIC_BYTES);
+    file.write((const char*) length_bytes, 4);
+    file.write(header.data(), header.size());
+    file.write(padding.data(), padding.size());
+    file.write((const char*) bank.data(), bank.size_bytes());
+    if (!file) {
+        throw std::runtime_error("unable to write bank image " + path);
+    }
+}
+
+#endif // BLIMP_BANK_IMAGE_H
@@ -0,0 +1,265 @@
+#ifndef BLIMP_CONFIGURATION_H
+#define BLIMP_CONFIGURATION_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Runtime layout of a BLIMP/Ambit bank, as saved by BlimpBankLayoutConfiguration.save / configuration.json
+struct LayoutConfiguration {
+    // Hardware Specifics
+    long long bank_size_bytes;
+    int row_buffer_size_bytes;
+    int bank_rows;
+
+    // Database Specifics
+    int hitmap_count;
+    int total_index_size_bytes;
+    int total_record_size_bytes;
+    int total_data_size_bytes;
+
+    // Hardware block as JSON text, embedded into bank images written by the compliance tools
+    std::string hardware_json;
+
+    // PI/Key layout, see BlimpDatabaseConfiguration.pi_layout; "column_packed" and "columnar" layouts keep their
+    // PI/Keys packed back to back in the PI field rows, and "columnar" records hold only their (end padded) data
+    std::string pi_layout;
+    // The bytes each record takes in the records region, see BlimpBankLayoutConfiguration.stored_record_size_bytes
+    int stored_record_size_bytes;
+
+    // Layout Specifics
+    int total_rows_for_pi_field;
+    int total_rows_for_records;
+    int total_rows_for_hitmaps;
+    int total_records_processable;
+    int pi_field_base_row;
+    int record_base_row;
+    int hitmap_base_row;
+
+    LayoutConfiguration() : pi_layout("horizontal"), total_rows_for_pi_field(0), pi_field_base_row(0) {}
+
+    int records_per_row() const { return row_buffer_size_bytes / stored_record_size_bytes; }
+    int rows_per_record() const { return stored_record_size_bytes / row_buffer_size_bytes; }
+    int rows_per_hitmap() const { return total_rows_for_hitmaps / hitmap_count; }
+    int hitmap_row(int hitmap_index) const { return hitmap_base_row + rows_per_hitmap() * hitmap_index; }
+
+    // Where PI/Key scans read from, see BlimpBankLayoutConfiguration.pi_location; the packed PI/Key column when
+    // there is one, one PI/Key per key stride, otherwise the records themselves
+    bool packed_pi_fields() const { return pi_layout == "column_packed" || pi_layout == "columnar"; }
+    int key_base_row() const { return packed_pi_fields() ? pi_field_base_row : record_base_row; }
+    int key_stride_bytes() const { return packed_pi_fields() ? total_index_size_bytes : stored_record_size_bytes; }
+    int key_end_row() const {
+        return packed_pi_fields() ? pi_field_base_row + total_rows_for_pi_field : hitmap_base_row;
+    }
+    int keys_per_row() const { return row_buffer_size_bytes / key_stride_bytes(); }
+    int rows_per_key() const { return key_stride_bytes() / row_buffer_size_bytes; }
+    int key_row(int record_index) const {
+        return keys_per_row() > 0 ? key_base_row() + record_index / keys_per_row()
+                                  : key_base_row() + record_index * rows_per_key();
+    }
+
+    // Where a record field is stored, see BlimpBankLayoutConfiguration.field_region; columnar layouts keep the
+    // PI/Key field in the PI/Key column and only the data field with the records
+    void field_region(int field_offset_bytes, int& base_row, int& stride_bytes, int& offset_bytes) const {
+        if (pi_layout == "columnar" && field_offset_bytes < total_index_size_bytes) {
+            base_row = pi_field_base_row;
+            stride_bytes = total_index_size_bytes;
+            offset_bytes = field_offset_bytes;
+        }
+        else {
+            base_row = record_base_row;
+            stride_bytes = stored_record_size_bytes;
+            offset_bytes = pi_layout == "columnar" ? field_offset_bytes - total_index_size_bytes : field_offset_bytes;
+        }
+    }
+};
+
+// Row buffer aligned size of a columnar record's data, mirroring BlimpBankLayoutConfiguration.stored_record_size_bytes
+inline int columnar_record_size_bytes(int total_data_size_bytes, int row_buffer_size_bytes) {
+    if (total_data_size_bytes > row_buffer_size_bytes) {
+        return (total_data_size_bytes + row_buffer_size_bytes - 1) / row_buffer_size_bytes * row_buffer_size_bytes;
+    }
+    int size = total_data_size_bytes;
+    while (row_buffer_size_bytes % size != 0) {
+        size++;
+    }
+    return size;
+}
+
+// Minimal JSON reader for configuration files; flattens nested objects of scalars into "block.key" entries, and
+// keeps the text of each nested object under its own key
+class ConfigurationReader {
+public:
+    explicit ConfigurationReader(const std::string& text) : text_(text), position_(0) {
+        skip_whitespace();
+        parse_value("");
+    }
+
+    bool has(const std::string& key) const { return values_.count(key) > 0; }
+
+    double number(const std::string& key) const {
+        std::map<std::string, std::string>::const_iterator it = values_.find(key);
+        if (it == values_.end()) {
+            throw std::runtime_error("configuration is missing '" + key + "'");
+        }
+        return strtod(it->second.c_str(), NULL);
+    }
+
+    double number(const std::string& key, double fallback) const {
+        return has(key) ? number(key) : fallback;
+    }
+
+    const std::string& text(const std::string& key) const {
+        std::map<std::string, std::string>::const_iterator it = values_.find(key);
+        if (it == values_.end()) {
+            throw std::runtime_error("configuration is missing '" + key + "'");
+        }
+        return it->second;
+    }
+
+    // The unparsed JSON text of a nested object, e.g. "hardware"
+    const std::string& object(const std::string& key) const { return text(key); }
+
+private:
+    void skip_whitespace() {
+        while (position_ < text_.size() && isspace((unsigned char) text_[position_])) {
+            position_++;
+        }
+    }
+
+    void expect(char c) {
+        skip_whitespace();
+        if (position_ >= text_.size() || text_[position_] != c) {
+            throw std::runtime_error(std::string("malformed configuration, expected '") + c + "'");
+        }
+        position_++;
+        skip_whitespace();
+    }
+
+    std::string parse_string() {
+        expect('"');
+        std::string result;
+        while (position_ < text_.size() && text_[position_] != '"') {
+            if (text_[position_] == '\\') {
+                position_++;
+            }
+            result += text_[position_++];
+        }
+        expect('"');
+        return result;
+    }
+
+    void parse_value(const std::string& key) {
+        skip_whitespace();
+        if (position_ >= text_.size()) {
+            throw std::runtime_error("malformed configuration, unexpected end of file");
+        }
+        char c = text_[position_];
+        if (c == '{') {
+            size_t start = position_;
+            expect('{');
+            while (text_[position_] != '}') {
+                std::string name = parse_string();
+                expect(':');
+                parse_value(key.empty() ? name : key + "." + name);
+                skip_whitespace();
+                if (text_[position_] == ',') {
+                    expect(',');
+                }
+            }
+            size_t end = position_ + 1;
+            expect('}');
+            if (!key.empty()) {
+                values_[key] = text_.substr(start, end - start);
+            }
+        }
+        else if (c == '[') {
+            // Arrays are not part of the layout, skip over them
+            expect('[');
+            while (text_[position_] != ']') {
+                parse_value("");
+                if (text_[position_] == ',') {
+                    expect(',');
+                }
+            }
+            expect(']');
+        }
+        else if (c == '"') {
+            values_[key] = parse_string();
+        }
+        else {
+            size_t start = position_;
+            while (position_ < text_.size() && text_[position_] != ',' && text_[position_] != '}'
+                   && text_[position_] != ']' && !isspace((unsigned char) text_[position_])) {
+                position_++;
+            }
+            std::string token = text_.substr(start, position_ - start);
+            values_[key] = token == "true" ? "1" : token == "false" || token == "null" ? "0" : token;
+            skip_whitespace();
+        }
+    }
+
+    std::string text_;
+    size_t position_;
+    std::map<std::string, std::string> values_;
+};
+
+// Derive the row layout from parsed configuration blocks, mirroring BlimpBankLayoutConfiguration.address_mapping
+inline LayoutConfiguration layout_from_reader(const ConfigurationReader& reader) {
+    LayoutConfiguration layout;
+    layout.bank_size_bytes = (long long) reader.number("hardware.bank_size_bytes");
+    layout.row_buffer_size_bytes = (int) reader.number("hardware.row_buffer_size_bytes");
+    layout.bank_rows = (int) reader.number("hardware.bank_rows", (double)(layout.bank_size_bytes / layout.row_buffer_size_bytes));
+    layout.hardware_json = reader.object("hardware");
+
+    layout.hitmap_count = (int) reader.number("database.hitmap_count");
+    layout.total_index_size_bytes = (int) reader.number("database.total_index_size_bytes");
+    layout.total_record_size_bytes = (int) reader.number("database.total_record_size_bytes");
+    layout.total_data_size_bytes = layout.total_record_size_bytes - layout.total_index_size_bytes;
+    layout.pi_layout = reader.has("database.pi_layout") ? reader.text("database.pi_layout") : "horizontal";
+    layout.stored_record_size_bytes = layout.pi_layout == "columnar"
+        ? columnar_record_size_bytes(layout.total_data_size_bytes, layout.row_buffer_size_bytes)
+        : layout.total_record_size_bytes;
+
+    layout.total_rows_for_pi_field = (int) reader.number("meta.total_rows_for_pi_field", 0);
+    layout.total_rows_for_records = (int) reader.number("meta.total_rows_for_records");
+    layout.total_rows_for_hitmaps = (int) reader.number("meta.total_rows_for_hitmaps");
+    layout.total_records_processable = (int) reader.number("meta.total_records_processable");
+
+    // BLIMP code region, then the PI constants and bit sliced or column packed PI field copy, or the Ambit PI field
+    // and temporary rows (when present), then records and hitmaps
+    layout.pi_field_base_row = (int) reader.number("meta.total_rows_for_blimp_code_region")
+        + (int) reader.number("meta.total_rows_for_pi_constants", 0);
+    layout.record_base_row = layout.pi_field_base_row
+        + layout.total_rows_for_pi_field
+        + (int) reader.number("meta.total_rows_for_ambit_pi_field", 0)
+        + (int) reader.number("meta.total_rows_for_temporary_ambit_compute", 0);
+    layout.hitmap_base_row = layout.record_base_row + layout.total_rows_for_records;
+
+    if (layout.hitmap_count <= 0 || layout.rows_per_hitmap() * layout.row_buffer_size_bytes * 8LL
+        < layout.total_records_processable) {
+        throw std::runtime_error("configuration hitmaps cannot hold every processable record");
+    }
+    if (layout.hitmap_base_row + layout.total_rows_for_hitmaps > layout.bank_rows) {
+        throw std::runtime_error("configuration layout does not fit in the bank");
+    }
+    return layout;
+}
+
+// Load a layout from a study configuration.json
+inline LayoutConfiguration load_layout_configuration(const std::string& path) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        throw std::runtime_error("unable to open configuration " + path);
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return layout_from_reader(ConfigurationReader(text.str()));
+}
+
+#endif // BLIMP_CONFIGURATION_H
@@ -0,0 +1,87 @@
+#ifndef BLIMP_CYCLE_ACCOUNTING_H
+#define BLIMP_CYCLE_ACCOUNTING_H
+
+#include <stdio.h>
+#include <string>
+
+#include "configuration.h"
+
+// Hardware operation counters, the native counterpart of RuntimeResult.counters in src/simulators/result.py.
+// Kernels count the operations the simulated BLIMP program would issue, so a compliance run reports the same
+// counters, and through CycleTiming the same runtime, as the Python simulator for the same query and layout.
+struct CycleCounters {
+    long long row_activate;
+    long long precharge;
+    long long column_access;
+    long long v0_transfer;
+    long long blimp_cycle;
+    long long tra;
+    long long aap;
+    // Row command time hidden by overlapping subarrays (see RowBufferTiming), not charged to the runtime
+    double overlapped_ns;
+
+    CycleCounters() : row_activate(0), precharge(0), column_access(0), v0_transfer(0), blimp_cycle(0), tra(0),
+                      aap(0), overlapped_ns(0) {}
+
+    CycleCounters& operator+=(const CycleCounters& other) {
+        row_activate += other.row_activate;
+        precharge += other.precharge;
+        column_access += other.column_access;
+        v0_transfer += other.v0_transfer;
+        blimp_cycle += other.blimp_cycle;
+        tra += other.tra;
+        aap += other.aap;
+        overlapped_ns += other.overlapped_ns;
+        return *this;
+    }
+};
+
+// Per-operation timings, read from the hardware block of a configuration
+struct CycleTiming {
+    double row_activate_ns;
+    double precharge_ns;
+    double column_access_ns;
+    double v0_transfer_ns;
+    double blimp_cycle_ns;
+    double tra_ns;
+    double aap_ns;
+
+    // The modeled runtime; every operation is charged its own latency, less the row command time subarrays overlap
+    double runtime_ns(const CycleCounters& counters) const {
+        return counters.row_activate * row_activate_ns + counters.precharge * precharge_ns
+            + counters.column_access * column_access_ns + counters.v0_transfer * v0_transfer_ns
+            + counters.blimp_cycle * blimp_cycle_ns + counters.tra * tra_ns + counters.aap * aap_ns
+            - counters.overlapped_ns;
+    }
+};
+
+inline CycleTiming timing_from_hardware(const std::string& hardware_json) {
+    ConfigurationReader reader(hardware_json.empty() ? std::string("{}") : hardware_json);
+    CycleTiming timing;
+    timing.row_activate_ns = reader.number("time_to_row_activate_ns", 0);
+    timing.precharge_ns = reader.number("time_to_precharge_ns", 0);
+    timing.column_access_ns = reader.number("time_to_column_activate_ns", 0);
+    timing.v0_transfer_ns = reader.number("time_to_v0_transfer_ns", 0);
+    double frequency = reader.number("blimp_frequency", 0);
+    timing.blimp_cycle_ns = reader.number("time_per_blimp_cycle_ns", frequency > 0 ? 1e9 / frequency : 0);
+    timing.tra_ns = reader.number("time_for_TRA_MAJ_ns", 0);
+    timing.aap_ns = reader.number("time_for_AAP_rowclone_ns", 0);
+    return timing;
+}
+
+// Counters and the runtime they model as a JSON object, keyed like RuntimeResult categories
+inline std::string cycle_report_json(const CycleCounters& counters, const CycleTiming& timing) {
+    char report[512];
+    snprintf(report, sizeof(report), "{\"runtime_ns\": %.6f, \"overlapped_ns\": %.6f, \"counters\": "
+             "{\"row_activate\": %lld, \"precharge\": %lld, \"column_access\": %lld, \"v0_transfer\": %lld, "
+             "\"blimp_cycle\": %lld, \"tra\": %lld, \"aap\": %lld}}",
+             timing.runtime_ns(counters), counters.overlapped_ns, counters.row_activate, counters.precharge,
+             counters.column_access, counters.v0_transfer, counters.blimp_cycle, counters.tra, counters.aap);
+    return report;
+}
+
+inline void print_cycle_report(FILE* stream, const CycleCounters& counters, const CycleTiming& timing) {
+    fprintf(stream, "%s\n", cycle_report_json(counters, timing).c_str());
+}
+
+#endif // BLIMP_CYCLE_ACCOUNTING_H
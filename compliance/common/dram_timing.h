@@ -0,0 +1,133 @@
+#ifndef BLIMP_DRAM_TIMING_H
+#define BLIMP_DRAM_TIMING_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "configuration.h"
+#include "cycle_accounting.h"
+
+// Row buffer state of a bank and the operations accessing a row costs, the native counterpart of RowBufferTiming
+// in src/simulators/dram_timing.py. The bank is split into subarrays of consecutive rows, each keeping one row open
+// in its own row buffer. Under the closed page policy every access activates its row and precharges it again; under
+// the open page policy rows stay open, an access to the open row of its subarray is a column access and any other
+// access precharges the open row of its subarray (if any) before activating its own.
+//
+// Every subarray keeps its own timeline; row commands issue one after another and start once their subarray is
+// ready, so a precharge left behind in one subarray overlaps the activations in others. Operations are still counted
+// in full, the time the overlap hides is kept in CycleCounters::overlapped_ns and taken off the modeled runtime.
+struct RowBufferTiming {
+    bool open_page;
+    int rows_per_subarray;
+    double activate_ns;
+    double precharge_ns;
+    double column_access_ns;
+    std::vector<int> open_rows;     // The open row of every subarray, -1 while precharged
+    std::vector<double> ready_ns;   // When every subarray is ready for its next activation
+    double issue_ns;                // When the next row command may issue
+    double horizon_ns;              // When every subarray is ready again, what the accesses so far are charged
+
+    RowBufferTiming() : open_page(false), rows_per_subarray(1), activate_ns(0), precharge_ns(0), column_access_ns(0),
+                        open_rows(1, -1), ready_ns(1, 0), issue_ns(0), horizon_ns(0) {}
+
+    int subarray(int row) const {
+        return row / rows_per_subarray;
+    }
+
+    // Forget every open row, as if the bank was precharged without charging it
+    void reset() {
+        open_rows.assign(open_rows.size(), -1);
+        ready_ns.assign(open_rows.size(), 0);
+        issue_ns = 0;
+        horizon_ns = 0;
+    }
+
+    // Keep a subarray busy for busy_ns from start_ns; whatever of busy_ns that leaves before the time every subarray
+    // is ready again overlaps other work
+    void occupy(CycleCounters& counters, int subarray, double start_ns, double busy_ns) {
+        double charged_ns = std::max(0.0, (start_ns - horizon_ns) + busy_ns);
+        counters.overlapped_ns += busy_ns - charged_ns;
+        ready_ns[subarray] = start_ns + busy_ns;
+        horizon_ns += charged_ns;
+    }
+
+    void access(CycleCounters& counters, int row) {
+        int accessed = subarray(row);
+        double start_ns = std::max(ready_ns[accessed], issue_ns);
+        if (!open_page) {
+            // The precharge closing the row runs on in its subarray while the next command issues
+            counters.row_activate += 1;
+            counters.precharge += 1;
+            issue_ns = start_ns + activate_ns;
+            occupy(counters, accessed, start_ns, activate_ns + precharge_ns);
+            return;
+        }
+        int& open_row = open_rows[accessed];
+        double busy_ns;
+        if (open_row == row) {
+            counters.column_access += 1;
+            busy_ns = column_access_ns;
+        }
+        else if (open_row >= 0) {
+            counters.precharge += 1;
+            counters.row_activate += 1;
+            busy_ns = precharge_ns + activate_ns;
+        }
+        else {
+            counters.row_activate += 1;
+            busy_ns = activate_ns;
+        }
+        open_row = row;
+        issue_ns = start_ns + busy_ns;
+        occupy(counters, accessed, start_ns, busy_ns);
+    }
+
+    // A row moved between memory and a BLIMP register through v0, as blimp_load_register/blimp_save_register
+    void register_transfer(CycleCounters& counters, int row) {
+        counters.blimp_cycle += 1;
+        counters.v0_transfer += 1;
+        access(counters, row);
+    }
+
+    // Close every open row together, charging their precharge; the next command waits until all are closed
+    void precharge_all(CycleCounters& counters) {
+        double issued_ns = issue_ns;
+        for (size_t closed = 0; closed < open_rows.size(); closed++) {
+            if (open_rows[closed] >= 0) {
+                counters.precharge += 1;
+                open_rows[closed] = -1;
+                occupy(counters, (int) closed, std::max(ready_ns[closed], issued_ns), precharge_ns);
+                issue_ns = std::max(issue_ns, ready_ns[closed]);
+            }
+        }
+    }
+};
+
+// Read the row buffer policy, subarrays and row command latencies of a hardware configuration; the policy and
+// subarrays default to the closed page, single subarray bank every access is charged the same for
+inline RowBufferTiming row_buffer_from_hardware(const std::string& hardware_json, int bank_rows) {
+    ConfigurationReader reader(hardware_json.empty() ? std::string("{}") : hardware_json);
+    std::string policy = reader.has("row_buffer_policy") ? reader.text("row_buffer_policy") : std::string("closed");
+    if (policy != "closed" && policy != "open") {
+        throw std::runtime_error("unknown row buffer policy '" + policy + "', expected 'closed' or 'open'");
+    }
+    int subarrays = (int) reader.number("subarrays_per_bank", 1);
+    if (subarrays < 1) {
+        throw std::runtime_error("a bank has at least one subarray");
+    }
+
+    RowBufferTiming timing;
+    timing.open_page = policy == "open";
+    timing.activate_ns = reader.number("time_to_row_activate_ns", 0);
+    timing.precharge_ns = reader.number("time_to_precharge_ns", 0);
+    timing.column_access_ns = reader.number("time_to_column_activate_ns", 0);
+    int rows = (int) reader.number("bank_rows", bank_rows);
+    timing.rows_per_subarray = rows > subarrays ? (rows + subarrays - 1) / subarrays : 1;
+    timing.open_rows.assign(subarrays, -1);
+    timing.ready_ns.assign(subarrays, 0);
+    return timing;
+}
+
+#endif // BLIMP_DRAM_TIMING_H
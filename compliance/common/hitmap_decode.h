@@ -0,0 +1,96 @@
+#ifndef BLIMP_HITMAP_DECODE_H
+#define BLIMP_HITMAP_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Decodes a hitmap, the layout HitmapWriter produces (the first record in the MSB of the first byte), into the
+// sorted indexes of its 1-bits.
+//
+// The hitmap is read as big endian 64-bit words: a popcount per word sizes the result, and the hits of a word are
+// peeled off with count-leading-zeros, so cost scales with the number of words plus the number of hits rather than
+// the number of bits. Only the first `bits` records are decoded, the padding bits past them are masked off.
+// Two hitmaps are compared the same way, a popcount of the XOR of every pair of words counting the records they
+// disagree on.
+
+// Load the 64-bit word at `hitmap`, most significant byte first
+inline uint64_t load_hitmap_word(const uint8_t* hitmap) {
+    uint64_t word;
+    memcpy(&word, hitmap, 8);
+    return __builtin_bswap64(word);
+}
+
+// Load the last, partial, word of a hitmap; `bytes` (< 8) bytes are available and `bits` of them are records
+inline uint64_t load_partial_hitmap_word(const uint8_t* hitmap, size_t bytes, size_t bits) {
+    uint64_t word = 0;
+    for (size_t byte = 0; byte < bytes; byte++) {
+        word |= (uint64_t) hitmap[byte] << (56 - 8 * byte);
+    }
+    return bits ? word & (~0ULL << (64 - bits)) : 0;
+}
+
+// Decode the first `bits` records of a hitmap and return how many are hits. Indexes are written to `indexes`,
+// which must hold at least that many, unless it is NULL in which case the hits are only counted.
+inline size_t decode_hitmap(const uint8_t* hitmap, size_t bits, int* indexes) {
+    size_t hits = 0;
+    size_t full_words = bits / 64;
+    for (size_t w = 0; w <= full_words; w++) {
+        uint64_t word;
+        if (w < full_words) {
+            word = load_hitmap_word(hitmap + w * 8);
+        }
+        else {
+            size_t tail_bits = bits % 64;
+            word = load_partial_hitmap_word(hitmap + w * 8, (tail_bits + 7) / 8, tail_bits);
+        }
+        if (!indexes) {
+            hits += __builtin_popcountll(word);
+            continue;
+        }
+        int base = (int) (w * 64);
+        while (word) {
+            int bit = __builtin_clzll(word);
+            indexes[hits++] = base + bit;
+            word &= ~(1ULL << (63 - bit));
+        }
+    }
+    return hits;
+}
+
+// Compare the first `bits` records of two hitmaps and return how many records differ. The first `limit` differing
+// record indexes are written to `mismatches`, in order; words only get peeled for indexes while those are wanted,
+// so hitmaps that (mostly) agree compare at the speed of the memory.
+inline size_t diff_hitmaps(const uint8_t* a, const uint8_t* b, size_t bits, long long* mismatches, size_t limit) {
+    size_t differing = 0;
+    size_t full_words = bits / 64;
+    for (size_t w = 0; w <= full_words; w++) {
+        uint64_t word;
+        if (w < full_words) {
+            uint64_t x, y;
+            memcpy(&x, a + w * 8, 8);
+            memcpy(&y, b + w * 8, 8);
+            if (x == y) {
+                continue;
+            }
+            word = __builtin_bswap64(x ^ y);
+        }
+        else {
+            size_t tail_bits = bits % 64;
+            size_t tail_bytes = (tail_bits + 7) / 8;
+            word = load_partial_hitmap_word(a + w * 8, tail_bytes, tail_bits)
+                 ^ load_partial_hitmap_word(b + w * 8, tail_bytes, tail_bits);
+        }
+        size_t found = differing;
+        differing += __builtin_popcountll(word);
+        long long base = (long long) (w * 64);
+        while (word && found < limit) {
+            int bit = __builtin_clzll(word);
+            mismatches[found++] = base + bit;
+            word &= ~(1ULL << (63 - bit));
+        }
+    }
+    return differing;
+}
+
+#endif // BLIMP_HITMAP_DECODE_H
@@ -0,0 +1,89 @@
+#ifndef BLIMP_HITMAP_WRITER_H
+#define BLIMP_HITMAP_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__SSE2__)
+#include <immintrin.h>
+#define HITMAP_WRITER_STREAMING 1
+#else
+#define HITMAP_WRITER_STREAMING 0
+#endif
+
+// Streams 64-bit hitmap words straight into consecutive hitmap rows of bank memory.
+//
+// Hitmap rows of one hitmap are contiguous in the bank, so words are written back to back from the first row of
+// the writer's range without staging a row in v0. Words are stored most significant byte first (the first record
+// in the MSB of the first byte) with non-temporal stores where available: the hitmap is never read back by the
+// scan, so it should not evict the records being scanned from cache. finish() pads the last partial word and the
+// rest of its row with 1-bits in one fill.
+//
+// Optionally the writer also collects the index of every matching record as words arrive, so a caller that only
+// wants the hits needs no second pass over the hitmap; with write_hitmap disabled the hitmap is left untouched.
+class HitmapWriter {
+public:
+    // first_record is the record index of bit 63 of the first word; hitmap points at its hitmap row
+    HitmapWriter(uint8_t* hitmap, int row_buffer_bytes, int first_record, bool write_hitmap = true,
+                 std::vector<int>* indexes = NULL)
+        : hitmap_(hitmap), row_buffer_bytes_(row_buffer_bytes), record_(first_record), written_bytes_(0),
+          write_hitmap_(write_hitmap), indexes_(indexes) {}
+
+    // Append `count` (<= 64) record bits held MSB aligned in `hitword`; bits below them are ignored
+    inline void write(uint64_t hitword, int count) {
+        uint64_t records_mask = count < 64 ? ~0ULL << (64 - count) : ~0ULL;
+        if (indexes_) {
+            uint64_t hits = hitword & records_mask;
+            while (hits) {
+                int bit = __builtin_clzll(hits);
+                indexes_->push_back(record_ + bit);
+                hits &= ~(1ULL << (63 - bit));
+            }
+        }
+        if (write_hitmap_) {
+            // A partial final word is padded with 1-bits
+            store_word(hitword | ~records_mask);
+        }
+        record_ += count;
+        written_bytes_ += 8;
+    }
+
+    // Pad the rest of the row the last word landed in with 1-bits and drain the streaming stores
+    void finish() {
+        size_t tail = written_bytes_ % row_buffer_bytes_;
+        if (write_hitmap_ && tail != 0) {
+            memset(hitmap_ + written_bytes_, 0xFF, row_buffer_bytes_ - tail);
+        }
+#if HITMAP_WRITER_STREAMING
+        _mm_sfence();
+#endif
+    }
+
+    // Hitmap rows the words so far landed in
+    size_t written_rows() const {
+        return (written_bytes_ + row_buffer_bytes_ - 1) / row_buffer_bytes_;
+    }
+
+private:
+    inline void store_word(uint64_t hitword) {
+        uint8_t* destination = hitmap_ + written_bytes_;
+#if HITMAP_WRITER_STREAMING
+        _mm_stream_si64((long long*) destination, (long long) __builtin_bswap64(hitword));
+#else
+        for (int byte = 0; byte < 8; byte++) {
+            destination[byte] = (uint8_t)(hitword >> (56 - 8 * byte));
+        }
+#endif
+    }
+
+    uint8_t* hitmap_;
+    size_t row_buffer_bytes_;
+    int record_;
+    size_t written_bytes_;
+    bool write_hitmap_;
+    std::vector<int>* indexes_;
+};
+
+#endif // BLIMP_HITMAP_WRITER_H
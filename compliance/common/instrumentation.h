@@ -0,0 +1,189 @@
+#ifndef BLIMP_INSTRUMENTATION_H
+#define BLIMP_INSTRUMENTATION_H
+
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define INSTRUMENTATION_PERF_EVENTS 1
+#else
+#define INSTRUMENTATION_PERF_EVENTS 0
+#endif
+
+#include "cycle_accounting.h"
+
+// Instrumentation of the compliance tools themselves, as opposed to the hardware they model: wall time and hardware
+// counters of every phase of a run, and counts of the native engine's own work. A profile tells what the host spent
+// simulating a query apart from the runtime the cycle model charges the modeled BLIMP hardware for it.
+
+// Native engine events, counted where the engine does the work rather than where the modeled program would
+struct EngineEvents {
+    long long row_loads;      // Rows a worker opened to compare the keys in them
+    long long row_hits;       // Records served out of the row already in the row buffer
+    long long hitmap_flushes; // Hitmap rows written back to bank memory
+    double hitmap_flush_ns;   // Padding the last hitmap rows and draining their streaming stores, summed over workers
+
+    EngineEvents() : row_loads(0), row_hits(0), hitmap_flushes(0), hitmap_flush_ns(0) {}
+
+    EngineEvents& operator+=(const EngineEvents& other) {
+        row_loads += other.row_loads;
+        row_hits += other.row_hits;
+        hitmap_flushes += other.hitmap_flushes;
+        hitmap_flush_ns += other.hitmap_flush_ns;
+        return *this;
+    }
+};
+
+inline double wall_clock_ns() {
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Hardware counters of the process through perf_event_open. Counters are user space only and inherited by the
+// threads the process starts, so a phase counts its scan workers once they are joined. Counters the kernel (or a
+// virtualized host) does not offer read as -1, and are left out of the profile
+class PerfCounters {
+public:
+    static const int COUNT = 4;
+
+    PerfCounters() {
+#if INSTRUMENTATION_PERF_EVENTS
+        const uint64_t configs[COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                         PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int counter = 0; counter < COUNT; counter++) {
+            descriptors_[counter] = open_counter(configs[counter]);
+        }
+#else
+        for (int counter = 0; counter < COUNT; counter++) {
+            descriptors_[counter] = -1;
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#if INSTRUMENTATION_PERF_EVENTS
+        for (int counter = 0; counter < COUNT; counter++) {
+            if (descriptors_[counter] >= 0) {
+                close(descriptors_[counter]);
+            }
+        }
+#endif
+    }
+
+    static const char* name(int counter) {
+        static const char* names[COUNT] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+        return names[counter];
+    }
+
+    // The counts so far, scaled up for the time a multiplexed counter was not scheduled
+    void read(long long* values) const {
+        for (int counter = 0; counter < COUNT; counter++) {
+            values[counter] = -1;
+#if INSTRUMENTATION_PERF_EVENTS
+            uint64_t reading[3];
+            if (descriptors_[counter] >= 0 &&
+                ::read(descriptors_[counter], reading, sizeof(reading)) == (ssize_t) sizeof(reading)) {
+                values[counter] = reading[2] > 0 && reading[2] < reading[1]
+                    ? (long long)((double) reading[0] * reading[1] / reading[2]) : (long long) reading[0];
+            }
+#endif
+        }
+    }
+
+private:
+    PerfCounters(const PerfCounters&);
+    PerfCounters& operator=(const PerfCounters&);
+
+#if INSTRUMENTATION_PERF_EVENTS
+    static int open_counter(uint64_t config) {
+        struct perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = config;
+        attributes.inherit = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return (int) syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+    }
+#endif
+
+    int descriptors_[COUNT];
+};
+
+// Phases of a run, each with its wall time and the hardware counters it advanced. Phases run one after another;
+// begin() ends the running phase, if any
+class PhaseProfiler {
+public:
+    PhaseProfiler() : running_(false), started_ns_(wall_clock_ns()) {}
+
+    void begin(const std::string& name) {
+        end();
+        Phase phase;
+        phase.name = name;
+        phase.wall_ns = -wall_clock_ns();
+        counters_.read(phase.counters);
+        phases_.push_back(phase);
+        running_ = true;
+    }
+
+    void end() {
+        if (!running_) {
+            return;
+        }
+        Phase& phase = phases_.back();
+        long long counters[PerfCounters::COUNT];
+        counters_.read(counters);
+        phase.wall_ns += wall_clock_ns();
+        for (int counter = 0; counter < PerfCounters::COUNT; counter++) {
+            phase.counters[counter] = phase.counters[counter] < 0 || counters[counter] < 0
+                ? -1 : counters[counter] - phase.counters[counter];
+        }
+        running_ = false;
+    }
+
+    // The profile as a JSON object; phases with their wall time and hardware counters, the native engine events,
+    // and the operations and runtime the cycle model charged, keyed like RuntimeResult categories
+    std::string json(const EngineEvents& events, const CycleCounters& modeled, const CycleTiming& timing) {
+        end();
+        std::ostringstream stream;
+        stream.precision(15);
+        stream << "{\"wall_ns\": " << wall_clock_ns() - started_ns_ << ", \"phases\": {";
+        for (size_t index = 0; index < phases_.size(); index++) {
+            const Phase& phase = phases_[index];
+            stream << (index ? ", " : "") << "\"" << phase.name << "\": {\"wall_ns\": " << phase.wall_ns;
+            for (int counter = 0; counter < PerfCounters::COUNT; counter++) {
+                if (phase.counters[counter] >= 0) {
+                    stream << ", \"" << PerfCounters::name(counter) << "\": " << phase.counters[counter];
+                }
+            }
+            stream << "}";
+        }
+        stream << "}, \"events\": {\"row_loads\": " << events.row_loads << ", \"row_hits\": " << events.row_hits
+               << ", \"hitmap_flushes\": " << events.hitmap_flushes << ", \"hitmap_flush_ns\": "
+               << events.hitmap_flush_ns << "}, \"modeled\": " << cycle_report_json(modeled, timing) << "}";
+        return stream.str();
+    }
+
+private:
+    struct Phase {
+        std::string name;
+        double wall_ns;
+        long long counters[PerfCounters::COUNT];
+    };
+
+    PerfCounters counters_;
+    std::vector<Phase> phases_;
+    bool running_;
+    double started_ns_;
+};
+
+#endif // BLIMP_INSTRUMENTATION_H
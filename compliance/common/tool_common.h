@@ -0,0 +1,217 @@
+#ifndef BLIMP_TOOL_COMMON_H
+#define BLIMP_TOOL_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bank.h"
+#include "bank_image.h"
+#include "configuration.h"
+
+// Scaffolding shared by the compliance tools (blimp_equality, blimp_range, blimp_aggregate); the built-in layout,
+// bank creation, the open row of a scan, memory dumps, index files, value parsing and the options every tool takes.
+//
+// Each tool is a single translation unit that defines the layout and bank it runs on; the helpers here work on those.
+extern LayoutConfiguration layout;
+extern Bank memory;
+
+// Default layout when no configuration.json is given; 32MB bank, 1KB row buffer, 8B index, 512B records
+inline LayoutConfiguration default_layout() {
+    LayoutConfiguration layout;
+    layout.bank_size_bytes = 33554432;
+    layout.row_buffer_size_bytes = 1024;
+    layout.bank_rows = 32768;  // bank size / row buffer
+    layout.hardware_json = "{\"bank_size_bytes\": 33554432, \"row_buffer_size_bytes\": 1024, "
+        "\"time_to_row_activate_ns\": 33.0, \"time_to_column_activate_ns\": 15.0, \"time_to_precharge_ns\": 14.06, "
+        "\"bank_rows\": 32768, \"blimp_frequency\": 200000000, \"time_to_v0_transfer_ns\": 5.0, \"number_of_vALUs\": 128, "
+        "\"number_of_vFPUs\": 0, \"blimpv_sew_max_bytes\": 8, \"blimpv_sew_min_bytes\": 1, \"processor_bit_architecture\": 64, "
+        "\"time_per_blimp_cycle_ns\": 5.0}";
+    layout.hitmap_count = 3;
+    layout.total_index_size_bytes = 8;
+    layout.total_record_size_bytes = 512;
+    layout.total_data_size_bytes = 504;  // record size - index size
+    layout.stored_record_size_bytes = 512;
+    layout.total_rows_for_records = 32220;
+    layout.total_rows_for_hitmaps = 24;
+    layout.total_records_processable = 64440;
+    layout.hitmap_base_row = 32734;
+    layout.record_base_row = 514;
+    return layout;
+}
+
+inline uint8_t* memory_row(int row_index) {
+    return memory.row(row_index);
+}
+
+// The row buffer of a scan, the open row of bank memory itself; keys are compared in place rather than copied out
+// first. Constant initialized, so a thread_local row buffer costs no initialization check per access
+struct RowBuffer {
+    const uint8_t* bytes;
+    int row;
+
+    constexpr RowBuffer() : bytes(NULL), row(-1) {}
+
+    // Open a row unless it already is, return whether it had to be loaded
+    inline bool load(int row_index) {
+        if (row == row_index) {
+            return false;
+        }
+        bytes = memory_row(row_index);
+        row = row_index;
+        return true;
+    }
+};
+
+// Read a value of up to 8 bytes, most significant byte first, as a native value
+inline uint64_t load_native(const uint8_t* bytes, int size_bytes) {
+    uint64_t value = 0;
+    for (int byte = 0; byte < size_bytes; byte++) {
+        value = (value << 8) | bytes[byte];
+    }
+    return value;
+}
+
+// Allocate the bank, or map an existing image; a mapped image already holds its records and hitmaps. Bank images
+// are recognized by their header, anything else is taken as raw rows starting image_offset bytes into the file.
+// Return whether the bank was generated, random records with every hitmap true, rather than mapped
+inline bool create_memory(Bank::Storage storage, const std::string& image_path, size_t image_offset) {
+    if (!image_path.empty()) {
+        if (is_bank_image(image_path)) {
+            map_bank_image(memory, image_path, layout);
+        }
+        else {
+            memory.map_image(image_path, layout.bank_rows, layout.row_buffer_size_bytes, image_offset);
+        }
+        return false;
+    }
+
+    // Fresh storage reads as zero until first touch, so utility rows and everything past the hitmaps
+    // (all null) are never written and never become resident
+    memory.allocate(layout.bank_rows, layout.row_buffer_size_bytes, storage);
+
+    // PI/Key column (when packed) and data row generation
+    for (int row = layout.key_base_row(); row < layout.hitmap_base_row; row++) {
+        uint8_t* bytes = memory_row(row);
+        for (int byte = 0; byte < layout.row_buffer_size_bytes; byte++) {
+            bytes[byte] = (uint8_t)(rand() % 256);  // random data
+        }
+    }
+
+    // Hitmap row generation, initialize all hitmaps to true
+    memset(memory_row(layout.hitmap_base_row), 0xFF,
+           (size_t) layout.total_rows_for_hitmaps * layout.row_buffer_size_bytes);
+    return true;
+}
+
+inline void dump_memory(const std::string& path) {
+    std::ofstream dump_file;
+    dump_file.open(path);
+    for (int row = 0; row < layout.bank_rows; row++) {
+        dump_file << std::hex << std::setfill('0') << std::setw(8) << (size_t) row * layout.row_buffer_size_bytes << ":  ";
+        for (int byte = 0; byte < layout.row_buffer_size_bytes; byte++) {
+            dump_file << std::hex << std::setfill('0') << std::setw(2) << unsigned(memory_row(row)[byte]) << " ";
+        }
+        dump_file << "\n";
+    }
+    dump_file.close();
+}
+
+// Write matching record indexes, one per line
+inline void save_indexes(const std::string& path, const std::vector<int>& indexes) {
+    std::ofstream file(path.c_str());
+    for (size_t index = 0; index < indexes.size(); index++) {
+        file << indexes[index] << "\n";
+    }
+    if (!file) {
+        throw std::runtime_error("unable to write indexes to " + path);
+    }
+}
+
+// Parse a big-endian hex value (optionally 0x prefixed) into a PI-sized byte array, matching the Python int layout
+inline std::vector<uint8_t> parse_value(const std::string& text, int size_bytes) {
+    std::string digits = text.compare(0, 2, "0x") == 0 || text.compare(0, 2, "0X") == 0 ? text.substr(2) : text;
+    if (digits.empty() || digits.size() > (size_t) size_bytes * 2 ||
+        digits.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+        throw std::runtime_error("value '" + text + "' is not a hex value that fits the PI element");
+    }
+    std::vector<uint8_t> value(size_bytes, 0);
+    for (size_t digit = 0; digit < digits.size(); digit++) {
+        size_t position = digits.size() - 1 - digit;
+        uint8_t nibble = (uint8_t) strtol(digits.substr(position, 1).c_str(), NULL, 16);
+        value[size_bytes - 1 - digit / 2] |= nibble << (4 * (digit % 2));
+    }
+    return value;
+}
+
+// The options every tool takes; the configuration, the targeted hitmap, where the bank comes from and the cycle
+// report. Selection tools (equality, range) write hits, so they also take where the bank and the matching indexes
+// are saved after the scan
+struct ToolOptions {
+    bool selects;
+    std::string configuration_path;
+    int hitmap_index;
+    std::string storage_name;
+    std::string image_path;
+    size_t image_offset;
+    std::string output_path;
+    std::string output_image_path;
+    std::string indexes_path;
+    bool report_cycles;
+
+    explicit ToolOptions(bool selects) : selects(selects), hitmap_index(-1), storage_name("anonymous"),
+                                         image_offset(0), output_path(selects ? "test.memdump" : ""),
+                                         report_cycles(false) {}
+
+    // Take the option at argv[arg], and its value by advancing arg, if it is one of these; false otherwise
+    bool parse(int argc, char** argv, int& arg) {
+        std::string option = argv[arg];
+        bool valued = arg + 1 < argc;
+        if (valued && option == "--hitmap") { hitmap_index = atoi(argv[++arg]); }
+        else if (valued && option == "--storage") { storage_name = argv[++arg]; }
+        else if (valued && option == "--image") { image_path = argv[++arg]; }
+        else if (valued && option == "--image-offset") { image_offset = strtoull(argv[++arg], NULL, 10); }
+        else if (option == "--cycles") { report_cycles = true; }
+        else if (selects && valued && option == "--output") { output_path = argv[++arg]; }
+        else if (selects && option == "--no-dump") { output_path.clear(); }
+        else if (selects && valued && option == "--output-image") { output_image_path = argv[++arg]; }
+        else if (selects && valued && option == "--indexes") { indexes_path = argv[++arg]; }
+        else if (option[0] != '-' && configuration_path.empty()) { configuration_path = option; }
+        else { return false; }
+        return true;
+    }
+
+    // The configured layout, the built-in one without a configuration
+    LayoutConfiguration load_layout() const {
+        return configuration_path.empty() ? default_layout() : load_layout_configuration(configuration_path);
+    }
+
+    // The hitmap --hitmap picks, otherwise hitmap 1 of the built-in layout or hitmap 0 of a configured one
+    int target_hitmap() const {
+        return hitmap_index >= 0 ? hitmap_index : configuration_path.empty() ? 1 : 0;
+    }
+};
+
+// The usage lines of the options every tool takes, after the tool's own `options` (continuation lines indented to
+// match); `selects` as for ToolOptions
+inline void print_tool_usage(const char* program, const char* options, bool selects) {
+    printf("usage: %s [configuration.json] %s\n", program, options);
+    printf("       [--hitmap index] [--storage anonymous|hugepages] [--image path [--image-offset bytes]]\n");
+    printf(selects ? "       [--output path | --no-dump] [--output-image path] [--indexes path] [--cycles]\n"
+                   : "       [--cycles]\n");
+    printf("Without a configuration the built-in 32MB/1KB layout is used and hitmap 1 is targeted, otherwise\n");
+    printf("hitmap 0. With --image the bank rows and hitmaps are mapped copy-on-write from an existing bank image\n");
+    printf("(or raw rows) instead of being generated.\n");
+    if (selects) {
+        printf("--output dumps the bank after the scan as hex, --output-image saves it as a binary bank image,\n");
+        printf("readable by Bank.load. --indexes saves the matching record indexes.\n");
+    }
+}
+
+#endif // BLIMP_TOOL_COMMON_H
@@ -0,0 +1,173 @@
+// Native bank engine for the Python simulator (src/hardware/native.py), built on the compliance Bank storage.
+//
+// The Python Bank keeps its rows in this engine's memory and views them through the buffer protocol, so row
+// reads and writes are plain slices; whole-row operations that would otherwise round-trip through Python
+// integers (RowClone copies, DCC inversions, triple-row activations) run here in place on the row storage, as
+// word loops the compiler vectorizes for the target (-march=native). Hitmaps are also decoded and compared here,
+// from any buffer, so query results and differential compliance runs do not walk hitmap bits in Python, and layout
+// scatters whole generated columns of fields into the rows, so no record is shifted together as a Python integer.
+//
+// Build next to this file, where the Python loader looks for it:
+//     g++ -O3 -march=native -shared -fPIC -o libblimp_bank.so blimp_bank.cpp
+#include <stdint.h>
+#include <string.h>
+#include <new>
+
+#include "../common/bank.h"
+#include "../common/hitmap_decode.h"
+
+// Bitwise majority over 64-bit words, with a byte loop for row buffers that are not a multiple of 8 bytes
+inline void tra_kernel(uint8_t* a, uint8_t* b, uint8_t* c, size_t bytes, bool invert) {
+    uint64_t flip = invert ? ~0ULL : 0ULL;
+    size_t offset = 0;
+    for (; offset + 8 <= bytes; offset += 8) {
+        uint64_t x, y, z;
+        memcpy(&x, a + offset, 8);
+        memcpy(&y, b + offset, 8);
+        memcpy(&z, c + offset, 8);
+        uint64_t majority = ((x & y) | (y & z) | (z & x)) ^ flip;
+        memcpy(a + offset, &majority, 8);
+        memcpy(b + offset, &majority, 8);
+        memcpy(c + offset, &majority, 8);
+    }
+    for (; offset < bytes; offset++) {
+        a[offset] = b[offset] = c[offset] = (uint8_t)(((a[offset] & b[offset]) | (b[offset] & c[offset])
+                                                    | (c[offset] & a[offset])) ^ flip);
+    }
+}
+
+// Bitwise inversion of a row into another, as read out of the negated side of a dual-contact cell
+inline void invert_kernel(const uint8_t* source, uint8_t* destination, size_t bytes) {
+    size_t offset = 0;
+    for (; offset + 8 <= bytes; offset += 8) {
+        uint64_t x;
+        memcpy(&x, source + offset, 8);
+        x = ~x;
+        memcpy(destination + offset, &x, 8);
+    }
+    for (; offset < bytes; offset++) {
+        destination[offset] = (uint8_t) ~source[offset];
+    }
+}
+
+extern "C" {
+
+// Create a bank of `rows` rows with every byte set to default_byte; returns NULL if the bank cannot be allocated
+void* blimp_bank_create(int rows, int row_buffer_bytes, int default_byte) {
+    Bank* bank = new (std::nothrow) Bank();
+    if (!bank) {
+        return NULL;
+    }
+    try {
+        bank->allocate(rows, row_buffer_bytes);
+    }
+    catch (const std::exception&) {
+        delete bank;
+        return NULL;
+    }
+    if (default_byte != 0) {
+        memset(bank->data(), default_byte, bank->size_bytes());
+    }
+    return bank;
+}
+
+// Map the `rows` rows of a raw bank image, starting `offset` bytes into the file, copy-on-write as a bank; rows are
+// shared with every other mapping of the image until written and writes never reach the file. Returns NULL if the
+// image cannot be mapped
+void* blimp_bank_map_image(const char* path, long long offset, int rows, int row_buffer_bytes) {
+    Bank* bank = new (std::nothrow) Bank();
+    if (!bank) {
+        return NULL;
+    }
+    try {
+        bank->map_image(path, rows, row_buffer_bytes, (size_t) offset);
+    }
+    catch (const std::exception&) {
+        delete bank;
+        return NULL;
+    }
+    return bank;
+}
+
+void blimp_bank_destroy(void* bank) {
+    delete (Bank*) bank;
+}
+
+uint8_t* blimp_bank_data(void* bank) {
+    return ((Bank*) bank)->data();
+}
+
+// RowClone; copy one row over another
+void blimp_bank_copy_row(void* bank, int from_index, int to_index) {
+    Bank* b = (Bank*) bank;
+    if (from_index != to_index) {
+        memcpy(b->row(to_index), b->row(from_index), b->row_buffer_bytes());
+    }
+}
+
+// DCC invert; write the inverse of one row into another
+void blimp_bank_invert_row(void* bank, int from_index, int to_index) {
+    Bank* b = (Bank*) bank;
+    invert_kernel(b->row(from_index), b->row(to_index), b->row_buffer_bytes());
+}
+
+// Triple-row activation; all three rows take the bitwise majority, optionally inverted
+void blimp_bank_tra_rows(void* bank, int row_index_a, int row_index_b, int row_index_c, int invert) {
+    Bank* b = (Bank*) bank;
+    tra_kernel(b->row(row_index_a), b->row(row_index_b), b->row(row_index_c), b->row_buffer_bytes(), invert != 0);
+}
+
+// Scatter `count` fields of `width` bytes, packed back to back in `column`, into the bank one `stride` bytes apart
+// from byte `first_byte` on
+void blimp_bank_scatter_column(void* bank, const uint8_t* column, long long count, int width, long long first_byte,
+                               long long stride) {
+    uint8_t* destination = ((Bank*) bank)->data() + first_byte;
+    if (stride == width) {
+        memcpy(destination, column, (size_t) count * width);
+        return;
+    }
+    for (long long index = 0; index < count; index++) {
+        memcpy(destination + index * stride, column + index * width, width);
+    }
+}
+
+// Bit slice `count` fields of `width` bytes, packed back to back in `column`, into the `rows` rows from first_row on.
+// Every page of width * 8 rows holds one row buffer width of fields, one row per bit, most significant bit first;
+// any bit of those rows past the fields is zero
+void blimp_bank_bit_slice_column(void* bank, const uint8_t* column, long long count, int width, int first_row,
+                                 int rows) {
+    Bank* b = (Bank*) bank;
+    size_t row_bytes = b->row_buffer_bytes();
+    long long fields_per_page = (long long) row_bytes * 8;
+    int rows_per_page = width * 8;
+    memset(b->row(first_row), 0, (size_t) rows * row_bytes);
+    for (long long index = 0; index < count; index++) {
+        long long page = index / fields_per_page;
+        if ((page + 1) * rows_per_page > rows) {
+            break;
+        }
+        long long lane = index % fields_per_page;
+        uint8_t* lane_byte = b->row(first_row + (int)(page * rows_per_page)) + lane / 8;
+        uint8_t lane_bit = (uint8_t)(0x80 >> (lane % 8));
+        const uint8_t* field = column + index * width;
+        for (int bit = 0; bit < rows_per_page; bit++) {
+            if (field[bit / 8] & (0x80 >> (bit % 8))) {
+                lane_byte[bit * row_bytes] |= lane_bit;
+            }
+        }
+    }
+}
+
+// Decode the first `bits` records of a hitmap into `indexes`, or only count its hits when indexes is NULL
+long long blimp_decode_hitmap(const uint8_t* hitmap, long long bits, int* indexes) {
+    return (long long) decode_hitmap(hitmap, (size_t) bits, indexes);
+}
+
+// Compare the first `bits` records of two hitmaps, return how many differ and write the first `limit` differing
+// record indexes to `mismatches`
+long long blimp_diff_hitmaps(const uint8_t* a, const uint8_t* b, long long bits, long long* mismatches,
+                             long long limit) {
+    return (long long) diff_hitmaps(a, b, (size_t) bits, mismatches, (size_t) limit);
+}
+
+}
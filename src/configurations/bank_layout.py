@@ -65,76 +65,102 @@ class BankLayoutConfiguration:
 
 class BlimpBankLayoutConfiguration(BankLayoutConfiguration):
     """Defines the row layout configuration for an BLIMP database bank"""
+    PI_LAYOUT_HORIZONTAL = "horizontal"
+    PI_LAYOUT_BIT_SLICED = "bit_sliced"
+    PI_LAYOUT_COLUMN_PACKED = "column_packed"
+    PI_LAYOUT_COLUMNAR = "columnar"
+
     def __init__(self, hardware: BlimpHardwareConfiguration, database: BlimpDatabaseConfiguration):
         super().__init__(hardware, database)
 
         self._hardware_configuration = hardware
         self._database_configuration = database
 
+        if self._database_configuration.pi_layout not in [self.PI_LAYOUT_HORIZONTAL, self.PI_LAYOUT_BIT_SLICED,
+                                                          self.PI_LAYOUT_COLUMN_PACKED, self.PI_LAYOUT_COLUMNAR]:
+            raise ValueError(f"Unknown PI/Key layout '{self._database_configuration.pi_layout}'")
+        if self.packed_pi_fields and \
+                self._hardware_configuration.row_buffer_size_bytes % self._database_configuration.total_index_size_bytes != 0:
+            raise ValueError("Column packed PI/Key fields must evenly divide the row buffer")
+        if self.pi_layout == self.PI_LAYOUT_COLUMNAR and self._database_configuration.total_data_size_bytes <= 0:
+            raise ValueError("Columnar layouts need records with a data field")
+
         # User-defined rows dedicated to storing BLIMP compute code
         self.total_rows_for_blimp_code_region = int(math.ceil(self._database_configuration.blimp_code_region_size_bytes
                                                     / self._hardware_configuration.row_buffer_size_bytes))
 
+        # All-zero and all-one rows BLIMP-V loads to compare bit-sliced PI/Key fields against
+        self.total_rows_for_pi_constants = 2 if self.pi_layout == self.PI_LAYOUT_BIT_SLICED else 0
+
         # Total rows to play with when configuring the layout
         self.total_rows_for_configurable_data = self._hardware_configuration.bank_rows \
-            - self.total_rows_for_blimp_code_region
+            - self.total_rows_for_blimp_code_region \
+            - self.total_rows_for_pi_constants
 
         if self.total_rows_for_configurable_data < 0:
             raise ValueError("There are not enough bank rows to satisfy static row constraints")
 
-        if self._database_configuration.total_record_size_bytes > self._hardware_configuration.row_buffer_size_bytes:
-            if self._database_configuration.total_record_size_bytes % self._hardware_configuration.row_buffer_size_bytes != 0:
+        # Columnar (PAX) layouts place only the data of each record in the records region
+        stored_record_size_bytes = self.stored_record_size_bytes
+        if stored_record_size_bytes > self._hardware_configuration.row_buffer_size_bytes:
+            if stored_record_size_bytes % self._hardware_configuration.row_buffer_size_bytes != 0:
                 raise ValueError("Record sizes must be row buffer aligned to at least a power of two")
         else:
-            if self._hardware_configuration.row_buffer_size_bytes % self._database_configuration.total_record_size_bytes != 0:
+            if self._hardware_configuration.row_buffer_size_bytes % stored_record_size_bytes != 0:
                 raise ValueError("Record sizes must be row buffer aligned to at least a power of two")
 
+        pi_rows = 0
         data_rows = 0
         hitmap_rows = 0
         processable_records = 0
-        record_to_row_buffer_ratio = self._database_configuration.total_record_size_bytes \
-            / self._hardware_configuration.row_buffer_size_bytes
-        while data_rows + hitmap_rows < self.total_rows_for_configurable_data:
+        record_to_row_buffer_ratio = stored_record_size_bytes / self._hardware_configuration.row_buffer_size_bytes
+        while pi_rows + data_rows + hitmap_rows < self.total_rows_for_configurable_data:
+            # PI rows hold the extra PI/Key copy; bit sliced or packed, a row buffer width of records takes PI bits rows
+            new_pi_rows = 0 if self.pi_layout == self.PI_LAYOUT_HORIZONTAL \
+                else self._database_configuration.total_index_size_bytes * 8
             # Hitmap rows are calculated one bit per PI field, per each hitmap
             new_hitmap_rows = self._database_configuration.hitmap_count
-            # Data rows are calculated by the row buffer width of records, multiplied by the size of the record
+            # Data rows are calculated by the row buffer width of records, multiplied by the size of the stored record
             # rb * 8 * data / rb
-            new_data_rows = 8 * self._database_configuration.total_record_size_bytes
+            new_data_rows = 8 * stored_record_size_bytes
 
             # Can we fit a full set of records into the bank?
-            if new_hitmap_rows + hitmap_rows + new_data_rows + data_rows < self.total_rows_for_configurable_data:
+            if new_pi_rows + pi_rows + \
+                    new_hitmap_rows + hitmap_rows + \
+                    new_data_rows + data_rows < self.total_rows_for_configurable_data:
                 # If we can, add this new block into our existing set
+                pi_rows += new_pi_rows
                 hitmap_rows += new_hitmap_rows
                 data_rows += new_data_rows
                 processable_records += self._hardware_configuration.row_buffer_size_bytes * 8
                 continue
 
             # Can we fit a subset of records into the bank?
-            elif new_hitmap_rows + hitmap_rows + data_rows < self.total_rows_for_configurable_data:
+            elif new_pi_rows + pi_rows + \
+                    new_hitmap_rows + hitmap_rows + \
+                    data_rows < self.total_rows_for_configurable_data:
                 # If we can, ensure we can add at least one data record
-                if record_to_row_buffer_ratio >= 1 and (new_hitmap_rows + hitmap_rows +
+                if record_to_row_buffer_ratio >= 1 and (new_pi_rows + pi_rows + new_hitmap_rows + hitmap_rows +
                    data_rows + record_to_row_buffer_ratio) > self.total_rows_for_configurable_data:
                     # If we can't fit at least one record, break out
                     break
 
                 # At this point at least one record is placeable, so place the blocks
+                pi_rows += new_pi_rows
                 hitmap_rows += new_hitmap_rows
 
-                rows_remaining = self.total_rows_for_configurable_data - hitmap_rows - data_rows
+                rows_remaining = self.total_rows_for_configurable_data - pi_rows - hitmap_rows - data_rows
                 if record_to_row_buffer_ratio <= 1:
-                    records_per_row = self._hardware_configuration.row_buffer_size_bytes \
-                                      // self._database_configuration.total_record_size_bytes
+                    records_per_row = self._hardware_configuration.row_buffer_size_bytes // stored_record_size_bytes
                     processable_records += rows_remaining * records_per_row
                     data_rows += rows_remaining
                 else:
                     records_in_remainder = rows_remaining // (
-                            self._database_configuration.total_record_size_bytes
-                            // self._hardware_configuration.row_buffer_size_bytes
+                            stored_record_size_bytes // self._hardware_configuration.row_buffer_size_bytes
                     )
                     processable_records += records_in_remainder
                     data_rows += records_in_remainder * (
-                            self._database_configuration.total_record_size_bytes
-                            // self._hardware_configuration.row_buffer_size_bytes
+                            stored_record_size_bytes // self._hardware_configuration.row_buffer_size_bytes
                     )
                 break
 
@@ -144,7 +170,10 @@ class BlimpBankLayoutConfiguration(BankLayoutConfiguration):
 
         # Done heuristically placing rows in bank, finalize configuration
 
-        # Total rows for BLIMP-format records (pi field + data / k + v)
+        # Total rows for the bit sliced or column packed pi-field copy
+        self.total_rows_for_pi_field = pi_rows
+
+        # Total rows for BLIMP-format records (pi field + data / k + v, only data / v when columnar)
         self.total_rows_for_records = data_rows
 
         # Total rows for BLIMP hitmap placement
@@ -154,12 +183,14 @@ class BlimpBankLayoutConfiguration(BankLayoutConfiguration):
         self.total_records_processable = processable_records
 
         # Ensure we are inbounds
-        if data_rows + hitmap_rows > self.total_rows_for_configurable_data:
+        if pi_rows + data_rows + hitmap_rows > self.total_rows_for_configurable_data:
             raise AssertionError("Heuristic placement failed, alter parameters or reserved rows")
 
         self._meta_configuration["total_rows_for_configurable_data"] = self.total_rows_for_configurable_data
         self._meta_configuration["total_records_processable"] = self.total_records_processable
         self._meta_configuration["total_rows_for_blimp_code_region"] = self.total_rows_for_blimp_code_region
+        self._meta_configuration["total_rows_for_pi_constants"] = self.total_rows_for_pi_constants
+        self._meta_configuration["total_rows_for_pi_field"] = self.total_rows_for_pi_field
         self._meta_configuration["total_rows_for_records"] = self.total_rows_for_records
         self._meta_configuration["total_rows_for_hitmaps"] = self.total_rows_for_hitmaps
 
@@ -173,9 +204,69 @@ class BlimpBankLayoutConfiguration(BankLayoutConfiguration):
 
         print("Bank Row Mappings:")
         print(f"    total_rows_for_blimp_code_region:       {self.total_rows_for_blimp_code_region}")
+        print(f"    total_rows_for_pi_constants:            {self.total_rows_for_pi_constants}")
+        print(f"    total_rows_for_pi_field:                {self.total_rows_for_pi_field}")
         print(f"    total_rows_for_records:                 {self.total_rows_for_records}")
         print(f"    total_rows_for_hitmaps:                 {self.total_rows_for_hitmaps}")
 
+    @property
+    def pi_layout(self) -> str:
+        """How the PI/Key fields are laid out beside the records, one of the PI_LAYOUT_* values"""
+        return self._database_configuration.pi_layout
+
+    @property
+    def packed_pi_fields(self) -> bool:
+        """Whether BLIMP reads PI/Keys from a packed PI/Key column rather than from the records"""
+        return self.pi_layout in [self.PI_LAYOUT_COLUMN_PACKED, self.PI_LAYOUT_COLUMNAR]
+
+    @property
+    def stored_record_size_bytes(self) -> int:
+        """
+        The bytes each record takes in the records region. Columnar layouts store only the data field there, padded
+        at its end up to the nearest row buffer aligned size
+        """
+        if self.pi_layout != self.PI_LAYOUT_COLUMNAR:
+            return self._database_configuration.total_record_size_bytes
+        row_buffer_bytes = self._hardware_configuration.row_buffer_size_bytes
+        data_bytes = self._database_configuration.total_data_size_bytes
+        if data_bytes > row_buffer_bytes:
+            return int(math.ceil(data_bytes / row_buffer_bytes)) * row_buffer_bytes
+        return min(size for size in range(data_bytes, row_buffer_bytes + 1) if row_buffer_bytes % size == 0)
+
+    def field_region(self, field_offset_bytes: int) -> (int, int, int):
+        """
+        Return where a record field is stored as the first row of its region, the stride (in bytes) between the
+        copies of consecutive records and the field's offset within each copy. Columnar layouts keep the PI/Key
+        field in the PI/Key column and the data field in the records region, otherwise records hold every field
+        """
+        if self.pi_layout == self.PI_LAYOUT_COLUMNAR:
+            if field_offset_bytes < self._database_configuration.total_index_size_bytes:
+                return self.address_mapping["pi_field"][0], self._database_configuration.total_index_size_bytes, \
+                    field_offset_bytes
+            return self.address_mapping["records"][0], self.stored_record_size_bytes, \
+                field_offset_bytes - self._database_configuration.total_index_size_bytes
+        return self.address_mapping["records"][0], self.stored_record_size_bytes, field_offset_bytes
+
+    def region_location(self, base_row: int, stride_bytes: int, record_index: int) -> (int, int):
+        """Return the row and byte offset a record's copy starts at in a region of the given base row and stride"""
+        row_buffer_bytes = self._hardware_configuration.row_buffer_size_bytes
+        if stride_bytes > row_buffer_bytes:  # Multi-row per record
+            return base_row + record_index * (stride_bytes // row_buffer_bytes), 0
+        # Multi-record per row
+        records_per_row = row_buffer_bytes // stride_bytes
+        return base_row + record_index // records_per_row, record_index % records_per_row * stride_bytes
+
+    def pi_location(self, record_index: int) -> (int, int):
+        """
+        Return the row and byte offset BLIMP reads a record's PI/Key field from; the packed PI/Key column if there is
+        one, otherwise the start of the record itself
+        """
+        if self.packed_pi_fields:
+            return self.region_location(
+                self.address_mapping["pi_field"][0], self._database_configuration.total_index_size_bytes, record_index
+            )
+        return self.region_location(self.address_mapping["records"][0], self.stored_record_size_bytes, record_index)
+
     @property
     def address_mapping(self):
         """Return the row address mapping for this configuration"""
@@ -186,6 +277,12 @@ class BlimpBankLayoutConfiguration(BankLayoutConfiguration):
         mapping["blimp_code_region"] = [base, self.total_rows_for_blimp_code_region]
         base += self.total_rows_for_blimp_code_region
 
+        mapping["pi_constants"] = [base, self.total_rows_for_pi_constants]
+        base += self.total_rows_for_pi_constants
+
+        mapping["pi_field"] = [base, self.total_rows_for_pi_field]
+        base += self.total_rows_for_pi_field
+
         mapping["records"] = [base, self.total_rows_for_records]
         base += self.total_rows_for_records
 
@@ -211,6 +308,12 @@ class AmbitBankLayoutConfiguration(BlimpBankLayoutConfiguration):
         self._hardware_configuration = hardware
         self._database_configuration = database
 
+        # Ambit always holds its PI/Key fields bit sliced in the ambit pi-field, which BLIMP-V shares
+        if self.packed_pi_fields:
+            raise ValueError("AMBIT layouts bit slice the PI/Key field, column packing is not supported")
+        self.total_rows_for_pi_constants = 0
+        self.total_rows_for_pi_field = 0
+
         # Ambit compute region rows, B and C groups
         self.total_rows_for_reserved_ambit_compute = self._hardware_configuration.ambit_dcc_rows * 2 + \
             self._hardware_configuration.ambit_control_group_rows + \
@@ -322,6 +425,8 @@ class AmbitBankLayoutConfiguration(BlimpBankLayoutConfiguration):
         self._meta_configuration["total_rows_for_configurable_data"] = self.total_rows_for_configurable_data
         self._meta_configuration["total_records_processable"] = self.total_records_processable
         self._meta_configuration["total_rows_for_blimp_code_region"] = self.total_rows_for_blimp_code_region
+        self._meta_configuration["total_rows_for_pi_constants"] = self.total_rows_for_pi_constants
+        self._meta_configuration["total_rows_for_pi_field"] = self.total_rows_for_pi_field
         self._meta_configuration["total_rows_for_ambit_pi_field"] = self.total_rows_for_ambit_pi_field
         self._meta_configuration["total_rows_for_temporary_ambit_compute"] = self.total_rows_for_temporary_ambit_compute
         self._meta_configuration["total_rows_for_records"] = self.total_rows_for_records
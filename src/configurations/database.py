@@ -46,6 +46,11 @@ class BlimpDatabaseConfiguration(DatabaseConfiguration):
     hitmap_count: int
     blimp_code_region_size_bytes: int
 
+    # How an extra copy of the PI/Key fields is laid out next to the records; horizontal (none, read PI/Keys from the
+    # records), bit_sliced (one row per PI/Key bit, for BLIMP-V) or column_packed (PI/Keys back to back, for BLIMP).
+    # columnar (PAX) packs the PI/Keys back to back too, but moves rather than copies them; records hold only data
+    pi_layout: str = "horizontal"
+
 
 class AmbitDatabaseConfiguration(BlimpDatabaseConfiguration):
     """Defines changeable AMBIT-compute database configurations"""
@@ -12,6 +12,10 @@ class HardwareConfiguration(BaseModel):
     time_to_column_activate_ns: float
     time_to_precharge_ns: float
 
+    # Row Buffer Model, see src/simulators/dram_timing.py
+    row_buffer_policy: str = "closed"
+    subarrays_per_bank: int = 1
+
     # Calculated Fields
     bank_rows: int = None
 
@@ -88,6 +88,18 @@ class DatabaseRecordGenerator:
         """Fetch just the value field, aliased to :func:get_data_field"""
         return self.get_data_field(index)
 
+    def get_pi_column(self, first_index: int, count: int) -> bytes:
+        """Fetch the primary/index fields of a run of records, back to back as one contiguous big-endian buffer"""
+        size = self.pi_size_bytes
+        return b''.join((self.get_record(index)[0] or 0).to_bytes(size, 'big')
+                        for index in range(first_index, first_index + count))
+
+    def get_data_column(self, first_index: int, count: int) -> bytes:
+        """Fetch the data fields of a run of records, back to back as one contiguous big-endian buffer"""
+        size = self.data_size_bytes
+        return b''.join((self.get_record(index)[1] or 0).to_bytes(size, 'big')
+                        for index in range(first_index, first_index + count))
+
     def get_raw_record(self, index) -> int:
         """Fetch a raw record from the corpus given an index"""
         pi, data = self.get_record(index)
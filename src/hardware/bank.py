@@ -1,47 +1,105 @@
 import json
 import logging
+import mmap
 
 from src.configurations.hardware import HardwareConfiguration, BlimpHardwareConfiguration, AmbitHardwareConfiguration
 from utils import performance
 from utils.bitmanip import byte_array_to_int, int_to_byte_array
+from src.hardware.image import is_bank_image, load_bank_image, read_bank_image_header, save_bank_image
+from src.hardware.native import create_bank_storage, map_bank_storage
 
 
 class Bank:
-    """Defines operations for a generic DRAM Bank"""
-    def __init__(self, configuration: HardwareConfiguration, memory: list=None, default_byte_value: int=0xff):
+    """
+    Defines operations for a generic DRAM Bank
+
+    Rows live in one contiguous buffer of bank_rows * row_buffer_size_bytes, most significant byte of each row
+    first. When the native bank engine is built (compliance/native) the buffer is owned by it and whole-row
+    operations run natively, otherwise it is a bytearray. A bank can instead map the rows of a raw bank image
+    copy-on-write, see :func:map.
+
+    Once a snapshot is taken (:func:snapshot), every row written through the bank's methods is tracked, so restoring
+    the snapshot only rewrites the rows written since. Writes through row views are not tracked.
+    """
+    def __init__(self, configuration: HardwareConfiguration, memory=None, default_byte_value: int=0xff,
+                 image: str=None):
         self._config = configuration
         self._logger = logging.getLogger(self.__class__.__name__)
+        self._row_bytes = configuration.row_buffer_size_bytes
+
+        # The rows written since the last snapshot taken or restored, None when no snapshot is being tracked
+        self._snapshot = None
+        self._dirty_rows = None
 
         # Ensure the default value is only one byte
         if default_byte_value < 0 or default_byte_value >= 256:
             raise ValueError("default byte value must be expressable with a single byte")
 
-        # If a bank file was provided, ensure it is valid with the configuration
+        # If a bank file was provided, ensure it is valid with the configuration; either a list of raw row
+        # integers or a bytes-like object of every row
         if memory:
-            # Too few bank rows?
-            if len(memory) != configuration.bank_rows:
+            if isinstance(memory, list):
+                # Too few bank rows?
+                if len(memory) != configuration.bank_rows:
+                    raise ValueError("the bank size does not match the configuration")
+
+                # All rows represent at least the maximum supported by the row buffer?
+                if any(row >= 2**(configuration.row_buffer_size_bytes * 8) or row < 0 for row in memory):
+                    raise ValueError("the row buffer size does not match the configuration")
+            elif len(memory) != configuration.bank_rows * configuration.row_buffer_size_bytes:
                 raise ValueError("the bank size does not match the configuration")
 
-            # All rows represent at least the maximum supported by the row buffer?
-            if any(row >= 2**(configuration.row_buffer_size_bytes * 8) or row < 0 for row in memory):
-                raise ValueError("the row buffer size does not match the configuration")
+        if image is not None:
+            self._map_image(image)
+            self._logger.info(f"bank mapped copy-on-write from {image}"
+                              f"{' (native)' if self._native is not None else ''}")
+            return
+
+        fill = 0 if memory else default_byte_value
+        self._native = create_bank_storage(configuration.bank_rows, self._row_bytes, fill)
+        if self._native is not None:
+            self.memory = self._native.buffer
+        else:
+            self.memory = memoryview(bytearray([fill]) * (configuration.bank_rows * self._row_bytes))
 
         if memory:
-            self.memory = memory
+            if isinstance(memory, list):
+                for index, row in enumerate(memory):
+                    self.memory[index * self._row_bytes:(index + 1) * self._row_bytes] = \
+                        row.to_bytes(self._row_bytes, 'big')
+            else:
+                self.memory[:] = memory
+        self._logger.info(f"bank loaded with {'initial' if memory else 'null'} memory state"
+                          f"{' (native)' if self._native is not None else ''}")
+
+    def _map_image(self, path: str):
+        """Use the rows of a raw bank image, mapped privately, as this bank's memory"""
+        _, image, data_offset = read_bank_image_header(path)
+        if image["compression"] != "none":
+            raise ValueError("only uncompressed bank images can be mapped")
+        if image["bank_rows"] != self._config.bank_rows or image["row_buffer_size_bytes"] != self._row_bytes:
+            raise ValueError("the bank image does not match the configuration")
+
+        self._native = map_bank_storage(path, data_offset, self._config.bank_rows, self._row_bytes)
+        if self._native is not None:
+            self.memory = self._native.buffer
         else:
-            self.memory = []
-            for row in range(configuration.bank_rows):
-                value = 0
-                for _ in range(configuration.row_buffer_size_bytes):
-                    value <<= 8
-                    value += default_byte_value
-                self.memory.append(value)
-        self._logger.info(f"bank loaded with {'initial' if memory else 'null'} memory state")
+            with open(path, 'rb') as fp:
+                mapping = mmap.mmap(fp.fileno(), 0, access=mmap.ACCESS_COPY)
+            self.memory = memoryview(mapping)[data_offset:data_offset + self._config.bank_rows * self._row_bytes]
+
+    def get_row_view(self, row_index: int) -> memoryview:
+        """Fetch a writable buffer view of a row, without copying"""
+        return self.memory[row_index * self._row_bytes:(row_index + 1) * self._row_bytes]
+
+    def get_rows_view(self, first_row_index: int, rows: int) -> memoryview:
+        """Fetch a writable buffer view of a run of consecutive rows, without copying"""
+        return self.memory[first_row_index * self._row_bytes:(first_row_index + rows) * self._row_bytes]
 
     def get_raw_row(self, row_index: int):
         """Fetch a row by its index and return integer representation of the byte array"""
         self._logger.debug(f"bank fetch at {hex(row_index * self._config.row_buffer_size_bytes)} (row {row_index})")
-        return self.memory[row_index]
+        return int.from_bytes(self.get_row_view(row_index), 'big')
 
     def set_raw_row(self, row_index: int, value: int):
         """Set a specified row with a provided integer value acting as a raw byte array"""
@@ -52,14 +110,13 @@ class Bank:
             raise ValueError("raw value bit width dimension does not match row buffer size")
 
         # Passed checks, set and return row
-        self.memory[row_index] = value
+        self._mark_dirty(row_index)
+        self.memory[row_index * self._row_bytes:(row_index + 1) * self._row_bytes] = value.to_bytes(self._row_bytes, 'big')
         return value
 
     def get_row_bytes(self, row_index: int):
         """Fetch a row by its index and return the byte array"""
-        raw_value = self.get_raw_row(row_index)
-        byte_array = int_to_byte_array(raw_value, self._config.row_buffer_size_bytes)
-        return byte_array
+        return list(self.get_row_view(row_index))
 
     def set_row_bytes(self, row_index: int, byte_array: list):
         """Set a specified row with a provided byte array"""
@@ -68,16 +125,158 @@ class Bank:
         if len(byte_array) != self._config.row_buffer_size_bytes:
             raise ValueError("byte array dimension does not match row buffer size")
 
-        raw_result = byte_array_to_int(byte_array)
+        # Ensure this is byte compliant
+        try:
+            row = bytes(byte_array)
+        except ValueError:
+            raise ValueError("all values in the byte array must be byte-sized")
 
         # Save the raw value
-        self.set_raw_row(row_index, raw_result)
-        return raw_result
+        self._logger.debug(f"bank store at {hex(row_index * self._config.row_buffer_size_bytes)} (row {row_index})")
+        self._mark_dirty(row_index)
+        self.memory[row_index * self._row_bytes:(row_index + 1) * self._row_bytes] = row
+        return int.from_bytes(row, 'big')
 
-    def save(self, path: str, dump_with_ascii=True):
-        """Save the current state of the bank's memory with the system configuration and a hexdump"""
+    def clear_rows(self, first_row_index: int, rows: int):
+        """Null a run of consecutive rows"""
+        self._mark_dirty(first_row_index, rows)
+        self.get_rows_view(first_row_index, rows)[:] = bytes(rows * self._row_bytes)
+
+    def snapshot(self) -> "BankSnapshot":
+        """
+        Copy the bank's memory into a snapshot, and from then on track the rows written, so the snapshot can be
+        restored by rewriting only those; only the latest snapshot of a bank is tracked
+        """
+        self._logger.info(f"taking memory snapshot")
+        self._snapshot = BankSnapshot(bytes(self.memory))
+        self._dirty_rows = set()
+        return self._snapshot
+
+    def restore(self, snapshot: "BankSnapshot") -> int:
+        """
+        Restore the bank's memory to a snapshot, return how many rows were rewritten; only the rows written since
+        the latest snapshot was taken or restored, or every row when restoring an older snapshot
+        """
+        if len(snapshot.memory) != len(self.memory):
+            raise ValueError("the snapshot does not match the bank size")
+        if snapshot is self._snapshot:
+            rows = sorted(self._dirty_rows)
+        else:
+            rows = range(self._config.bank_rows)
+            self._snapshot = snapshot
+
+        # Copy back runs of consecutive rows at once
+        run_start = run_end = None
+        for row in rows:
+            if row != run_end:
+                if run_start is not None:
+                    self._copy_snapshot_rows(snapshot, run_start, run_end)
+                run_start = row
+            run_end = row + 1
+        if run_start is not None:
+            self._copy_snapshot_rows(snapshot, run_start, run_end)
+
+        self._dirty_rows = set()
+        self._logger.info(f"restored {len(rows)} rows from memory snapshot")
+        return len(rows)
+
+    @property
+    def dirty_rows(self) -> list:
+        """The rows written since the latest snapshot was taken or restored, in order"""
+        return sorted(self._dirty_rows or ())
+
+    def _mark_dirty(self, first_row_index: int, rows: int=1):
+        if self._dirty_rows is not None:
+            if rows == 1:
+                self._dirty_rows.add(first_row_index)
+            else:
+                self._dirty_rows.update(range(first_row_index, first_row_index + rows))
+
+    def _copy_snapshot_rows(self, snapshot: "BankSnapshot", first_row_index: int, end_row_index: int):
+        start, end = first_row_index * self._row_bytes, end_row_index * self._row_bytes
+        self.memory[start:end] = snapshot.memory[start:end]
+
+    def scatter_column(self, column: bytes, field_size_bytes: int, first_byte: int, stride_bytes: int):
+        """
+        Store a column of fields, packed back to back, into the bank one stride apart starting at a byte address;
+        used by layout to place whole generated columns at once
+        """
+        if field_size_bytes <= 0:
+            return
+        count = len(column) // field_size_bytes
+        if count == 0:
+            return
+        if stride_bytes < field_size_bytes or first_byte < 0 or \
+                first_byte + (count - 1) * stride_bytes + field_size_bytes > len(self.memory):
+            raise ValueError("the column does not fit in the bank at this address and stride")
+        last_byte = first_byte + (count - 1) * stride_bytes + field_size_bytes - 1
+        self._mark_dirty(first_byte // self._row_bytes, last_byte // self._row_bytes - first_byte // self._row_bytes + 1)
+
+        if self._native is not None:
+            self._native.scatter_column(bytes(column), count, field_size_bytes, first_byte, stride_bytes)
+        elif stride_bytes == field_size_bytes:
+            self.memory[first_byte:first_byte + count * field_size_bytes] = column
+        else:
+            # One strided copy per byte of the field
+            end = first_byte + (count - 1) * stride_bytes + 1
+            for byte in range(field_size_bytes):
+                self.memory[first_byte + byte:end + byte:stride_bytes] = column[byte::field_size_bytes]
+
+    def bit_slice_column(self, column: bytes, field_size_bytes: int, first_row: int, rows: int):
+        """
+        Store a column of fields, packed back to back, vertically into a run of rows; every field_size_bytes * 8
+        rows hold one row buffer width of fields, one row per bit, most significant bit first. Bits past the fields
+        are nulled.
+        """
+        if first_row < 0 or first_row + rows > self._config.bank_rows:
+            raise ValueError("the bit sliced rows do not fit in the bank")
+        count = len(column) // field_size_bytes
+        self._mark_dirty(first_row, rows)
+
+        if self._native is not None:
+            self._native.bit_slice_column(bytes(column), count, field_size_bytes, first_row, rows)
+            return
+
+        self.clear_rows(first_row, rows)
+        fields_per_page = self._row_bytes * 8
+        bits = field_size_bytes * 8
+        for page in range(min(rows // bits, -(-count // fields_per_page))):
+            first = page * fields_per_page
+            last = min(count, first + fields_per_page)
+            fields = [
+                int.from_bytes(column[index * field_size_bytes:(index + 1) * field_size_bytes], 'big')
+                for index in range(first, last)
+            ]
+            for bit in range(bits):
+                shift = bits - 1 - bit
+                raw_value = 0
+                for field in fields:
+                    raw_value = (raw_value << 1) | ((field >> shift) & 1)
+                self.set_raw_row(first_row + page * bits + bit, raw_value << (fields_per_page - len(fields)))
+
+    def save(self, path: str, compression: str=None):
+        """
+        Save the current state of the bank's memory as a binary bank image with the system configuration
+
+        @param path: The path and filename to save the bank image
+        @param compression: None for raw row bytes, or "zstd" to compress groups of rows
+        """
         self._logger.info(f"saving memory state into {path}")
         performance.start_performance_tracking()
+        save_bank_image(
+            path,
+            self._config.dict(),
+            (self.get_row_view(row) for row in range(self._config.bank_rows)),
+            self._config.bank_rows,
+            self._config.row_buffer_size_bytes,
+            compression
+        )
+        self._logger.info(f"memory state saved in {performance.end_performance_tracking()}s")
+
+    def export_hexdump(self, path: str, dump_with_ascii=True):
+        """Export the current state of the bank's memory with the system configuration and a hexdump, for debugging"""
+        self._logger.info(f"exporting memory hexdump into {path}")
+        performance.start_performance_tracking()
         with open(path, 'w') as fp:
             # Write the system configuration
             self._logger.info(f"saving memory system configuration")
@@ -86,7 +285,7 @@ class Bank:
 
             # Hexdump the memory with address, hexdump, ascii dump
             self._logger.info(f"saving memory dump")
-            for idx in range(len(self.memory)):
+            for idx in range(self._config.bank_rows):
                 address_line = f'%08X:  ' % (idx * self._config.row_buffer_size_bytes)
                 byte_string = ""
                 ascii_string = ""
@@ -103,11 +302,44 @@ class Bank:
                 fp.write(' ')
                 fp.write(ascii_string)
                 fp.write('\n')
-        self._logger.info(f"memory state saved in {performance.end_performance_tracking()}s")
+        self._logger.info(f"memory hexdump exported in {performance.end_performance_tracking()}s")
 
     @classmethod
     def load(cls, path: str):
-        """Load a saved bank memory dump"""
+        """Load a saved bank image, or a legacy bank memory hexdump"""
+        if not is_bank_image(path):
+            return cls._load_hexdump(path)
+
+        _logger = logging.getLogger(cls.__name__)
+        _logger.info(f"loading memory state from {path}")
+        performance.start_performance_tracking()
+        hardware, image, data = load_bank_image(path)
+        configuration = HardwareConfiguration(**hardware)
+
+        # Rows are copied straight out of the mapping into the bank storage
+        bank = cls(configuration, memory=data)
+        data.release()
+        _logger.info(f"memory state loaded in {performance.end_performance_tracking()}s")
+        return bank
+
+    @classmethod
+    def map(cls, path: str, configuration: HardwareConfiguration=None):
+        """
+        Map a saved, uncompressed bank image copy-on-write: rows are shared with every other mapping of the image
+        until written, and writes never reach the file
+
+        @param path: The path and filename of the bank image
+        @param configuration: The hardware configuration of the bank; defaults to the one embedded in the image.
+                                Configurations may differ in anything but the bank geometry
+        """
+        if configuration is None:
+            hardware, _, _ = read_bank_image_header(path)
+            configuration = HardwareConfiguration(**hardware)
+        return cls(configuration, image=path)
+
+    @classmethod
+    def _load_hexdump(cls, path: str):
+        """Load a bank memory hexdump"""
         _logger = logging.getLogger(cls.__name__)
         _logger.info(f"loading memory state from {path}")
         performance.start_performance_tracking()
@@ -136,17 +368,26 @@ class Bank:
         return cls(configuration, memory=memory_array)
 
 
+class BankSnapshot:
+    """A copy of a bank's memory, see :func:Bank.snapshot"""
+    def __init__(self, memory: bytes):
+        self.memory = memory
+
+
 class BlimpBank(Bank):
     """Defines operations for a BLIMP/-V DRAM Bank"""
-    def __init__(self, configuration: BlimpHardwareConfiguration, memory: list=None, default_byte_value: int=0xff):
-        super(BlimpBank, self).__init__(configuration, memory, default_byte_value)
+    def __init__(self, configuration: BlimpHardwareConfiguration, memory: list=None, default_byte_value: int=0xff,
+                 image: str=None):
+        super(BlimpBank, self).__init__(configuration, memory, default_byte_value, image)
 
 
 class AmbitBank(BlimpBank):
     """Defines operations for a BLIMP/-V controlled AMBIT DRAM Bank"""
 
-    def __init__(self, configuration: AmbitHardwareConfiguration, memory: list = None, default_byte_value: int = 0xff):
-        super(AmbitBank, self).__init__(configuration, memory, default_byte_value)
+    def __init__(self, configuration: AmbitHardwareConfiguration, memory: list = None, default_byte_value: int = 0xff,
+                 image: str = None):
+        super(AmbitBank, self).__init__(configuration, memory, default_byte_value, image)
+        self._row_mask = 2**(self._config.row_buffer_size_bytes * 8) - 1
 
     def get_inverted_row_bytes(self, row_index: int):
         """Fetch a row by its index and return the inverted byte array"""
@@ -158,27 +399,47 @@ class AmbitBank(BlimpBank):
         """Fetch a row by its index and return the inverted integer representation of the byte array"""
         self._logger.debug(f"inverting values at {hex(row_index * self._config.row_buffer_size_bytes)}")
         result = self.get_raw_row(row_index)
-        inverted_result = (~result & (2**(self._config.row_buffer_size_bytes * 8) - 1))
+        inverted_result = ~result & self._row_mask
         return inverted_result
 
+    def invert_row(self, from_index: int, to_index: int):
+        """Write the inverse of a row into another row, as the tethered side of a dual-contact cell does"""
+        self._logger.debug(f"inverting values at {hex(from_index * self._config.row_buffer_size_bytes)} into "
+                           f"{hex(to_index * self._config.row_buffer_size_bytes)}")
+        self._mark_dirty(to_index)
+        if self._native is not None:
+            self._native.invert_row(from_index, to_index)
+        else:
+            self.memory[to_index * self._row_bytes:(to_index + 1) * self._row_bytes] = \
+                (~self.get_raw_row(from_index) & self._row_mask).to_bytes(self._row_bytes, 'big')
+
     def copy_row(self, from_index: int, to_index: int):
         """Copy a row from a specified index and set it to another row index"""
         self._logger.debug(f"row copy from "
                       f"{hex(from_index * self._config.row_buffer_size_bytes)} to "
                       f"{hex(to_index * self._config.row_buffer_size_bytes)}")
-        result = self.get_raw_row(from_index)
-        result = self.set_raw_row(to_index, result)
-        return result
+        self._mark_dirty(to_index)
+        if self._native is not None:
+            self._native.copy_row(from_index, to_index)
+        else:
+            self.memory[to_index * self._row_bytes:(to_index + 1) * self._row_bytes] = self.get_row_view(from_index)
 
     def tra_rows(self, row_index_a: int, row_index_b: int, row_index_c: int, invert=False):
         """
         Perform a Triple-Row-Activation (TRA) operation on three provided rows. Overwrites the values of all rows
-        with the value of the TRA operation.
+        with the value of the TRA operation; read a row back with get_raw_row if its value is needed.
         """
         self._logger.debug(f"performing tra operation at addresses "
                       f"{hex(row_index_a * self._config.row_buffer_size_bytes)}, "
                       f"{hex(row_index_b * self._config.row_buffer_size_bytes)}, "
                       f"{hex(row_index_c * self._config.row_buffer_size_bytes)}")
+        self._mark_dirty(row_index_a)
+        self._mark_dirty(row_index_b)
+        self._mark_dirty(row_index_c)
+        if self._native is not None:
+            self._native.tra_rows(row_index_a, row_index_b, row_index_c, invert)
+            return
+
         a = self.get_raw_row(row_index_a)
         b = self.get_raw_row(row_index_b)
         c = self.get_raw_row(row_index_c)
@@ -190,10 +451,8 @@ class AmbitBank(BlimpBank):
         tra_value = a & b | b & c | c & a
 
         if invert:
-            tra_value = ~tra_value & ((2**(self._config.row_buffer_size_bytes*8)) - 1)
+            tra_value = ~tra_value & self._row_mask
 
         self.set_raw_row(row_index_a, tra_value)
         self.set_raw_row(row_index_b, tra_value)
         self.set_raw_row(row_index_c, tra_value)
-
-        return tra_value
@@ -0,0 +1,147 @@
+"""
+Binary bank image format, shared with the native compliance tools (compliance/common/bank_image.h)
+
+    8 bytes     magic, b"BLIMPBNK"
+    4 bytes     little-endian length of the JSON header
+    n bytes     UTF-8 JSON header; {"hardware": {...}, "image": {...}}
+    padding     zero bytes up to the next IMAGE_ALIGNMENT boundary, so row data can be mapped page aligned
+    data        bank_rows * row_buffer_size_bytes raw row bytes, row 0 first, most significant byte first;
+                or, when compressed with zstd, one frame per group of image.rows_per_chunk rows, located by
+                the [offset, length] pairs of image.chunks relative to the start of the data
+"""
+import json
+import mmap
+import struct
+
+IMAGE_MAGIC = b"BLIMPBNK"
+IMAGE_VERSION = 1
+IMAGE_ALIGNMENT = 4096
+
+_PREAMBLE = struct.Struct("<8sI")
+
+
+def _data_offset(header_length: int) -> int:
+    """Where row data begins for a header of the given length"""
+    end = _PREAMBLE.size + header_length
+    return (end + IMAGE_ALIGNMENT - 1) // IMAGE_ALIGNMENT * IMAGE_ALIGNMENT
+
+
+def _zstandard():
+    """Import the optional zstd bindings"""
+    try:
+        import zstandard
+    except ImportError:
+        raise RuntimeError("zstd compressed bank images require the 'zstandard' package")
+    return zstandard
+
+
+def is_bank_image(path: str) -> bool:
+    """Whether the file at path is a binary bank image, as opposed to a legacy hexdump"""
+    with open(path, 'rb') as fp:
+        return fp.read(len(IMAGE_MAGIC)) == IMAGE_MAGIC
+
+
+def save_bank_image(path: str, hardware: dict, rows, bank_rows: int, row_buffer_size_bytes: int,
+                    compression: str=None, rows_per_chunk: int=None):
+    """
+    Save a bank image
+
+    @param path: The path and filename to save the image
+    @param hardware: The hardware configuration dictionary to embed in the header
+    @param rows: An iterable of bank_rows row-sized bytes-like objects, in row order
+    @param bank_rows: The number of rows in the bank
+    @param row_buffer_size_bytes: The size of each row
+    @param compression: None for raw rows, or "zstd" to compress groups of rows
+    @param rows_per_chunk: When compressing, how many rows to place per zstd frame; defaults to ~1MB of rows
+    """
+    image = {
+        "version": IMAGE_VERSION,
+        "bank_rows": bank_rows,
+        "row_buffer_size_bytes": row_buffer_size_bytes,
+        "compression": compression or "none",
+    }
+
+    chunks = []
+    if compression == "zstd":
+        compressor = _zstandard().ZstdCompressor()
+        rows_per_chunk = rows_per_chunk or max(1, (1 << 20) // row_buffer_size_bytes)
+        group = bytearray()
+        written = 0
+        for row in rows:
+            if len(row) != row_buffer_size_bytes:
+                raise ValueError("row dimension does not match row buffer size")
+            group += row
+            written += 1
+            if written % rows_per_chunk == 0 or written == bank_rows:
+                chunks.append(compressor.compress(bytes(group)))
+                group = bytearray()
+        if written != bank_rows:
+            raise ValueError("the number of rows written does not match the bank size")
+        image["rows_per_chunk"] = rows_per_chunk
+        image["chunks"] = []
+        offset = 0
+        for frame in chunks:
+            image["chunks"].append([offset, len(frame)])
+            offset += len(frame)
+    elif compression is not None:
+        raise ValueError(f"unsupported bank image compression '{compression}'")
+
+    header = json.dumps({"hardware": hardware, "image": image}).encode("utf-8")
+    with open(path, 'wb') as fp:
+        fp.write(_PREAMBLE.pack(IMAGE_MAGIC, len(header)))
+        fp.write(header)
+        fp.write(b"\x00" * (_data_offset(len(header)) - _PREAMBLE.size - len(header)))
+        if chunks:
+            for frame in chunks:
+                fp.write(frame)
+        else:
+            written = 0
+            for row in rows:
+                if len(row) != row_buffer_size_bytes:
+                    raise ValueError("row dimension does not match row buffer size")
+                fp.write(row)
+                written += 1
+            if written != bank_rows:
+                raise ValueError("the number of rows written does not match the bank size")
+
+
+def read_bank_image_header(path: str) -> (dict, dict, int):
+    """Read the header of a bank image, return the hardware configuration dictionary, the image description, and
+    the file offset of its row data"""
+    with open(path, 'rb') as fp:
+        magic, header_length = _PREAMBLE.unpack(fp.read(_PREAMBLE.size))
+        if magic != IMAGE_MAGIC:
+            raise ValueError("File is not a bank image")
+        header = json.loads(fp.read(header_length).decode("utf-8"))
+    if header["image"]["version"] != IMAGE_VERSION:
+        raise ValueError(f"Unsupported bank image version {header['image']['version']}")
+    return header["hardware"], header["image"], _data_offset(header_length)
+
+
+def load_bank_image(path: str) -> (dict, dict, memoryview):
+    """
+    Load a bank image, return the hardware configuration dictionary, the image description, and a buffer of all
+    bank rows. Raw images are memory mapped read-only, so the buffer is zero-copy and may be wrapped directly, for
+    example with numpy.frombuffer; compressed images are decompressed into memory.
+    """
+    hardware, image, data_offset = read_bank_image_header(path)
+    size = image["bank_rows"] * image["row_buffer_size_bytes"]
+    with open(path, 'rb') as fp:
+
+        if image["compression"] == "none":
+            mapping = mmap.mmap(fp.fileno(), 0, access=mmap.ACCESS_READ)
+            if len(mapping) < data_offset + size:
+                raise ValueError("File is smaller than the bank described in its header")
+            return hardware, image, memoryview(mapping)[data_offset:data_offset + size]
+
+        if image["compression"] == "zstd":
+            decompressor = _zstandard().ZstdDecompressor()
+            data = bytearray()
+            for offset, length in image["chunks"]:
+                fp.seek(data_offset + offset)
+                data += decompressor.decompress(fp.read(length))
+            if len(data) != size:
+                raise ValueError("Decompressed bank image does not match the bank described in its header")
+            return hardware, image, memoryview(data)
+
+        raise ValueError(f"Unsupported bank image compression '{image['compression']}'")
@@ -0,0 +1,156 @@
+"""
+Loader for the native bank engine (compliance/native/blimp_bank.cpp)
+
+The engine is an optional shared library loaded with ctypes. Set BLIMP_NATIVE_BANK to the library path to use a
+library built elsewhere, or to 0 to force the pure Python bank storage.
+"""
+import ctypes
+import os
+import weakref
+
+_LIBRARY_NAME = "libblimp_bank.so"
+_DEFAULT_PATH = os.path.join(os.path.dirname(__file__), "..", "..", "compliance", "native", _LIBRARY_NAME)
+
+_library = None
+_library_loaded = False
+
+
+def native_library():
+    """Load the native bank engine, return None if it is disabled or has not been built"""
+    global _library, _library_loaded
+    if _library_loaded:
+        return _library
+    _library_loaded = True
+
+    path = os.environ.get("BLIMP_NATIVE_BANK", _DEFAULT_PATH)
+    if path == "0" or not os.path.exists(path):
+        return None
+    try:
+        library = ctypes.CDLL(path)
+    except OSError:
+        return None
+
+    library.blimp_bank_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int]
+    library.blimp_bank_create.restype = ctypes.c_void_p
+    library.blimp_bank_map_image.argtypes = [ctypes.c_char_p, ctypes.c_longlong, ctypes.c_int, ctypes.c_int]
+    library.blimp_bank_map_image.restype = ctypes.c_void_p
+    library.blimp_bank_destroy.argtypes = [ctypes.c_void_p]
+    library.blimp_bank_destroy.restype = None
+    library.blimp_bank_data.argtypes = [ctypes.c_void_p]
+    library.blimp_bank_data.restype = ctypes.c_void_p
+    library.blimp_bank_copy_row.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int]
+    library.blimp_bank_copy_row.restype = None
+    library.blimp_bank_invert_row.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int]
+    library.blimp_bank_invert_row.restype = None
+    library.blimp_bank_tra_rows.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int]
+    library.blimp_bank_tra_rows.restype = None
+    library.blimp_bank_scatter_column.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_longlong, ctypes.c_int,
+                                                  ctypes.c_longlong, ctypes.c_longlong]
+    library.blimp_bank_scatter_column.restype = None
+    library.blimp_bank_bit_slice_column.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_longlong, ctypes.c_int,
+                                                    ctypes.c_int, ctypes.c_int]
+    library.blimp_bank_bit_slice_column.restype = None
+    library.blimp_decode_hitmap.argtypes = [ctypes.c_void_p, ctypes.c_longlong, ctypes.c_void_p]
+    library.blimp_decode_hitmap.restype = ctypes.c_longlong
+    library.blimp_diff_hitmaps.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_longlong, ctypes.c_void_p,
+                                           ctypes.c_longlong]
+    library.blimp_diff_hitmaps.restype = ctypes.c_longlong
+
+    _library = library
+    return _library
+
+
+class NativeBank:
+    """
+    Bank rows held by the native engine, exposed as one writable buffer of bank_rows * row_buffer_size_bytes; either
+    allocated, or mapped copy-on-write from the raw rows of a bank image at image_offset into image_path
+    """
+    def __init__(self, library, bank_rows: int, row_buffer_size_bytes: int, default_byte_value: int,
+                 image_path: str=None, image_offset: int=0):
+        self._library = library
+        if image_path is not None:
+            self._handle = library.blimp_bank_map_image(os.fsencode(image_path), image_offset, bank_rows,
+                                                        row_buffer_size_bytes)
+            if not self._handle:
+                raise OSError(f"unable to map bank image {image_path}")
+        else:
+            self._handle = library.blimp_bank_create(bank_rows, row_buffer_size_bytes, default_byte_value)
+            if not self._handle:
+                raise MemoryError("unable to allocate native bank memory")
+        size = bank_rows * row_buffer_size_bytes
+        array = (ctypes.c_uint8 * size).from_address(library.blimp_bank_data(self._handle))
+        self.buffer = memoryview(array).cast('B')
+        # Free the engine once nothing views its memory any more, row views may outlive this object
+        weakref.finalize(array, library.blimp_bank_destroy, self._handle)
+
+    def copy_row(self, from_index: int, to_index: int):
+        self._library.blimp_bank_copy_row(self._handle, from_index, to_index)
+
+    def invert_row(self, from_index: int, to_index: int):
+        self._library.blimp_bank_invert_row(self._handle, from_index, to_index)
+
+    def tra_rows(self, row_index_a: int, row_index_b: int, row_index_c: int, invert: bool):
+        self._library.blimp_bank_tra_rows(self._handle, row_index_a, row_index_b, row_index_c, int(invert))
+
+    def scatter_column(self, column: bytes, count: int, field_size_bytes: int, first_byte: int, stride_bytes: int):
+        self._library.blimp_bank_scatter_column(self._handle, column, count, field_size_bytes, first_byte,
+                                                stride_bytes)
+
+    def bit_slice_column(self, column: bytes, count: int, field_size_bytes: int, first_row: int, rows: int):
+        self._library.blimp_bank_bit_slice_column(self._handle, column, count, field_size_bytes, first_row, rows)
+
+
+def create_bank_storage(bank_rows: int, row_buffer_size_bytes: int, default_byte_value: int):
+    """Create the bank storage, a NativeBank if the engine is available, otherwise None"""
+    library = native_library()
+    if library is None:
+        return None
+    return NativeBank(library, bank_rows, row_buffer_size_bytes, default_byte_value)
+
+
+def map_bank_storage(path: str, offset: int, bank_rows: int, row_buffer_size_bytes: int):
+    """Map the raw rows of a bank image copy-on-write as bank storage, a NativeBank if the engine is available,
+    otherwise None"""
+    library = native_library()
+    if library is None:
+        return None
+    return NativeBank(library, bank_rows, row_buffer_size_bytes, 0, path, offset)
+
+
+def decode_hitmap(hitmap, num_bits: int, count_only: bool=False):
+    """
+    Decode the first num_bits records of a writable hitmap buffer natively; return the hit count and the sorted hit
+    indexes (None when only counting), or None if the engine is not available
+    """
+    library = native_library()
+    if library is None:
+        return None
+    view = memoryview(hitmap).cast('B')
+    if view.readonly or len(view) == 0:
+        return None
+    num_bits = min(num_bits, len(view) * 8)
+    address = ctypes.addressof((ctypes.c_uint8 * len(view)).from_buffer(view))
+    count = library.blimp_decode_hitmap(address, num_bits, None)
+    if count_only:
+        return count, None
+    indexes = (ctypes.c_int * count)()
+    library.blimp_decode_hitmap(address, num_bits, indexes)
+    return count, indexes[:]
+
+
+def diff_hitmaps(hitmap_a, hitmap_b, num_bits: int, limit: int):
+    """
+    Compare the first num_bits records of two writable hitmap buffers natively; return how many records differ and
+    the first limit differing record indexes, or None if the engine is not available
+    """
+    library = native_library()
+    if library is None:
+        return None
+    views = [memoryview(hitmap).cast('B') for hitmap in (hitmap_a, hitmap_b)]
+    if any(view.readonly or len(view) == 0 for view in views):
+        return None
+    num_bits = min(num_bits, len(views[0]) * 8, len(views[1]) * 8)
+    addresses = [ctypes.addressof((ctypes.c_uint8 * len(view)).from_buffer(view)) for view in views]
+    mismatches = (ctypes.c_longlong * limit)()
+    count = library.blimp_diff_hitmaps(addresses[0], addresses[1], num_bits, mismatches, limit)
+    return count, mismatches[:min(count, limit)]
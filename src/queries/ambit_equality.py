@@ -142,17 +142,11 @@ class _AmbitEquality(Query):
             runtime += self.sim.blimp_cycle(2, "; loop return", return_labels)
         runtime += self.sim.blimp_end(return_labels)
 
-        # We have finished the query, fetch the hitmap to one single hitmap row
-        hitmap_byte_array = []
-        for h in range(rows_per_hitmap):
-            # Calculate the hitmap we are targeting: Base Hitmap address + hitmap index + sub-hitmap index
-            hitmap_row = self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * hitmap_index + h
-
-            # Append the byte array for the next hitmap sub row
-            hitmap_byte_array += self.sim.bank_hardware.get_row_bytes(hitmap_row)
-
-        result = SimulationResult.from_hitmap_byte_array(
-            hitmap_byte_array,
+        # We have finished the query, decode the hitmap rows in place
+        result = SimulationResult.from_hitmap_rows(
+            self.sim.bank_hardware,
+            hitmap_base,
+            rows_per_hitmap,
             self.sim.configuration.total_records_processable
         )
         return runtime, result
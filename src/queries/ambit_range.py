@@ -0,0 +1,237 @@
+import typing
+
+from src.queries.query import Query, RangeBound
+from src.simulators.result import RuntimeResult, SimulationResult
+from src.utils import bitmanip
+
+from src.simulators.ambit import SimulatedAmbitBank
+
+
+class _AmbitRange(Query):
+    def __init__(self, sim: SimulatedAmbitBank):
+        super().__init__(sim)
+        self.sim = sim
+
+    def _perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            bounds: typing.List[RangeBound],
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a generic AMBIT range query operation over the bit-sliced PI/Key field.
+
+        Each bound is evaluated from the least significant bit up with one TRA per bit, keeping whether the bits seen
+        so far pass the bound in T0. For a LESS bound T0 = MAJ(~PI[bit], value[bit], T0): where the bits differ the
+        PI/Key bit decides, where they are equal T0 carries through. GREATER bounds use MAJ(PI[bit], ~value[bit], T0).
+        T0 starts as all ones for an inclusive bound and all zeros otherwise. The hitmap is overwritten with the
+        conjunction of every bound.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on. For example if
+            the PI/Key field is 8 bytes and describes two 4 byte indexes, setting the offset to 4 will target
+            the second index
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param bounds: The bounds a PI/Key must pass to be a hit
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        # Ensure the values are at least valid
+        for bound in bounds:
+            if bound.value >= 2**(8*pi_element_size_bytes):
+                raise RuntimeError(f"This value is too large to be checking against {pi_element_size_bytes} byte "
+                                   f"indices")
+
+        # Begin by enabling BLIMP
+        runtime = self.sim.blimp_begin(return_labels)
+
+        # How many rows are represented by one hitmap
+        rows_per_hitmap = self.sim.configuration.total_rows_for_hitmaps \
+            // self.sim.configuration.database_configuration.hitmap_count
+        hitmap_base = self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * hitmap_index
+
+        # Iterate over all hitmap rows
+        runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
+        for h in range(rows_per_hitmap):
+            runtime += self.sim.blimp_cycle(3, "; hitmap row calculation", return_labels)
+            # Calculate the hitmap we are targeting: Base Hitmap address + hitmap index + sub-hitmap index
+            hitmap_row = hitmap_base + h
+
+            for k, bound in enumerate(bounds):
+                # let T0 be the result of no bits; equal so far, so only inclusive bounds pass
+                runtime += self.sim.blimp_cycle(3, "cmp inclusive", return_labels)
+                if bound.inclusive:
+                    runtime += self.sim.ambit_copy(self.sim.ambit_c1, self.sim.ambit_t0, return_labels)
+                else:
+                    runtime += self.sim.ambit_copy(self.sim.ambit_c0, self.sim.ambit_t0, return_labels)
+
+                # Iterate over the bits per this chunk of records, least significant first
+                runtime += self.sim.blimp_cycle(1, "; inner loop start", return_labels)
+                for b in reversed(range(pi_element_size_bytes * 8)):
+                    runtime += self.sim.blimp_cycle(5, "; bit calculation", return_labels)
+                    bit_at_value = bitmanip.msb_bit(bound.value, b, 8 * pi_element_size_bytes)
+
+                    # Calculate the row offset to fetch
+                    # PI/Key base row + record chunk index + subindex offset + bit
+                    runtime += self.sim.blimp_cycle(10, "; row calculation", return_labels)
+                    row_to_check = \
+                        self.sim.configuration.address_mapping["ambit_pi_field"][0] + \
+                        h * self.sim.configuration.database_configuration.total_index_size_bytes * 8 + \
+                        pi_subindex_offset_bytes * 8 + \
+                        b
+
+                    # move PI[bit] into ambit compute region, through DCC0 to invert it for LESS bounds
+                    if bound.greater:
+                        runtime += self.sim.ambit_copy(row_to_check, self.sim.ambit_t1, return_labels)
+                        operand = self.sim.ambit_t1
+                    else:
+                        runtime += self.sim.ambit_copy(row_to_check, self.sim.ambit_dcc0, return_labels)
+                        operand = self.sim.ambit_ndcc0
+
+                    # depending on the bit of the value for this ambit row, copy a 0 or 1 (inverted for GREATER)
+                    runtime += self.sim.blimp_cycle(3, "cmp bit", return_labels)
+                    if bool(bit_at_value) != bound.greater:
+                        runtime += self.sim.ambit_copy(self.sim.ambit_c1, self.sim.ambit_t2, return_labels)
+                    else:
+                        runtime += self.sim.ambit_copy(self.sim.ambit_c0, self.sim.ambit_t2, return_labels)
+
+                    # T0 has MAJ(PI[bit], value[bit], T0); the majority is decided by the PI/Key bit unless it
+                    # agrees with the value bit
+                    runtime += self.sim.ambit_tra(operand, self.sim.ambit_t2, self.sim.ambit_t0, return_labels)
+                    runtime += self.sim.blimp_cycle(2, "; inner loop return", return_labels)
+
+                # The bound is complete, the first is kept in T3 and the others are AND'd into it
+                if k > 0:
+                    runtime += self.sim.ambit_and(self.sim.ambit_t3, self.sim.ambit_t0, self.sim.ambit_t1,
+                                                  return_labels)
+                if k < len(bounds) - 1:
+                    runtime += self.sim.ambit_copy(self.sim.ambit_t0, self.sim.ambit_t3, return_labels)
+
+            # move the result to the hitmap
+            runtime += self.sim.ambit_copy(self.sim.ambit_t0, hitmap_row, return_labels)
+            runtime += self.sim.blimp_cycle(2, "; loop return", return_labels)
+        runtime += self.sim.blimp_end(return_labels)
+
+        # We have finished the query, decode the hitmap rows in place
+        result = SimulationResult.from_hitmap_rows(
+            self.sim.bank_hardware,
+            hitmap_base,
+            rows_per_hitmap,
+            self.sim.configuration.total_records_processable
+        )
+        return runtime, result
+
+
+class AmbitLessThan(_AmbitRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            value: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform an AMBIT LESS THAN query operation, hitting every record whose PI/Key is less than the value. If the
+        PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param value: The value to check all targeted PI/Keys against. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(value, greater=False, inclusive=False)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class AmbitLessThanOrEqual(_AmbitRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            value: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform an AMBIT LESS THAN OR EQUAL query operation, hitting every record whose PI/Key is at most the value.
+        If the PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param value: The value to check all targeted PI/Keys against. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(value, greater=False, inclusive=True)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class AmbitGreaterThan(_AmbitRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            value: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform an AMBIT GREATER THAN query operation, hitting every record whose PI/Key is greater than the value. If
+        the PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param value: The value to check all targeted PI/Keys against. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(value, greater=True, inclusive=False)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class AmbitBetween(_AmbitRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            low: int,
+            high: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform an AMBIT BETWEEN query operation, hitting every record whose PI/Key is within [low, high]. If the
+        PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param low: The inclusive lower bound. This must be less than 2^pi_element_size
+        @param high: The inclusive upper bound. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(low, greater=True, inclusive=True), RangeBound(high, greater=False, inclusive=True)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
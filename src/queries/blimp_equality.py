@@ -43,16 +43,10 @@ class _BlimpEquality(Query):
             // self.sim.configuration.database_configuration.hitmap_count
         hitmap_base = self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * hitmap_index
 
-        # How many records or rows are represented per row or record, respectively
-        records_per_row = self.sim.configuration.hardware_configuration.row_buffer_size_bytes \
-            // self.sim.configuration.database_configuration.total_record_size_bytes
-        rows_per_record = self.sim.configuration.database_configuration.total_record_size_bytes \
-            // self.sim.configuration.hardware_configuration.row_buffer_size_bytes
-
         # V1 will be our temporary hitmap register
 
         # Simulator only, convert the value to bytes
-        value_bytes = bitmanip.int_to_byte_array(value, pi_element_size_bytes)
+        value_bytes = bytes(bitmanip.int_to_byte_array(value, pi_element_size_bytes))
 
         # Algorithm bookkeeping
         runtime += self.sim.blimp_cycle(5, "; initialization", return_labels)
@@ -65,13 +59,8 @@ class _BlimpEquality(Query):
         runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
         for r in range(self.sim.configuration.total_records_processable):  # Iterate over all record rows
 
-            # Calculate the row and offset this record resides in
-            if rows_per_record > 0:  # Multi-row per record
-                row = self.sim.configuration.address_mapping["records"][0] + r * rows_per_record
-                offset = 0
-            else:  # Multi-record per row
-                row = self.sim.configuration.address_mapping["records"][0] + r // records_per_row
-                offset = r % records_per_row * self.sim.configuration.database_configuration.total_record_size_bytes
+            # Calculate the row and offset this record's PI/Key resides in
+            row, offset = self.sim.configuration.pi_location(r)
             sub_offset = offset + pi_subindex_offset_bytes
 
             runtime += self.sim.blimp_cycle(3, "; row calculation", return_labels)
@@ -87,7 +76,7 @@ class _BlimpEquality(Query):
 
             # Perform the EQUAL via a byte memcmp
             runtime += self.sim.blimp_cycle(pi_element_size_bytes * 2, "; memcmp", return_labels)
-            equal = all(data[sub_offset + b] == value_bytes[b] for b in range(pi_element_size_bytes))
+            equal = data[sub_offset:sub_offset + pi_element_size_bytes] == value_bytes
 
             # Update some metrics
             runtime += self.sim.blimp_cycle(4, "; bookkeeping", return_labels)
@@ -103,7 +92,7 @@ class _BlimpEquality(Query):
                 bitmap = 0
                 # Filled this register?
                 if hitdex % self.sim.configuration.hardware_configuration.row_buffer_size_bytes == 0:
-                    runtime += self.sim.blimp_save_register(self.sim.blimp_v1, hitmap_base + ((hitdex - 1) // self.sim.configuration.hardware_configuration.row_buffer_size_bytes))
+                    runtime += self.sim.blimp_save_register(self.sim.blimp_v1, hitmap_base + ((hitdex - 1) // self.sim.configuration.hardware_configuration.row_buffer_size_bytes), return_labels)
 
         # All records are finished processing, save what we have now
         runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
@@ -116,21 +105,15 @@ class _BlimpEquality(Query):
                 self.sim.registers[self.sim.blimp_v1][hitdex % self.sim.configuration.hardware_configuration.row_buffer_size_bytes] = bitmap
                 hitdex += 1
                 bitmap = 0
-        runtime += self.sim.blimp_save_register(self.sim.blimp_v1, hitmap_base + ((hitdex - 1) // self.sim.configuration.hardware_configuration.row_buffer_size_bytes))
+        runtime += self.sim.blimp_save_register(self.sim.blimp_v1, hitmap_base + ((hitdex - 1) // self.sim.configuration.hardware_configuration.row_buffer_size_bytes), return_labels)
 
         runtime += self.sim.blimp_end(return_labels)
 
-        # We have finished the query, fetch the hitmap to one single hitmap row
-        hitmap_byte_array = []
-        for h in range(rows_per_hitmap):
-            # Calculate the hitmap we are targeting: Base Hitmap address + hitmap index + sub-hitmap index
-            hitmap_row = self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * hitmap_index + h
-
-            # Append the byte array for the next hitmap sub row
-            hitmap_byte_array += self.sim.bank_hardware.get_row_bytes(hitmap_row)
-
-        result = SimulationResult.from_hitmap_byte_array(
-            hitmap_byte_array,
+        # We have finished the query, decode the hitmap rows in place
+        result = SimulationResult.from_hitmap_rows(
+            self.sim.bank_hardware,
+            hitmap_base,
+            rows_per_hitmap,
             self.sim.configuration.total_records_processable
         )
         return runtime, result
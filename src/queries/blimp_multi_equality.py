@@ -0,0 +1,194 @@
+import math
+import typing
+
+from src.queries.query import Query
+from src.simulators.result import RuntimeResult, SimulationResult
+from src.utils import bitmanip
+
+from src.simulators.blimp import SimulatedBlimpBank
+
+
+class EqualityPredicate(typing.NamedTuple):
+    """
+    One EQUAL or NOTEQUAL comparison of a fused scan
+
+    @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+    @param pi_element_size_bytes: The PI/Key field size in bytes
+    @param value: The value to check the targeted PI/Keys against. This must be less than 2^pi_element_size
+    @param negate: Whether this is an EQUAL or NOTEQUAL comparison
+    @param hitmap_index: Which hitmap to target results into
+    """
+    pi_subindex_offset_bytes: int
+    pi_element_size_bytes: int
+    value: int
+    negate: bool = False
+    hitmap_index: int = 0
+
+
+class BlimpMultiEqual(Query):
+    def __init__(self, sim: SimulatedBlimpBank):
+        super().__init__(sim)
+        self.sim = sim
+
+    @staticmethod
+    def segment_size_bytes(row_buffer_size_bytes: int, predicates: int) -> int:
+        """The bytes of v1 staging each predicate's hitmap, the row buffer split in a power of two segments"""
+        return row_buffer_size_bytes >> int(math.ceil(math.log2(predicates)))
+
+    def perform_operation(
+            self,
+            predicates: typing.List[EqualityPredicate],
+            return_labels: bool=False
+    ) -> (RuntimeResult, typing.List[SimulationResult]):
+        """
+        Perform several BLIMP EQUAL/NOTEQUAL comparisons in one pass over the records. Each record row is loaded
+        once and every predicate is evaluated against it, with each predicate writing its own hitmap.
+
+        Hitmap bytes of the predicates are staged side by side in v1, one segment each. Once the segments fill,
+        each is merged into its hitmap row through v2 (a load, the merge and a save); with a single predicate the
+        segment is the whole row and the scan charges exactly what BlimpEqual does.
+
+        @param predicates: The comparisons to perform, each targeting a different hitmap
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        """
+        if not predicates:
+            raise ValueError("at least one predicate is required")
+        hitmap_indexes = [predicate.hitmap_index for predicate in predicates]
+        if len(set(hitmap_indexes)) != len(hitmap_indexes):
+            raise ValueError("every predicate must target a different hitmap")
+        for predicate in predicates:
+            # Ensure the value is at least valid
+            if predicate.value >= 2 ** (8 * predicate.pi_element_size_bytes):
+                raise RuntimeError(f"This value is too large to be checking against "
+                                   f"{predicate.pi_element_size_bytes} byte indices")
+            if predicate.hitmap_index >= self.sim.configuration.database_configuration.hitmap_count:
+                raise IndexError(f"No hitmap at index {predicate.hitmap_index} is present in this database "
+                                 f"configuration")
+
+        row_buffer_size_bytes = self.sim.configuration.hardware_configuration.row_buffer_size_bytes
+        segment_bytes = self.segment_size_bytes(row_buffer_size_bytes, len(predicates))
+        if segment_bytes == 0:
+            raise ValueError("too many predicates to stage a hitmap byte of each in v1")
+
+        # Begin by enabling BLIMP
+        runtime = self.sim.blimp_begin(return_labels)
+
+        # How many rows are represented by one hitmap
+        rows_per_hitmap = self.sim.configuration.total_rows_for_hitmaps \
+            // self.sim.configuration.database_configuration.hitmap_count
+        hitmap_bases = [
+            self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * predicate.hitmap_index
+            for predicate in predicates
+        ]
+
+        # V1 stages the hitmap segments of every predicate, V2 merges a segment into its hitmap row
+        self.sim.registers[self.sim.blimp_v1] = bytearray(row_buffer_size_bytes)
+
+        # Simulator only, convert the values to bytes
+        value_bytes = [
+            bytes(bitmanip.int_to_byte_array(predicate.value, predicate.pi_element_size_bytes))
+            for predicate in predicates
+        ]
+
+        def flush_segments(hitdex: int):
+            """Merge the full segments of every predicate into their hitmap rows"""
+            result = RuntimeResult()
+            segment_start = (hitdex - 1) // segment_bytes * segment_bytes
+            row_offset = segment_start % row_buffer_size_bytes
+            for p in range(len(predicates)):
+                hitmap_row = hitmap_bases[p] + segment_start // row_buffer_size_bytes
+                segment = self.sim.registers[self.sim.blimp_v1][p * segment_bytes:(p + 1) * segment_bytes]
+                if segment_bytes == row_buffer_size_bytes:
+                    # The segment is the whole row, save it directly
+                    result += self.sim.blimp_save_register(self.sim.blimp_v1, hitmap_row, return_labels)
+                    continue
+                result += self.sim.blimp_load_register(self.sim.blimp_v2, hitmap_row, return_labels)
+                merged = bytearray(self.sim.registers[self.sim.blimp_v2])
+                merged[row_offset:row_offset + segment_bytes] = segment
+                self.sim.registers[self.sim.blimp_v2] = merged
+                result += self.sim.blimp_cycle(
+                    1 + int(math.ceil(segment_bytes / self.sim.configuration.hardware_configuration.number_of_vALUs)),
+                    f"\t{self.sim.blimp_v2}[{row_offset}:] <- {self.sim.blimp_v1}[{p * segment_bytes}:]",
+                    return_labels
+                )
+                result += self.sim.blimp_save_register(self.sim.blimp_v2, hitmap_row, return_labels)
+            return result
+
+        # Algorithm bookkeeping
+        runtime += self.sim.blimp_cycle(5, "; initialization", return_labels)
+        bitmaps = [0] * len(predicates)
+        bitdex = 0
+        hitdex = 0
+        current_row = 0
+
+        # Iterate over all records
+        runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
+        for r in range(self.sim.configuration.total_records_processable):  # Iterate over all record rows
+
+            # Calculate the row and offset this record's PI/Key resides in
+            row, offset = self.sim.configuration.pi_location(r)
+
+            runtime += self.sim.blimp_cycle(3, "; row calculation", return_labels)
+            runtime += self.sim.blimp_cycle(3, "; offset calculation", return_labels)
+
+            # Do we need to fetch more data?
+            runtime += self.sim.blimp_cycle(3, "; row check", return_labels)
+            if row != current_row:
+                runtime += self.sim.blimp_load_register(self.sim.blimp_data_scratchpad, row, return_labels)
+                current_row = row
+            data = self.sim.registers[self.sim.blimp_data_scratchpad]
+
+            # Evaluate every predicate against the loaded row
+            for p, predicate in enumerate(predicates):
+                sub_offset = offset + predicate.pi_subindex_offset_bytes
+                runtime += self.sim.blimp_cycle(2, "; suboffset calculation", return_labels)
+
+                # Perform the EQUAL via a byte memcmp
+                runtime += self.sim.blimp_cycle(predicate.pi_element_size_bytes * 2, "; memcmp", return_labels)
+                equal = data[sub_offset:sub_offset + predicate.pi_element_size_bytes] == value_bytes[p]
+
+                # Update some metrics
+                runtime += self.sim.blimp_cycle(4, "; bookkeeping", return_labels)
+                bitmaps[p] <<= 1
+                bitmaps[p] += int(equal) if not predicate.negate else int(not equal)
+            bitdex += 1
+
+            # Manage full hitmaps
+            if bitdex % 8 == 0:
+                for p in range(len(predicates)):
+                    runtime += self.sim.blimp_cycle(4, "; hitmap bookkeeping", return_labels)
+                    self.sim.registers[self.sim.blimp_v1][p * segment_bytes + hitdex % segment_bytes] = bitmaps[p]
+                    bitmaps[p] = 0
+                hitdex += 1
+                # Filled the segments?
+                if hitdex % segment_bytes == 0:
+                    runtime += flush_segments(hitdex)
+
+        # All records are finished processing, pad and save what we have now
+        runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
+        while hitdex % segment_bytes != 0:
+            for p in range(len(predicates)):
+                runtime += self.sim.blimp_cycle(3, "; end bookkeeping", return_labels)
+                bitmaps[p] <<= 1
+            bitdex += 1
+            if bitdex % 8 == 0:
+                for p in range(len(predicates)):
+                    runtime += self.sim.blimp_cycle(4, "; end hitmap bookkeeping", return_labels)
+                    self.sim.registers[self.sim.blimp_v1][p * segment_bytes + hitdex % segment_bytes] = bitmaps[p]
+                    bitmaps[p] = 0
+                hitdex += 1
+        runtime += flush_segments(hitdex)
+
+        runtime += self.sim.blimp_end(return_labels)
+
+        # We have finished the query, decode every hitmap in place
+        results = [
+            SimulationResult.from_hitmap_rows(
+                self.sim.bank_hardware,
+                hitmap_base,
+                rows_per_hitmap,
+                self.sim.configuration.total_records_processable
+            )
+            for hitmap_base in hitmap_bases
+        ]
+        return runtime, results
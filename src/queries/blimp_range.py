@@ -0,0 +1,238 @@
+import typing
+
+from src.queries.query import Query, RangeBound
+from src.simulators.result import RuntimeResult, SimulationResult
+
+from src.simulators.blimp import SimulatedBlimpBank
+
+
+class _BlimpRange(Query):
+    def __init__(self, sim: SimulatedBlimpBank):
+        super().__init__(sim)
+        self.sim = sim
+
+    def _perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            bounds: typing.List[RangeBound],
+            return_labels: bool = False,
+            hitmap_index: int = 0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a generic BLIMP range query operation. Every record's PI/Key is compared against each bound with a
+        byte memcmp, PI/Keys are unsigned and most significant byte first.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on. For example if
+            the PI/Key field is 8 bytes and describes two 4 byte indexes, setting the offset to 4 will target
+            the second index
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param bounds: The bounds a PI/Key must pass to be a hit
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        # Ensure the values are at least valid
+        for bound in bounds:
+            if bound.value >= 2 ** (8 * pi_element_size_bytes):
+                raise RuntimeError(f"This value is too large to be checking against {pi_element_size_bytes} byte "
+                                   f"indices")
+
+        # Begin by enabling BLIMP
+        runtime = self.sim.blimp_begin(return_labels)
+
+        # How many rows are represented by one hitmap
+        rows_per_hitmap = self.sim.configuration.total_rows_for_hitmaps \
+            // self.sim.configuration.database_configuration.hitmap_count
+        hitmap_base = self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * hitmap_index
+
+        # V1 will be our temporary hitmap register
+
+        # Algorithm bookkeeping
+        runtime += self.sim.blimp_cycle(5, "; initialization", return_labels)
+        bitmap = 0
+        bitdex = 0
+        hitdex = 0
+        current_row = 0
+
+        # Iterate over all records
+        runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
+        for r in range(self.sim.configuration.total_records_processable):  # Iterate over all record rows
+
+            # Calculate the row and offset this record's PI/Key resides in
+            row, offset = self.sim.configuration.pi_location(r)
+            sub_offset = offset + pi_subindex_offset_bytes
+
+            runtime += self.sim.blimp_cycle(3, "; row calculation", return_labels)
+            runtime += self.sim.blimp_cycle(3, "; offset calculation", return_labels)
+            runtime += self.sim.blimp_cycle(2, "; suboffset calculation", return_labels)
+
+            # Do we need to fetch more data?
+            runtime += self.sim.blimp_cycle(3, "; row check", return_labels)
+            if row != current_row:
+                runtime += self.sim.blimp_load_register(self.sim.blimp_data_scratchpad, row, return_labels)
+                current_row = row
+            data = self.sim.registers[self.sim.blimp_data_scratchpad]
+
+            # Simulator only, the PI/Key as an unsigned value
+            key = int.from_bytes(data[sub_offset:sub_offset + pi_element_size_bytes], 'big')
+
+            # Order the PI/Key against every bound via a byte memcmp, then check the sign of the comparison
+            hit = True
+            for bound in bounds:
+                runtime += self.sim.blimp_cycle(pi_element_size_bytes * 2, "; memcmp", return_labels)
+                runtime += self.sim.blimp_cycle(2, "; bound check", return_labels)
+                hit = hit and bound.passes(key)
+
+            # Update some metrics
+            runtime += self.sim.blimp_cycle(4, "; bookkeeping", return_labels)
+            bitmap <<= 1
+            bitmap += int(hit)
+            bitdex += 1
+
+            # Manage full hitmaps
+            if bitdex % 8 == 0:
+                runtime += self.sim.blimp_cycle(4, "; hitmap bookkeeping", return_labels)
+                self.sim.registers[self.sim.blimp_v1][hitdex % self.sim.configuration.hardware_configuration.row_buffer_size_bytes] = bitmap
+                hitdex += 1
+                bitmap = 0
+                # Filled this register?
+                if hitdex % self.sim.configuration.hardware_configuration.row_buffer_size_bytes == 0:
+                    runtime += self.sim.blimp_save_register(self.sim.blimp_v1, hitmap_base + ((hitdex - 1) // self.sim.configuration.hardware_configuration.row_buffer_size_bytes), return_labels)
+
+        # All records are finished processing, save what we have now
+        runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
+        while hitdex % self.sim.configuration.hardware_configuration.row_buffer_size_bytes != 0:
+            runtime += self.sim.blimp_cycle(3, "; end bookkeeping", return_labels)
+            bitmap <<= 1
+            bitdex += 1
+            if bitdex % 8 == 0:
+                runtime += self.sim.blimp_cycle(4, "; end hitmap bookkeeping", return_labels)
+                self.sim.registers[self.sim.blimp_v1][hitdex % self.sim.configuration.hardware_configuration.row_buffer_size_bytes] = bitmap
+                hitdex += 1
+                bitmap = 0
+        runtime += self.sim.blimp_save_register(self.sim.blimp_v1, hitmap_base + ((hitdex - 1) // self.sim.configuration.hardware_configuration.row_buffer_size_bytes), return_labels)
+
+        runtime += self.sim.blimp_end(return_labels)
+
+        # We have finished the query, decode the hitmap rows in place
+        result = SimulationResult.from_hitmap_rows(
+            self.sim.bank_hardware,
+            hitmap_base,
+            rows_per_hitmap,
+            self.sim.configuration.total_records_processable
+        )
+        return runtime, result
+
+
+class BlimpLessThan(_BlimpRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            value: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a BLIMP LESS THAN query operation, hitting every record whose PI/Key is less than the value. If the
+        PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param value: The value to check all targeted PI/Keys against. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(value, greater=False, inclusive=False)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class BlimpLessThanOrEqual(_BlimpRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            value: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a BLIMP LESS THAN OR EQUAL query operation, hitting every record whose PI/Key is at most the value. If
+        the PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param value: The value to check all targeted PI/Keys against. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(value, greater=False, inclusive=True)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class BlimpGreaterThan(_BlimpRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            value: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a BLIMP GREATER THAN query operation, hitting every record whose PI/Key is greater than the value. If
+        the PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param value: The value to check all targeted PI/Keys against. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(value, greater=True, inclusive=False)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class BlimpBetween(_BlimpRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            low: int,
+            high: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a BLIMP BETWEEN query operation, hitting every record whose PI/Key is within [low, high]. If the PI/Key
+        field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param low: The inclusive lower bound. This must be less than 2^pi_element_size
+        @param high: The inclusive upper bound. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(low, greater=True, inclusive=True), RangeBound(high, greater=False, inclusive=True)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
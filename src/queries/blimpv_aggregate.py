@@ -0,0 +1,287 @@
+from src.queries.query import Query
+from src.simulators.result import RuntimeResult, AggregateResult
+from src.utils import bitmanip
+
+from src.simulators.blimp import SimulatedBlimpBank
+
+
+class _BlimpVAggregate(Query):
+    COUNT = "count"
+    SUM = "sum"
+    MIN = "min"
+    MAX = "max"
+
+    def __init__(self, sim: SimulatedBlimpBank):
+        super().__init__(sim)
+        self.sim = sim
+
+    def _perform_count(
+            self,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, AggregateResult):
+        """
+        Perform a BLIMP-V COUNT, a population count of the hitmap one processor word at a time. Hitmaps are padded with
+        1s past the last record, so the padding of the final hitmap row is masked off.
+
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to count the hits of
+        """
+        # Begin by enabling BLIMP
+        runtime = self.sim.blimp_begin(return_labels)
+
+        # How many rows are represented by one hitmap
+        rows_per_hitmap = self.sim.configuration.total_rows_for_hitmaps \
+            // self.sim.configuration.database_configuration.hitmap_count
+        hitmap_base = self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * hitmap_index
+        bits_per_row = self.sim.configuration.hardware_configuration.row_buffer_size_bytes * 8
+        words_per_row = bits_per_row // self.sim.configuration.hardware_configuration.processor_bit_architecture
+
+        # Algorithm bookkeeping
+        runtime += self.sim.blimp_cycle(5, "; initialization", return_labels)
+        count = 0
+        remaining = self.sim.configuration.total_records_processable
+
+        # Iterate over the hitmap rows that hold records
+        runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
+        for h in range(rows_per_hitmap):
+            if remaining <= 0:
+                break
+            runtime += self.sim.blimp_cycle(3, "; hitmap row calculation", return_labels)
+            runtime += self.sim.blimp_load_register(self.sim.blimp_data_scratchpad, hitmap_base + h, return_labels)
+
+            # popcount every processor word of the row
+            runtime += self.sim.blimp_cycle(4 * words_per_row, "; popcount", return_labels)
+            count += AggregateResult.from_hitmap_byte_array(
+                self.sim.registers[self.sim.blimp_data_scratchpad],
+                min(remaining, bits_per_row),
+                count_only=True
+            ).result_count
+            remaining -= bits_per_row
+            runtime += self.sim.blimp_cycle(2, "; loop return", return_labels)
+
+        runtime += self.sim.blimp_cycle(1, "; return", return_labels)
+        runtime += self.sim.blimp_end(return_labels)
+        return runtime, AggregateResult(count, count)
+
+    def _perform_reduction(
+            self,
+            field_offset_bytes: int,
+            field_size_bytes: int,
+            operation: str,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, AggregateResult):
+        """
+        Perform a generic BLIMP-V reduction (SUM, MIN or MAX) of a record field over the records hit in a hitmap.
+
+        Records are visited row by row. The field lanes of the row's hit records are masked in v2, the row is ANDed with
+        the mask and the masked lanes are reduced with the BLIMP-V tree reduction, so unhit lanes and the other fields
+        of the row reduce as zero. MIN is taken as the complement of the MAX of the complemented fields. Rows without a
+        hit record are not loaded.
+
+        @param field_offset_bytes: The offset (in bytes) of the field within the record, a multiple of its size
+        @param field_size_bytes: The field size in bytes, a BLIMP-V SEW
+        @param operation: Which reduction to perform, SUM, MIN or MAX
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap holds the records to reduce over
+        """
+        hardware = self.sim.configuration.hardware_configuration
+        database = self.sim.configuration.database_configuration
+
+        # Ensure the field is at least valid
+        if field_size_bytes < hardware.blimpv_sew_min_bytes or field_size_bytes > hardware.blimpv_sew_max_bytes:
+            raise RuntimeError(f"A field of {field_size_bytes} bytes is not a valid SEW for this configuration")
+        elif field_offset_bytes + field_size_bytes > database.total_record_size_bytes:
+            raise RuntimeError("The field does not fit within the record")
+
+        # Where the field is stored; its region's first row, the stride between records and its offset in each
+        base_row, stride_bytes, field_offset_bytes = self.sim.configuration.field_region(field_offset_bytes)
+        if field_offset_bytes + field_size_bytes > stride_bytes:
+            raise RuntimeError("The field spans both the PI/Key column and the data of the record")
+
+        # How many records or rows are represented per row or record, respectively
+        records_per_row = max(1, hardware.row_buffer_size_bytes // stride_bytes)
+        rows_per_record = stride_bytes // hardware.row_buffer_size_bytes
+
+        # Every field must start on a lane boundary of the vector registers
+        if field_offset_bytes % field_size_bytes != 0 or \
+                (records_per_row > 1 and stride_bytes % field_size_bytes != 0):
+            raise RuntimeError("The field is not aligned to its size within the row")
+
+        # How many rows are represented by one hitmap
+        rows_per_hitmap = self.sim.configuration.total_rows_for_hitmaps // database.hitmap_count
+        hitmap_base = self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * hitmap_index
+        bits_per_row = hardware.row_buffer_size_bytes * 8
+
+        # Begin by enabling BLIMP
+        runtime = self.sim.blimp_begin(return_labels)
+
+        # Algorithm bookkeeping
+        runtime += self.sim.blimp_cycle(5, "; initialization", return_labels)
+        aggregate = 0
+        hits = 0
+        current_hitmap_row = -1
+        field_max = 2 ** (8 * field_size_bytes) - 1
+
+        # Iterate over all record rows
+        runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
+        for first_record in range(0, self.sim.configuration.total_records_processable, records_per_row):
+            # Calculate the row the fields of these records reside in
+            runtime += self.sim.blimp_cycle(3, "; row calculation", return_labels)
+            if rows_per_record > 0:  # Multi-row per record
+                row = base_row + first_record * rows_per_record + field_offset_bytes // hardware.row_buffer_size_bytes
+            else:  # Multi-record per row
+                row = base_row + first_record // records_per_row
+            last_record = min(first_record + records_per_row, self.sim.configuration.total_records_processable)
+
+            # let v2 be the lane mask of the hit records
+            runtime += self.sim.blimpv_alu_int_xor(self.sim.blimp_v2, self.sim.blimp_v2, field_size_bytes,
+                                                   return_labels)
+            selected = 0
+            for r in range(first_record, last_record):
+                # Do we need to fetch more of the hitmap?
+                hitmap_row = hitmap_base + r // bits_per_row
+                if hitmap_row != current_hitmap_row:
+                    runtime += self.sim.blimp_load_register(self.sim.blimp_data_scratchpad, hitmap_row,
+                                                            return_labels)
+                    current_hitmap_row = hitmap_row
+                hitmap = self.sim.registers[self.sim.blimp_data_scratchpad]
+
+                runtime += self.sim.blimp_cycle(3, "; bit test", return_labels)
+                if bitmanip.msb_bit(hitmap[(r % bits_per_row) // 8], r % 8, 8):
+                    runtime += self.sim.blimp_cycle(2, "; mask lane", return_labels)
+                    lane = ((r - first_record) * stride_bytes + field_offset_bytes) % hardware.row_buffer_size_bytes
+                    self.sim.registers[self.sim.blimp_v2][lane:lane + field_size_bytes] = b"\xff" * field_size_bytes
+                    selected += 1
+
+            if not selected:
+                runtime += self.sim.blimp_cycle(1, "; skip row", return_labels)
+                continue
+
+            # let v1 be the fields of this row, complemented for MIN, and mask them into v2
+            runtime += self.sim.blimp_load_register(self.sim.blimp_v1, row, return_labels)
+            if operation == self.MIN:
+                runtime += self.sim.blimpv_alu_int_not(self.sim.blimp_v1, field_size_bytes, return_labels)
+            runtime += self.sim.blimpv_alu_int_and(self.sim.blimp_v1, self.sim.blimp_v2, field_size_bytes,
+                                                   return_labels)
+
+            # Reduce v2 into its first lane and fold it into the running aggregate
+            if operation == self.SUM:
+                runtime += self.sim.blimpv_alu_int_sum(self.sim.blimp_v2, field_size_bytes, return_labels)
+                reduced = bitmanip.byte_array_to_int(
+                    self.sim.registers[self.sim.blimp_v2][:hardware.blimpv_sew_max_bytes]
+                )
+                aggregate = (aggregate + reduced) % 2 ** hardware.processor_bit_architecture
+            else:
+                runtime += self.sim.blimpv_alu_int_max(self.sim.blimp_v2, field_size_bytes, return_labels)
+                reduced = bitmanip.byte_array_to_int(self.sim.registers[self.sim.blimp_v2][:field_size_bytes])
+                aggregate = max(aggregate, reduced)
+            runtime += self.sim.blimp_cycle(3, "; accumulate", return_labels)
+            hits += selected
+
+        runtime += self.sim.blimp_cycle(1, "; return", return_labels)
+        runtime += self.sim.blimp_end(return_labels)
+
+        # MIN and MAX have no value over no records
+        if operation != self.SUM and not hits:
+            return runtime, AggregateResult(None, 0)
+        if operation == self.MIN:
+            aggregate = field_max - aggregate
+        return runtime, AggregateResult(aggregate, hits)
+
+
+class BlimpVCount(_BlimpVAggregate):
+    def perform_operation(
+            self,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, AggregateResult):
+        """
+        Perform a BLIMP-V COUNT aggregation, counting the records hit in a hitmap. Return debug labels if specified.
+
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to count the hits of
+        """
+        return self._perform_count(
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class BlimpVSum(_BlimpVAggregate):
+    def perform_operation(
+            self,
+            field_offset_bytes: int,
+            field_size_bytes: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, AggregateResult):
+        """
+        Perform a BLIMP-V SUM aggregation of an unsigned record field over the records hit in a hitmap. The sum wraps
+        at the processor word size. Return debug labels if specified.
+
+        @param field_offset_bytes: The offset (in bytes) of the field within the record, a multiple of its size
+        @param field_size_bytes: The field size in bytes, a BLIMP-V SEW
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap holds the records to reduce over
+        """
+        return self._perform_reduction(
+            field_offset_bytes=field_offset_bytes,
+            field_size_bytes=field_size_bytes,
+            operation=self.SUM,
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class BlimpVMin(_BlimpVAggregate):
+    def perform_operation(
+            self,
+            field_offset_bytes: int,
+            field_size_bytes: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, AggregateResult):
+        """
+        Perform a BLIMP-V MIN aggregation of an unsigned record field over the records hit in a hitmap. Return debug
+        labels if specified.
+
+        @param field_offset_bytes: The offset (in bytes) of the field within the record, a multiple of its size
+        @param field_size_bytes: The field size in bytes, a BLIMP-V SEW
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap holds the records to reduce over
+        """
+        return self._perform_reduction(
+            field_offset_bytes=field_offset_bytes,
+            field_size_bytes=field_size_bytes,
+            operation=self.MIN,
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class BlimpVMax(_BlimpVAggregate):
+    def perform_operation(
+            self,
+            field_offset_bytes: int,
+            field_size_bytes: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, AggregateResult):
+        """
+        Perform a BLIMP-V MAX aggregation of an unsigned record field over the records hit in a hitmap. Return debug
+        labels if specified.
+
+        @param field_offset_bytes: The offset (in bytes) of the field within the record, a multiple of its size
+        @param field_size_bytes: The field size in bytes, a BLIMP-V SEW
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap holds the records to reduce over
+        """
+        return self._perform_reduction(
+            field_offset_bytes=field_offset_bytes,
+            field_size_bytes=field_size_bytes,
+            operation=self.MAX,
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
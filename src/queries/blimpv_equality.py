@@ -2,11 +2,11 @@ from src.queries.query import Query
 from src.simulators.result import RuntimeResult, SimulationResult
 from src.utils import bitmanip
 
-from src.simulators.ambit import SimulatedAmbitBank
+from src.simulators.blimp import SimulatedBlimpBank
 
 
 class _BlimpVEquality(Query):
-    def __init__(self, sim: SimulatedAmbitBank):
+    def __init__(self, sim: SimulatedBlimpBank):
         super().__init__(sim)
         self.sim = sim
 
@@ -60,7 +60,7 @@ class _BlimpVEquality(Query):
                 # PI/Key base row + record chunk index + subindex offset + bit
                 runtime += self.sim.blimp_cycle(10, "; row calculation", return_labels)
                 row_to_check = \
-                    self.sim.configuration.address_mapping["ambit_pi_field"][0] + \
+                    self.sim.bit_sliced_pi_base_row + \
                     h * self.sim.configuration.database_configuration.total_index_size_bytes * 8 + \
                     pi_subindex_offset_bytes * 8 + \
                     b
@@ -73,9 +73,9 @@ class _BlimpVEquality(Query):
                 # let v2 be value[bit]; depending on the bit of the value for this row, fetch a 0 or 1
                 runtime += self.sim.blimp_cycle(3, "cmp bit", return_labels)
                 if bit_at_value:
-                    runtime += self.sim.blimp_load_register(self.sim.blimp_v2, self.sim.ambit_c1, return_labels)
+                    runtime += self.sim.blimp_load_register(self.sim.blimp_v2, self.sim.constant_one_row, return_labels)
                 else:
-                    runtime += self.sim.blimp_load_register(self.sim.blimp_v2, self.sim.ambit_c0, return_labels)
+                    runtime += self.sim.blimp_load_register(self.sim.blimp_v2, self.sim.constant_zero_row, return_labels)
 
                 # perform v1 XNOR v2, v2 has the result
                 runtime += self.sim.blimpv_alu_int_xnor(
@@ -119,17 +119,11 @@ class _BlimpVEquality(Query):
             runtime += self.sim.blimp_cycle(2, "; loop return", return_labels)
         runtime += self.sim.blimp_end(return_labels)
 
-        # We have finished the query, fetch the hitmap to one single hitmap row
-        hitmap_byte_array = []
-        for h in range(rows_per_hitmap):
-            # Calculate the hitmap we are targeting: Base Hitmap address + hitmap index + sub-hitmap index
-            hitmap_row = self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * hitmap_index + h
-
-            # Append the byte array for the next hitmap sub row
-            hitmap_byte_array += self.sim.bank_hardware.get_row_bytes(hitmap_row)
-
-        result = SimulationResult.from_hitmap_byte_array(
-            hitmap_byte_array,
+        # We have finished the query, decode the hitmap rows in place
+        result = SimulationResult.from_hitmap_rows(
+            self.sim.bank_hardware,
+            hitmap_base,
+            rows_per_hitmap,
             self.sim.configuration.total_records_processable
         )
         return runtime, result
@@ -0,0 +1,247 @@
+import typing
+
+from src.queries.query import Query, RangeBound
+from src.simulators.result import RuntimeResult, SimulationResult
+from src.utils import bitmanip
+
+from src.simulators.blimp import SimulatedBlimpBank
+
+
+class _BlimpVRange(Query):
+    def __init__(self, sim: SimulatedBlimpBank):
+        super().__init__(sim)
+        self.sim = sim
+
+    def _perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            bounds: typing.List[RangeBound],
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a generic BLIMP-V range query operation over the bit-sliced PI/Key field.
+
+        Each bound is evaluated from the least significant bit up, keeping whether the bits seen so far pass the
+        bound in v2. At a bit where the PI/Key and the value differ, that bit alone decides the comparison of all the
+        bits so far; where they are equal the result of the lower bits carries through. For a LESS bound this is
+        v2 = ~PI[bit] OR v2 when the value bit is set and v2 = ~PI[bit] AND v2 when it is clear (GREATER bounds mirror
+        it without the NOT), starting from all ones for an inclusive bound and all zeros otherwise. The hitmap is
+        overwritten with the conjunction of every bound.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on. For example if
+            the PI/Key field is 8 bytes and describes two 4 byte indexes, setting the offset to 4 will target
+            the second index
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param bounds: The bounds a PI/Key must pass to be a hit
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        # Ensure the values are at least valid
+        for bound in bounds:
+            if bound.value >= 2**(8*pi_element_size_bytes):
+                raise RuntimeError(f"This value is too large to be checking against {pi_element_size_bytes} byte "
+                                   f"indices")
+
+        # Begin by enabling BLIMP
+        runtime = self.sim.blimp_begin(return_labels)
+
+        # How many rows are represented by one hitmap
+        rows_per_hitmap = self.sim.configuration.total_rows_for_hitmaps \
+            // self.sim.configuration.database_configuration.hitmap_count
+        hitmap_base = self.sim.configuration.address_mapping["hitmaps"][0] + rows_per_hitmap * hitmap_index
+
+        # Iterate over all hitmap rows
+        runtime += self.sim.blimp_cycle(1, "; loop start", return_labels)
+        for h in range(rows_per_hitmap):
+            runtime += self.sim.blimp_cycle(3, "; hitmap row calculation", return_labels)
+            # Calculate the hitmap we are targeting: Base Hitmap address + hitmap index + sub-hitmap index
+            hitmap_row = hitmap_base + h
+
+            for k, bound in enumerate(bounds):
+                # let v2 be the result of no bits; equal so far, so only inclusive bounds pass
+                runtime += self.sim.blimp_cycle(3, "cmp inclusive", return_labels)
+                if bound.inclusive:
+                    runtime += self.sim.blimp_load_register(self.sim.blimp_v2, self.sim.constant_one_row, return_labels)
+                else:
+                    runtime += self.sim.blimp_load_register(self.sim.blimp_v2, self.sim.constant_zero_row, return_labels)
+
+                # Iterate over the bits per this chunk of records, least significant first
+                runtime += self.sim.blimp_cycle(1, "; inner loop start", return_labels)
+                for b in reversed(range(pi_element_size_bytes * 8)):
+                    runtime += self.sim.blimp_cycle(5, "; bit calculation", return_labels)
+                    bit_at_value = bitmanip.msb_bit(bound.value, b, 8 * pi_element_size_bytes)
+
+                    # Calculate the row offset to fetch
+                    # PI/Key base row + record chunk index + subindex offset + bit
+                    runtime += self.sim.blimp_cycle(10, "; row calculation", return_labels)
+                    row_to_check = \
+                        self.sim.bit_sliced_pi_base_row + \
+                        h * self.sim.configuration.database_configuration.total_index_size_bytes * 8 + \
+                        pi_subindex_offset_bytes * 8 + \
+                        b
+
+                    # let v1 be PI[bit], inverted for LESS bounds
+                    runtime += self.sim.blimp_load_register(self.sim.blimp_v1, row_to_check, return_labels)
+                    if not bound.greater:
+                        runtime += self.sim.blimpv_alu_int_not(
+                            self.sim.blimp_v1,
+                            pi_element_size_bytes,
+                            return_labels
+                        )
+
+                    # Where PI[bit] decides the comparison it passes if v1 is set, otherwise v2 carries through
+                    runtime += self.sim.blimp_cycle(3, "cmp bit", return_labels)
+                    if bool(bit_at_value) != bound.greater:
+                        runtime += self.sim.blimpv_alu_int_or(
+                            self.sim.blimp_v1,
+                            self.sim.blimp_v2,
+                            pi_element_size_bytes,
+                            return_labels
+                        )
+                    else:
+                        runtime += self.sim.blimpv_alu_int_and(
+                            self.sim.blimp_v1,
+                            self.sim.blimp_v2,
+                            pi_element_size_bytes,
+                            return_labels
+                        )
+                    runtime += self.sim.blimp_cycle(2, "; inner loop return", return_labels)
+
+                # The bound is complete, the first is saved as is and the others are AND'd into the hitmap
+                if k > 0:
+                    runtime += self.sim.blimp_load_register(self.sim.blimp_v1, hitmap_row, return_labels)
+                    runtime += self.sim.blimpv_alu_int_and(
+                        self.sim.blimp_v1,
+                        self.sim.blimp_v2,
+                        pi_element_size_bytes,
+                        return_labels
+                    )
+                runtime += self.sim.blimp_save_register(self.sim.blimp_v2, hitmap_row, return_labels)
+
+            runtime += self.sim.blimp_cycle(2, "; loop return", return_labels)
+        runtime += self.sim.blimp_end(return_labels)
+
+        # We have finished the query, decode the hitmap rows in place
+        result = SimulationResult.from_hitmap_rows(
+            self.sim.bank_hardware,
+            hitmap_base,
+            rows_per_hitmap,
+            self.sim.configuration.total_records_processable
+        )
+        return runtime, result
+
+
+class BlimpVLessThan(_BlimpVRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            value: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a BLIMP-V LESS THAN query operation, hitting every record whose PI/Key is less than the value. If the
+        PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param value: The value to check all targeted PI/Keys against. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(value, greater=False, inclusive=False)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class BlimpVLessThanOrEqual(_BlimpVRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            value: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a BLIMP-V LESS THAN OR EQUAL query operation, hitting every record whose PI/Key is at most the value.
+        If the PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param value: The value to check all targeted PI/Keys against. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(value, greater=False, inclusive=True)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class BlimpVGreaterThan(_BlimpVRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            value: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a BLIMP-V GREATER THAN query operation, hitting every record whose PI/Key is greater than the value.
+        If the PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param value: The value to check all targeted PI/Keys against. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(value, greater=True, inclusive=False)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
+
+
+class BlimpVBetween(_BlimpVRange):
+    def perform_operation(
+            self,
+            pi_subindex_offset_bytes: int,
+            pi_element_size_bytes: int,
+            low: int,
+            high: int,
+            return_labels: bool=False,
+            hitmap_index: int=0
+    ) -> (RuntimeResult, SimulationResult):
+        """
+        Perform a BLIMP-V BETWEEN query operation, hitting every record whose PI/Key is within [low, high]. If the
+        PI/Key field is segmented, specify the segment offset and its size. Return debug labels if specified.
+
+        @param pi_subindex_offset_bytes: The PI/Key field offset (in bytes) where to start checking on
+        @param pi_element_size_bytes: The PI/Key field size in bytes.
+        @param low: The inclusive lower bound. This must be less than 2^pi_element_size
+        @param high: The inclusive upper bound. This must be less than 2^pi_element_size
+        @param return_labels: Whether to return debug labels with the RuntimeResult history
+        @param hitmap_index: Which hitmap to target results into
+        """
+        return self._perform_operation(
+            pi_subindex_offset_bytes=pi_subindex_offset_bytes,
+            pi_element_size_bytes=pi_element_size_bytes,
+            bounds=[RangeBound(low, greater=True, inclusive=True), RangeBound(high, greater=False, inclusive=True)],
+            return_labels=return_labels,
+            hitmap_index=hitmap_index
+        )
@@ -1,3 +1,5 @@
+import typing
+
 from simulators.result import RuntimeResult, SimulationResult
 from simulators.simulator import SimulatedBank
 
@@ -13,3 +15,19 @@ class Query:
         Overridable method for performing query operations on a simulated bank returning the resulting simulation result
         """
         return RuntimeResult(), SimulationResult()
+
+
+class RangeBound(typing.NamedTuple):
+    """
+    One side of a range predicate; a PI/Key passes it when it is greater (or less) than the value, or equal to the
+    value if the bound is inclusive. Range queries are built from one bound (<, <=, >) or two (BETWEEN).
+    """
+    value: int
+    greater: bool
+    inclusive: bool
+
+    def passes(self, key: int) -> bool:
+        """Whether a PI/Key value passes this bound"""
+        if key == self.value:
+            return self.inclusive
+        return key > self.value if self.greater else key < self.value
@@ -3,7 +3,6 @@ from src.hardware.bank import AmbitBank
 from src.generators.records import DatabaseRecordGenerator
 from src.simulators.blimp import SimulatedBlimpBank
 from src.utils import performance
-from src.utils import bitmanip
 from src.simulators.result import RuntimeResult
 
 
@@ -58,9 +57,6 @@ class SimulatedAmbitBank(SimulatedBlimpBank):
         self._logger.info(f"beginning ambit layout procedure")
         performance.start_performance_tracking()
 
-        # Place PI/Key fields vertically
-        self.place_ambit_pi_fields(record_set)
-
         # Reset/Initialize ambit control rows if specified
         reset_control_rows = kwargs.get('reset_control_rows', True)
         if reset_control_rows:
@@ -68,41 +64,14 @@ class SimulatedAmbitBank(SimulatedBlimpBank):
             self.reset_ambit_control_rows()
         self._logger.info(f"ambit layout completed in {performance.end_performance_tracking()}s")
 
+    def place_pi_fields(self, record_generator: DatabaseRecordGenerator):
+        """AMBIT always holds its PI/Key fields vertically, BLIMP-V shares them"""
+        self.place_ambit_pi_fields(record_generator)
+
     def place_ambit_pi_fields(self, record_generator: DatabaseRecordGenerator):
         """Given a record generator, place pi fields/keys into the AMBIT D-group region vertically"""
-        self._logger.info(f"ambit vertical layout beginning")
-        performance.start_performance_tracking()
-
         base_ambit_pi_row, ambit_pi_row_count = self.configuration.address_mapping["ambit_pi_field"]
-
-        # Load the P/I fields into the ambit rows
-        for pi_row in range(ambit_pi_row_count):
-            # Calculate meta-specifics
-            record_page = pi_row // (self.configuration.database_configuration.total_index_size_bytes * 8)
-            record_bit_index = pi_row % (self.configuration.database_configuration.total_index_size_bytes * 8)
-            start_record = record_page * self.configuration.hardware_configuration.row_buffer_size_bytes * 8
-
-            # Generate a new constructed row based on the current meta-specifics
-            raw_value = 0
-            for j in range(self.configuration.hardware_configuration.row_buffer_size_bytes * 8):
-                # Ensure we are placing the same number of records in ambit rows as we are in data
-                if start_record + j < self.configuration.total_records_processable:
-                    # Fetch a record from the bank based on it's index
-                    raw_value <<= 1
-                    pi = record_generator.get_pi_field(start_record + j)
-                    bit = bitmanip.msb_bit(
-                        pi,
-                        record_bit_index,
-                        self.configuration.database_configuration.total_index_size_bytes * 8
-                    )
-                    raw_value += bit
-                else:
-                    # If we reach our limit, null pad the rest of ambit rows
-                    raw_value <<= 1
-
-            # Set this new translated row into the bank
-            self.bank_hardware.set_raw_row(base_ambit_pi_row + pi_row, raw_value)
-        self._logger.info(f"data layout completed in {performance.end_performance_tracking()}s")
+        self.place_bit_sliced_pi_fields(record_generator, base_ambit_pi_row, ambit_pi_row_count)
 
     def reset_ambit_control_rows(self):
         """Reset/Initialize all ambit controlled rows; This sets the C-group, and defines the B-group rows"""
@@ -146,6 +115,21 @@ class SimulatedAmbitBank(SimulatedBlimpBank):
             raise RuntimeError(f"register T{register_index} does not exist in this configuration")
         return self._ambit_t_base + register_index
 
+    @property
+    def bit_sliced_pi_base_row(self) -> int:
+        """The first row of the bit sliced PI/Key fields, the ambit pi-field"""
+        return self.configuration.address_mapping["ambit_pi_field"][0]
+
+    @property
+    def constant_zero_row(self) -> int:
+        """Ambit C-group C0"""
+        return self.ambit_control_zero_row
+
+    @property
+    def constant_one_row(self) -> int:
+        """Ambit C-group C1"""
+        return self.ambit_control_one_row
+
     @property
     def ambit_c0(self):
         """Ambit C-group C0"""
@@ -254,13 +238,14 @@ class SimulatedAmbitBank(SimulatedBlimpBank):
 
         # If the destination is one of the DCC rows, invert the other one
         if dst_row in self._ambit_dcc_map:
-            inverted_value = self.bank_hardware.get_inverted_raw_row(dst_row)
-            self.bank_hardware.set_raw_row(self._ambit_dcc_map[dst_row][0], inverted_value)
+            self.bank_hardware.invert_row(dst_row, self._ambit_dcc_map[dst_row][0])
 
-        # Return the result of the operation
-        return self.ambit_blimp_dispatch(return_labels) + RuntimeResult(
+        # Return the result of the operation, the AAP closes the rows it activates
+        result = self.ambit_blimp_dispatch(return_labels) + self.row_buffer.precharge(src_row, dst_row)
+        return result + RuntimeResult(
             self.configuration.hardware_configuration.time_for_AAP_rowclone_ns,
-            f"AAP {self._get_row_nice_name(src_row)} -> {self._get_row_nice_name(dst_row)}" if return_labels else ""
+            f"AAP {self._get_row_nice_name(src_row)} -> {self._get_row_nice_name(dst_row)}" if return_labels else "",
+            (RuntimeResult.AAP,)
         )
 
     def ambit_invert(self, src_row: int, dcc_row: int, dst_row: int, return_labels=True) -> RuntimeResult:
@@ -308,19 +293,19 @@ class SimulatedAmbitBank(SimulatedBlimpBank):
 
         # If one of the operands was a DCC row, update its inverse
         if a_row in self._ambit_dcc_map:
-            inverted_value = self.bank_hardware.get_inverted_raw_row(a_row)
-            self.bank_hardware.set_raw_row(self._ambit_dcc_map[a_row][0], inverted_value)
+            self.bank_hardware.invert_row(a_row, self._ambit_dcc_map[a_row][0])
         if b_row in self._ambit_dcc_map:
-            inverted_value = self.bank_hardware.get_inverted_raw_row(b_row)
-            self.bank_hardware.set_raw_row(self._ambit_dcc_map[b_row][0], inverted_value)
+            self.bank_hardware.invert_row(b_row, self._ambit_dcc_map[b_row][0])
         if c_row in self._ambit_dcc_map:
-            inverted_value = self.bank_hardware.get_inverted_raw_row(c_row)
-            self.bank_hardware.set_raw_row(self._ambit_dcc_map[c_row][0], inverted_value)
+            self.bank_hardware.invert_row(c_row, self._ambit_dcc_map[c_row][0])
 
-        return self.ambit_blimp_dispatch(return_labels) + RuntimeResult(
+        # The TRA closes the rows it activates
+        result = self.ambit_blimp_dispatch(return_labels) + self.row_buffer.precharge(a_row, b_row, c_row)
+        return result + RuntimeResult(
             self.configuration.hardware_configuration.time_for_TRA_MAJ_ns,
             f"TRA {self._get_row_nice_name(a_row)} {self._get_row_nice_name(b_row)} {self._get_row_nice_name(c_row)}"
-            if return_labels else ""
+            if return_labels else "",
+            (RuntimeResult.TRA,)
         )
 
     def ambit_and(self, a_row: int, b_row: int, control_dst: int, return_labels=True) -> RuntimeResult:
@@ -329,7 +314,7 @@ class SimulatedAmbitBank(SimulatedBlimpBank):
         ambit_setup = self.ambit_copy(self._ambit_control_0_row, control_dst, return_labels)
 
         # Perform the TRA result
-        tra_runtime = self.ambit_tra(a_row, b_row, control_dst)
+        tra_runtime = self.ambit_tra(a_row, b_row, control_dst, return_labels)
 
         # Return the result
         return ambit_setup + tra_runtime
@@ -340,11 +325,12 @@ class SimulatedAmbitBank(SimulatedBlimpBank):
         ambit_setup = self.ambit_copy(self._ambit_control_1_row, control_dst, return_labels)
 
         # Perform the TRA result
-        tra_runtime = self.ambit_tra(a_row, b_row, control_dst)
+        tra_runtime = self.ambit_tra(a_row, b_row, control_dst, return_labels)
 
         # Return the result
         return ambit_setup + tra_runtime
 
     def ambit_blimp_dispatch(self, return_labels=True) -> RuntimeResult:
         """Have BLIMP send an AMBIT command sequence"""
-        return self.blimp_cycle(label='bbop[ambit]  ; blimp dispatch' if return_labels else "")
+        return self.blimp_cycle(label='bbop[ambit]  ; blimp dispatch' if return_labels else "",
+                                return_labels=return_labels)
@@ -1,12 +1,14 @@
+import copy
 import math
 
 from src.configurations.bank_layout import BlimpBankLayoutConfiguration
 from src.hardware.bank import BlimpBank
 from src.generators.records import DatabaseRecordGenerator
 from src.simulators.simulator import SimulatedBank
-from src.simulators.result import RuntimeResult
+from src.simulators.dram_timing import RowBufferTiming
+from src.simulators.result import RuntimeResult, SimulationResult, BitmapResult
 from src.utils import performance
-from src.utils.bitmanip import byte_array_to_int, int_to_byte_array
+from src.utils.bitmanip import int_to_row, lanes_add, lanes_sub, lanes_zero, lane_mask, row_to_int
 
 
 class SimulatedBlimpBank(SimulatedBank):
@@ -22,12 +24,13 @@ class SimulatedBlimpBank(SimulatedBank):
         self.bank_hardware = bank_hardware
 
         self.registers = {
-            self._v0(): [],
-            self._v1(): [],
-            self._v2(): [],
-            self._instr_buffer(): [],
-            self._data_pad(): []
+            self._v0(): bytearray(),
+            self._v1(): bytearray(),
+            self._v2(): bytearray(),
+            self._instr_buffer(): bytearray(),
+            self._data_pad(): bytearray()
         }
+        self.row_buffer = RowBufferTiming(self.configuration.hardware_configuration)
 
         self._logger.info(f"simulator loaded")
 
@@ -42,8 +45,9 @@ class SimulatedBlimpBank(SimulatedBank):
         self._logger.info(f"beginning blimp layout procedure")
         performance.start_performance_tracking()
 
-        # Place BLIMP Records horizontally
+        # Place BLIMP Records horizontally, then any extra copy of the PI/Key fields
         self.place_blimp_records(record_set)
+        self.place_pi_fields(record_set)
 
         # Reset/Initialize the hitmaps if specified
         reset_hitmaps = kwargs.get('reset_hitmaps', True)
@@ -59,72 +63,96 @@ class SimulatedBlimpBank(SimulatedBank):
         self._logger.info(f"blimp horizontal layout beginning")
         performance.start_performance_tracking()
         base_record_row, record_row_count = self.configuration.address_mapping["records"]
+        row_buffer_size_bytes = self.configuration.hardware_configuration.row_buffer_size_bytes
+        records = self.configuration.total_records_processable
 
         # See if we are in a multi-record-per-row configuration or multi-row-per-record
-        records_per_row = self.configuration.hardware_configuration.row_buffer_size_bytes \
-            // self.configuration.database_configuration.total_record_size_bytes
-        records_placed = 0
-
-        if records_per_row > 0:
+        record_size_bytes = self.configuration.stored_record_size_bytes
+        if row_buffer_size_bytes // record_size_bytes > 0:
             self._logger.info("performing multi-record row layout")
-            # Multiple (or one) records per row; record size <= row buffer
-            for row_index in range(record_row_count):
-                # Construct a temporary location for the row / records
-                records_in_row = []
-
-                # Fetch all records in this row, if we are at the end, null pad with zeros
-                for sub_record_index in range(records_per_row):
-                    if records_placed < self.configuration.total_records_processable:
-                        records_in_row.append(
-                            record_generator.get_raw_record(row_index * records_per_row + sub_record_index)
-                        )
-                        records_placed += 1
-                    else:
-                        records_in_row.append(record_generator.get_null_record())
-
-                # Construct the raw value byte array for the hardware
-                raw_value = 0
-                for raw in records_in_row:
-                    raw_value <<= (record_generator.record_size_bytes * 8)
-                    raw_value |= raw
-
-                # Store this row with all the records placed
-                self.bank_hardware.set_raw_row(
-                    base_record_row + row_index,
-                    raw_value
-                )
+            # Multiple (or one) records per row; record size <= row buffer, the rows past the last record are null
+            record_rows = record_row_count
         else:
             self._logger.info("performing multi-row record layout")
             # Multiple rows per record; row buffer < record size
-            rows_per_record = self.configuration.database_configuration.total_record_size_bytes \
-                // self.configuration.hardware_configuration.row_buffer_size_bytes
-
-            # For all placeable records, extract row-buffer sized chunks and store them
-            for record_index in range(self.configuration.total_records_processable):
-                # Fetch/Generate the records
-                record = record_generator.get_raw_record(record_index)
-
-                # Chunk the record
-                for sub_row_index in range(rows_per_record):
-                    # Construct the mask for each chunk
-                    row_buffer_mask = (2**(self.configuration.hardware_configuration.row_buffer_size_bytes * 8)) - 1
-                    # Move the mask to the appropriate chunk
-                    record_mask = row_buffer_mask << \
-                        (rows_per_record - 1 - sub_row_index) * \
-                        (self.configuration.hardware_configuration.row_buffer_size_bytes * 8)
-                    # Mask the record to extract the chunk
-                    masked_record = record & record_mask
-                    # Realign the chunk
-                    record_chunk = masked_record >> \
-                        (rows_per_record - 1 - sub_row_index) * \
-                        (self.configuration.hardware_configuration.row_buffer_size_bytes * 8)
-                    # Save the chunk
-                    self.bank_hardware.set_raw_row(
-                        base_record_row + (record_index * rows_per_record) + sub_row_index,
-                        record_chunk
-                    )
+            record_rows = records * (record_size_bytes // row_buffer_size_bytes)
+
+        # Null the record rows, then scatter the PI/Key and data columns into them, one record size apart. Columnar
+        # layouts hold the PI/Keys in their own column, only the (end padded) data fields are placed here
+        self.bank_hardware.clear_rows(base_record_row, record_rows)
+        first_byte = base_record_row * row_buffer_size_bytes
+        if self.configuration.pi_layout != BlimpBankLayoutConfiguration.PI_LAYOUT_COLUMNAR:
+            self.bank_hardware.scatter_column(
+                record_generator.get_pi_column(0, records),
+                record_generator.pi_size_bytes,
+                first_byte,
+                record_size_bytes
+            )
+            first_byte += record_generator.pi_size_bytes
+        self.bank_hardware.scatter_column(
+            record_generator.get_data_column(0, records),
+            record_generator.data_size_bytes,
+            first_byte,
+            record_size_bytes
+        )
         self._logger.info(f"data layout completed in {performance.end_performance_tracking()}s")
 
+    def place_pi_fields(self, record_generator: DatabaseRecordGenerator):
+        """Given a record generator, place the extra PI/Key field copy the layout configuration asks for, if any"""
+        if self.configuration.pi_layout == BlimpBankLayoutConfiguration.PI_LAYOUT_BIT_SLICED:
+            base_pi_row, pi_row_count = self.configuration.address_mapping["pi_field"]
+            self.place_bit_sliced_pi_fields(record_generator, base_pi_row, pi_row_count)
+
+            # The constants BLIMP-V compares bit sliced PI/Keys against
+            base_constant_row, _ = self.configuration.address_mapping["pi_constants"]
+            self.bank_hardware.set_raw_row(base_constant_row + 0, 0)
+            self.bank_hardware.set_raw_row(
+                base_constant_row + 1,
+                (2**(self.configuration.hardware_configuration.row_buffer_size_bytes * 8)) - 1
+            )
+        elif self.configuration.packed_pi_fields:
+            self.place_column_packed_pi_fields(record_generator)
+
+    def place_bit_sliced_pi_fields(self, record_generator: DatabaseRecordGenerator, base_pi_row: int,
+                                   pi_row_count: int):
+        """
+        Given a record generator, place pi fields/keys vertically starting at a base row; each row holds one bit of
+        the pi fields of a row buffer width of records, most significant bit first
+        """
+        self._logger.info(f"vertical pi layout beginning")
+        performance.start_performance_tracking()
+
+        self.bank_hardware.bit_slice_column(
+            record_generator.get_pi_column(0, self.configuration.total_records_processable),
+            self.configuration.database_configuration.total_index_size_bytes,
+            base_pi_row,
+            pi_row_count
+        )
+        self._logger.info(f"vertical pi layout completed in {performance.end_performance_tracking()}s")
+
+    def place_column_packed_pi_fields(self, record_generator: DatabaseRecordGenerator):
+        """Given a record generator, place pi fields/keys back to back into the pi field rows, null padded"""
+        self._logger.info(f"column packed pi layout beginning")
+        performance.start_performance_tracking()
+        base_pi_row, pi_row_count = self.configuration.address_mapping["pi_field"]
+
+        row_buffer_size_bytes = self.configuration.hardware_configuration.row_buffer_size_bytes
+        self.bank_hardware.clear_rows(base_pi_row, pi_row_count)
+        self.bank_hardware.scatter_column(
+            record_generator.get_pi_column(0, self.configuration.total_records_processable),
+            self.configuration.database_configuration.total_index_size_bytes,
+            base_pi_row * row_buffer_size_bytes,
+            self.configuration.database_configuration.total_index_size_bytes
+        )
+        self._logger.info(f"column packed pi layout completed in {performance.end_performance_tracking()}s")
+
+    def _save_state(self) -> dict:
+        """Snapshots hold a copy of the BLIMP registers, keeping registers that share a buffer shared"""
+        return {"registers": copy.deepcopy(self.registers)}
+
+    def _load_state(self, state: dict):
+        self.registers = copy.deepcopy(state["registers"])
+
     def reset_hitmap(self, hitmap_index: int, value: bool=True):
         """
         Given a hitmap_index, reset the hitmap values to a provided value. Only resets hitmap bits up to the
@@ -166,6 +194,24 @@ class SimulatedBlimpBank(SimulatedBank):
             ((2 ** remainder) - 1) << null_remainder if value else 0
         )
 
+    def hitmap_result(self, hitmap_index: int, compressed: bool=False) -> SimulationResult:
+        """
+        Fetch the records set in a hitmap, as left by the queries that targeted it. Compressed results are a
+        BitmapResult, which combine with the results of other hitmaps for conjunctive or disjunctive predicates.
+        """
+        if hitmap_index >= self.configuration.database_configuration.hitmap_count:
+            raise IndexError(f"No hitmap at index {hitmap_index} is present in this database configuration")
+
+        base_hitmap_row, hitmap_row_count = self.configuration.address_mapping["hitmaps"]
+        rows_per_hitmap = hitmap_row_count // self.configuration.database_configuration.hitmap_count
+        result_class = BitmapResult if compressed else SimulationResult
+        return result_class.from_hitmap_rows(
+            self.bank_hardware,
+            base_hitmap_row + rows_per_hitmap * hitmap_index,
+            rows_per_hitmap,
+            self.configuration.total_records_processable
+        )
+
     def reset_all_hitmaps(self, value: bool=True):
         """Iterate over all configured hitmaps, reset them to a provided value"""
         self._logger.info("hitmaps beginning to be reset/initialized")
@@ -199,6 +245,27 @@ class SimulatedBlimpBank(SimulatedBank):
         """Register name for the Data Pad"""
         return "data_pad"
 
+    @property
+    def bit_sliced_pi_base_row(self) -> int:
+        """The first row of the bit sliced PI/Key fields BLIMP-V queries scan"""
+        if self.configuration.pi_layout != BlimpBankLayoutConfiguration.PI_LAYOUT_BIT_SLICED:
+            raise RuntimeError("this bank layout has no bit sliced PI/Key fields")
+        return self.configuration.address_mapping["pi_field"][0]
+
+    @property
+    def constant_zero_row(self) -> int:
+        """A row of all zeros, for BLIMP-V to compare bit sliced PI/Keys against"""
+        if self.configuration.pi_layout != BlimpBankLayoutConfiguration.PI_LAYOUT_BIT_SLICED:
+            raise RuntimeError("this bank layout has no constant rows")
+        return self.configuration.address_mapping["pi_constants"][0] + 0
+
+    @property
+    def constant_one_row(self) -> int:
+        """A row of all ones, for BLIMP-V to compare bit sliced PI/Keys against"""
+        if self.configuration.pi_layout != BlimpBankLayoutConfiguration.PI_LAYOUT_BIT_SLICED:
+            raise RuntimeError("this bank layout has no constant rows")
+        return self.configuration.address_mapping["pi_constants"][0] + 1
+
     @property
     def blimp_v0(self):
         """BLIMP V0 pseudo-row-buffer register"""
@@ -230,10 +297,18 @@ class SimulatedBlimpBank(SimulatedBank):
             raise ValueError("argument 'cycles' cannot be less than one")
         runtime = RuntimeResult(
             self.configuration.hardware_configuration.time_per_blimp_cycle_ns,
-            label if return_labels else ""
+            label if return_labels else "",
+            (RuntimeResult.BLIMP_CYCLE,),
+            trace=return_labels
         )
-        for c in range(cycles - 1):
-            runtime.step(self.configuration.hardware_configuration.time_per_blimp_cycle_ns)
+        if runtime.tracing:
+            for c in range(cycles - 1):
+                runtime.step(self.configuration.hardware_configuration.time_per_blimp_cycle_ns,
+                             categories=(RuntimeResult.BLIMP_CYCLE,))
+        else:
+            # Untraced, charge the remaining cycles at once rather than a step per cycle
+            runtime.runtime += (cycles - 1) * self.configuration.hardware_configuration.time_per_blimp_cycle_ns
+            runtime.counters[RuntimeResult.BLIMP_CYCLE] = cycles
         return runtime
 
     def blimp_begin(self, return_labels=True) -> RuntimeResult:
@@ -242,18 +317,21 @@ class SimulatedBlimpBank(SimulatedBank):
         # Initialize the BLIMP instruction buffer register to the first row, others are garbage (but loaded here)
         for r in self.registers:
             self.blimp_load_register(r, 0)
+        self.row_buffer.reset()
 
         return RuntimeResult(
             self.configuration.hardware_configuration.time_to_row_activate_ns,
-            "BLIMP ENABLE" if return_labels else ""
+            "BLIMP ENABLE" if return_labels else "",
+            (RuntimeResult.ROW_ACTIVATE,)
         ) + self.blimp_cycle(cycles=5, label="; setup", return_labels=return_labels)
 
     def blimp_end(self, return_labels=True) -> RuntimeResult:
         """Set the BLIMP-enable signal low to complete BLIMP bank operation"""
-        # All we are simulating is a row access and read to the BLIMP transfer mux
-        return RuntimeResult(
+        # All we are simulating is a row access and read to the BLIMP transfer mux, after closing any rows left open
+        return self.row_buffer.precharge_all() + RuntimeResult(
             self.configuration.hardware_configuration.time_to_row_activate_ns,
-            "BLIMP DISABLE" if return_labels else ""
+            "BLIMP DISABLE" if return_labels else "",
+            (RuntimeResult.ROW_ACTIVATE,)
         )
 
     def blimp_load_register(self, register, row: int, return_labels=True) -> RuntimeResult:
@@ -264,12 +342,8 @@ class SimulatedBlimpBank(SimulatedBank):
         result = self.blimp_cycle(return_labels=return_labels)
 
         # Fetch the row via the row buffer
-        self.registers[self.blimp_v0] = self.bank_hardware.get_row_bytes(row)
-        result += RuntimeResult(
-            self.configuration.hardware_configuration.time_to_row_activate_ns +
-            self.configuration.hardware_configuration.time_to_precharge_ns,
-            f"mem[{row}] -> {self.blimp_v0}" if return_labels else ""
-        )
+        self.registers[self.blimp_v0] = bytearray(self.bank_hardware.get_row_view(row))
+        result += self.row_buffer.access(row, f"mem[{row}] -> {self.blimp_v0}" if return_labels else "")
 
         # The row buffer (and now v0) is loaded with data, transfer it via the mux if necessary
         if register != self.blimp_v0:
@@ -278,14 +352,15 @@ class SimulatedBlimpBank(SimulatedBank):
             # Add time to transfer the row buffer/v0 to the specified mux destination
             result += RuntimeResult(
                 self.configuration.hardware_configuration.time_to_v0_transfer_ns,
-                f"\t{self.blimp_v0} -> {register}" if return_labels else ""
+                f"\t{self.blimp_v0} -> {register}" if return_labels else "",
+                (RuntimeResult.V0_TRANSFER,)
             )
 
         # Return the result of the operation
         return result
 
-    def blimp_get_register(self, register) -> [int]:
-        """Fetch the data for a BLIMP or BLIMP-V register"""
+    def blimp_get_register(self, register) -> bytearray:
+        """Fetch the data for a BLIMP or BLIMP-V register, a row of bytes"""
         if register not in self.registers:
             raise RuntimeError(f"Register '{register}' does not exist")
         return self.registers[register]
@@ -303,16 +378,13 @@ class SimulatedBlimpBank(SimulatedBank):
             self.registers[self.blimp_v0] = self.registers[register]
             result += RuntimeResult(
                 self.configuration.hardware_configuration.time_to_v0_transfer_ns,
-                f"\t{register} -> {self.blimp_v0}" if return_labels else ""
+                f"\t{register} -> {self.blimp_v0}" if return_labels else "",
+                (RuntimeResult.V0_TRANSFER,)
             )
 
         # Save v0 into the bank memory
         self.bank_hardware.set_row_bytes(row, self.registers[self.blimp_v0])
-        result += RuntimeResult(
-            self.configuration.hardware_configuration.time_to_row_activate_ns +
-            self.configuration.hardware_configuration.time_to_precharge_ns,
-            f"{self.blimp_v0} -> mem[{row}]" if return_labels else ""
-        )
+        result += self.row_buffer.access(row, f"{self.blimp_v0} -> mem[{row}]" if return_labels else "")
 
         # Return the result of the operation
         return result
@@ -329,15 +401,12 @@ class SimulatedBlimpBank(SimulatedBank):
         elif self.configuration.hardware_configuration.row_buffer_size_bytes % sew != 0:
             raise RuntimeError(f"SEW of {sew} does not divide evenly into the configured row buffer width")
 
-        result = 0
-        for sew_chunk in range(self.configuration.hardware_configuration.row_buffer_size_bytes // sew):
-            a = byte_array_to_int(self.registers[register_a][sew_chunk*sew:sew_chunk*sew+sew])
-            c = operation(a)
-            c = ((~c if invert else c) & (2 ** (sew * 8)) - 1)  # eliminate any carry's and invert if needed
-            result <<= sew * 8
-            result += c
+        # The operation works on every SEW element at once, as the lanes of the whole register
+        row_buffer_size_bytes = self.configuration.hardware_configuration.row_buffer_size_bytes
+        c = operation(row_to_int(self.registers[register_a]))
+        c = (~c if invert else c) & ((1 << (8 * row_buffer_size_bytes)) - 1)  # eliminate any carry's and invert if needed
 
-        self.registers[register_a] = int_to_byte_array(result, self.configuration.hardware_configuration.row_buffer_size_bytes)
+        self.registers[register_a] = int_to_row(c, row_buffer_size_bytes)
 
     def _blimpv_alu_binary_operation(self, register_a, register_b, sew, operation, invert):
         """Perform a BLIMP-V binary operation and store the result in Register B"""
@@ -353,16 +422,12 @@ class SimulatedBlimpBank(SimulatedBank):
         elif self.configuration.hardware_configuration.row_buffer_size_bytes % sew != 0:
             raise RuntimeError(f"SEW of {sew} does not divide evenly into the configured row buffer width")
 
-        result = 0
-        for sew_chunk in range(self.configuration.hardware_configuration.row_buffer_size_bytes // sew):
-            a = byte_array_to_int(self.registers[register_a][sew_chunk*sew:sew_chunk*sew+sew])
-            b = byte_array_to_int(self.registers[register_b][sew_chunk*sew:sew_chunk*sew+sew])
-            c = operation(a, b)
-            c = ((~c if invert else c) & (2 ** (sew * 8)) - 1)  # eliminate any carry's and invert if needed
-            result <<= sew * 8
-            result += c
+        # The operation works on every SEW element at once, as the lanes of the whole registers
+        row_buffer_size_bytes = self.configuration.hardware_configuration.row_buffer_size_bytes
+        c = operation(row_to_int(self.registers[register_a]), row_to_int(self.registers[register_b]))
+        c = (~c if invert else c) & ((1 << (8 * row_buffer_size_bytes)) - 1)  # eliminate any carry's and invert if needed
 
-        self.registers[register_b] = int_to_byte_array(result, self.configuration.hardware_configuration.row_buffer_size_bytes)
+        self.registers[register_b] = int_to_row(c, row_buffer_size_bytes)
 
     def _blimpv_alu_int_un_op(self, register_a, sew, operation, invert, op_name, return_labels=True) -> RuntimeResult:
         """Perform a BLIMP-V unary operation on register 'a' on SEW bytes and store the result in register a"""
@@ -502,7 +567,7 @@ class SimulatedBlimpBank(SimulatedBank):
             register_a,
             register_b,
             sew,
-            lambda a, b: a + b,
+            lambda a, b: lanes_add(a, b, sew, self.configuration.hardware_configuration.row_buffer_size_bytes),
             False,
             "ADD",
             return_labels
@@ -515,7 +580,7 @@ class SimulatedBlimpBank(SimulatedBank):
             register_a,
             register_b,
             sew,
-            lambda a, b: a - b,
+            lambda a, b: lanes_sub(a, b, sew, self.configuration.hardware_configuration.row_buffer_size_bytes),
             False,
             "SUB",
             return_labels
@@ -536,10 +601,11 @@ class SimulatedBlimpBank(SimulatedBank):
     def blimpv_alu_int_acc(self, register_a, sew, return_labels=True) -> RuntimeResult:
         """Perform a BLIMP-V ACC operation on register 'a' on SEW bytes and store the result in register a"""
         # Perform the operation
+        row_buffer_size_bytes = self.configuration.hardware_configuration.row_buffer_size_bytes
         return self._blimpv_alu_int_un_op(
             register_a,
             sew,
-            lambda a: a + 1,
+            lambda a: lanes_add(a, lane_mask(1, sew, row_buffer_size_bytes), sew, row_buffer_size_bytes),
             False,
             "ACC",
             return_labels
@@ -551,7 +617,7 @@ class SimulatedBlimpBank(SimulatedBank):
         return self._blimpv_alu_int_un_op(
             register_a,
             sew,
-            lambda a: int(a == 0),
+            lambda a: lanes_zero(a, sew, self.configuration.hardware_configuration.row_buffer_size_bytes),
             False,
             "ZERO",
             return_labels
@@ -572,12 +638,15 @@ class SimulatedBlimpBank(SimulatedBank):
         # Calculate the number of cycles this operation takes
         cycles = 1  # Start with one cycle to dispatch to the vector engine
 
-        # Perform the operation
-        reduction_rounds = math.floor(math.log2(self.configuration.hardware_configuration.row_buffer_size_bytes // sew))
+        # Perform the operation on the elements of the register, writing them back once reduced
+        register = self.registers[register_a]
+        elements = [
+            row_to_int(register[e:e + sew])
+            for e in range(0, self.configuration.hardware_configuration.row_buffer_size_bytes, sew)
+        ]
+        reduction_rounds = math.floor(math.log2(len(elements)))
         for reduction_round in range(reduction_rounds):
-            element_pairs = self.configuration.hardware_configuration.row_buffer_size_bytes \
-                            // sew \
-                            // (2**(reduction_round + 1))
+            element_pairs = len(elements) // (2**(reduction_round + 1))
 
             # Calculate how many SEW ALU rounds are needed
             alu_rounds = int(math.ceil(element_pairs / self.configuration.hardware_configuration.number_of_vALUs))
@@ -586,21 +655,14 @@ class SimulatedBlimpBank(SimulatedBank):
 
             for pair_index in range(element_pairs):
                 pair_neighbor_distance = 2 ** reduction_round
-                left_pair_index = pair_index * 2 * 2 ** (reduction_round + 1)
+                left_pair_index = pair_index * 2 ** (reduction_round + 1)
                 right_pair_index = left_pair_index + pair_neighbor_distance
 
-                left_pair_byte_offset = left_pair_index * sew
-                right_pair_byte_offset = right_pair_index * sew
-
-                a = byte_array_to_int(self.registers[register_a][left_pair_byte_offset:left_pair_byte_offset+sew])
-                b = byte_array_to_int(self.registers[register_a][right_pair_byte_offset:right_pair_byte_offset+sew])
-                c = max(a, b)
-
-                # Set the left to the max
-                self.registers[register_a][left_pair_byte_offset:left_pair_byte_offset + sew] = int_to_byte_array(c, sew)
+                # Set the left to the max and the right to zero
+                elements[left_pair_index] = max(elements[left_pair_index], elements[right_pair_index])
+                elements[right_pair_index] = 0
 
-                # Set the right to zero
-                self.registers[register_a][right_pair_byte_offset:right_pair_byte_offset + sew] = [0] * sew
+        register[:len(elements) * sew] = b"".join(element.to_bytes(sew, 'big') for element in elements)
 
         # At this point register[0] begins the max sew element
 
@@ -610,3 +672,46 @@ class SimulatedBlimpBank(SimulatedBank):
             label=f"\t{register_a}[0] <- MAX {register_a}",
             return_labels=return_labels
         )
+
+    def blimpv_alu_int_sum(self, register_a, sew, return_labels=True) -> RuntimeResult:
+        """
+        Perform a BLIMP-V widening SUM reduction on register 'a' on SEW bytes; the sum of every element is stored in
+        the first blimpv_sew_max_bytes of register a (modulo that width) and the rest of the register is zeroed
+        """
+        # Sanity checking
+        if register_a not in self.registers:
+            raise RuntimeError(f"Register '{register_a}' does not exist")
+        elif self.configuration.hardware_configuration.blimpv_sew_min_bytes > sew:
+            raise RuntimeError("SEW too small for this configuration")
+        elif self.configuration.hardware_configuration.blimpv_sew_max_bytes < sew:
+            raise RuntimeError("SEW too large for this configuration")
+        elif self.configuration.hardware_configuration.row_buffer_size_bytes % sew != 0:
+            raise RuntimeError(f"SEW of {sew} does not divide evenly into the configured row buffer width")
+
+        # Calculate the number of cycles this operation takes
+        cycles = 1  # Start with one cycle to dispatch to the vector engine
+
+        # The same pairwise tree as MAX, each round adding neighbouring partial sums at the widest SEW
+        elements = self.configuration.hardware_configuration.row_buffer_size_bytes // sew
+        reduction_rounds = math.floor(math.log2(elements))
+        for reduction_round in range(reduction_rounds):
+            element_pairs = elements // (2**(reduction_round + 1))
+            # Calculate how many SEW ALU rounds are needed
+            alu_rounds = int(math.ceil(element_pairs / self.configuration.hardware_configuration.number_of_vALUs))
+            # Assumption; each ALU takes less than a CPU cycle to execute
+            cycles += alu_rounds
+
+        # Perform the operation
+        register = self.registers[register_a]
+        total = sum(row_to_int(register[e * sew:e * sew + sew]) for e in range(2 ** reduction_rounds))
+        sum_bytes = self.configuration.hardware_configuration.blimpv_sew_max_bytes
+        self.registers[register_a] = \
+            int_to_row(total & ((1 << (8 * sum_bytes)) - 1), sum_bytes) + \
+            bytearray(self.configuration.hardware_configuration.row_buffer_size_bytes - sum_bytes)
+
+        # Return the runtime result
+        return self.blimp_cycle(
+            cycles=cycles,
+            label=f"\t{register_a}[0] <- SUM {register_a}",
+            return_labels=return_labels
+        )
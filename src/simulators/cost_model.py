@@ -0,0 +1,288 @@
+"""
+Closed-form cost model for the equality queries
+
+The runtime of an equality query does not depend on the records in the bank, only on the layout and the hardware
+timings; the early terminating (ET) variants additionally depend on how many bits are evaluated before a hitmap row
+runs out of hits. Instead of running a query functionally, the model counts the hardware operations the query class
+would charge (the same categories as RuntimeResult.counters) in closed form from the layout's address mapping, and
+prices them with the hardware timings. A query is modeled in constant time, regardless of the bank size.
+
+Every cost function mirrors the loop structure of its query class in src/queries; a change to the cycles a query
+charges must be reflected here.
+"""
+import math
+import typing
+from collections import Counter
+
+from src.configurations.bank_layout import BlimpBankLayoutConfiguration
+from src.simulators.dram_timing import RowBufferTiming
+from src.simulators.result import RuntimeResult
+
+from src.queries.ambit_equality import AmbitEqual, AmbitNotEqual
+from src.queries.ambit_et_equality import AmbitETEqual, AmbitETNotEqual
+from src.queries.blimp_equality import BlimpEqual, BlimpNotEqual
+from src.queries.blimpv_equality import BlimpVEqual, BlimpVNotEqual
+from src.queries.blimpv_et_equality import BlimpVETEqual, BlimpVETNotEqual
+
+
+def _repeat(counts: Counter, times: int) -> Counter:
+    """Scale a set of operation counts, as if the operations were performed `times` times"""
+    return Counter({category: count * times for category, count in counts.items()})
+
+
+class QueryCostModel:
+    """
+    Models the runtime of the equality queries on a layout configuration without simulating them
+
+    @param configuration: The bank layout to model; Ambit queries require an AmbitBankLayoutConfiguration, and the
+                          hardware must be a closed page bank of one subarray, under which every row access costs
+                          the same
+    """
+    def __init__(self, configuration: BlimpBankLayoutConfiguration):
+        self.configuration = configuration
+        hardware = configuration.hardware_configuration
+        if hardware.row_buffer_policy != RowBufferTiming.CLOSED_PAGE:
+            raise ValueError("the cost model only models the closed page policy, simulate open page hardware instead")
+        if hardware.subarrays_per_bank != 1:
+            raise ValueError("the cost model does not model overlapping subarrays, simulate the hardware instead")
+        self._timings = {
+            RuntimeResult.ROW_ACTIVATE: hardware.time_to_row_activate_ns,
+            RuntimeResult.PRECHARGE: hardware.time_to_precharge_ns,
+            RuntimeResult.V0_TRANSFER: hardware.time_to_v0_transfer_ns,
+            RuntimeResult.BLIMP_CYCLE: hardware.time_per_blimp_cycle_ns,
+            RuntimeResult.TRA: getattr(hardware, "time_for_TRA_MAJ_ns", None),
+            RuntimeResult.AAP: getattr(hardware, "time_for_AAP_rowclone_ns", None),
+        }
+
+        self._query_map = {
+            # query class: (cost function, negate, early terminating)
+            BlimpEqual: (self.blimp_equality, False, False),
+            BlimpNotEqual: (self.blimp_equality, True, False),
+            BlimpVEqual: (self.blimpv_equality, False, False),
+            BlimpVNotEqual: (self.blimpv_equality, True, False),
+            BlimpVETEqual: (self.blimpv_et_equality, False, True),
+            BlimpVETNotEqual: (self.blimpv_et_equality, True, True),
+            AmbitEqual: (self.ambit_equality, False, False),
+            AmbitNotEqual: (self.ambit_equality, True, False),
+            AmbitETEqual: (self.ambit_et_equality, False, True),
+            AmbitETNotEqual: (self.ambit_et_equality, True, True),
+        }
+
+    def estimate(self, query_class, pi_element_size_bytes: int, early_termination_bit: int=None) -> RuntimeResult:
+        """
+        Model the runtime of a query class as RuntimeResult counters, the equivalent of running its
+        perform_operation without labels
+
+        @param query_class: The query class to model, one of the equality queries in src/queries
+        @param pi_element_size_bytes: The PI/Key field size in bytes
+        @param early_termination_bit: For ET queries, the number of bits evaluated in every hitmap row before it has
+            no hits left and the row terminates early; None models no early termination (the worst case)
+        """
+        if query_class not in self._query_map:
+            raise ValueError(f"no cost model for query {query_class.__name__}")
+        cost_function, negate, early_terminating = self._query_map[query_class]
+        if early_terminating:
+            counts = cost_function(pi_element_size_bytes, negate, early_termination_bit)
+        else:
+            counts = cost_function(pi_element_size_bytes, negate)
+        return self.runtime_result(counts)
+
+    def runtime_result(self, counts: Counter) -> RuntimeResult:
+        """Price a set of operation counts with the hardware timings"""
+        result = RuntimeResult()
+        for category, count in counts.items():
+            if count == 0:
+                continue
+            if self._timings[category] is None:
+                raise RuntimeError(f"the hardware configuration has no timing for {category} operations")
+            result.step(count * self._timings[category], categories=(category,), count=count)
+        return result
+
+    @property
+    def rows_per_hitmap(self) -> int:
+        """How many rows are represented by one hitmap"""
+        return self.configuration.total_rows_for_hitmaps // self.configuration.database_configuration.hitmap_count
+
+    # Operations, as charged by SimulatedBlimpBank and SimulatedAmbitBank
+
+    @staticmethod
+    def _cycles(cycles: int) -> Counter:
+        return Counter({RuntimeResult.BLIMP_CYCLE: cycles})
+
+    def _begin(self) -> Counter:
+        return Counter({RuntimeResult.ROW_ACTIVATE: 1}) + self._cycles(5)
+
+    @staticmethod
+    def _end() -> Counter:
+        return Counter({RuntimeResult.ROW_ACTIVATE: 1})
+
+    @staticmethod
+    def _register_transfer() -> Counter:
+        """blimp_load_register or blimp_save_register of any register other than v0"""
+        return Counter({
+            RuntimeResult.BLIMP_CYCLE: 1,
+            RuntimeResult.ROW_ACTIVATE: 1,
+            RuntimeResult.PRECHARGE: 1,
+            RuntimeResult.V0_TRANSFER: 1,
+        })
+
+    def _blimpv_alu(self, sew: int) -> Counter:
+        """A BLIMP-V unary or binary integer operation"""
+        hardware = self.configuration.hardware_configuration
+        sew_chunks = hardware.row_buffer_size_bytes // sew
+        return self._cycles(1 + int(math.ceil(sew_chunks / hardware.number_of_vALUs)))
+
+    def _blimpv_max(self, sew: int) -> Counter:
+        """A BLIMP-V MAX reduction"""
+        hardware = self.configuration.hardware_configuration
+        cycles = 1
+        for reduction_round in range(math.floor(math.log2(hardware.row_buffer_size_bytes // sew))):
+            element_pairs = hardware.row_buffer_size_bytes // sew // (2 ** (reduction_round + 1))
+            cycles += int(math.ceil(element_pairs / hardware.number_of_vALUs))
+        return self._cycles(cycles)
+
+    def _ambit_copy(self) -> Counter:
+        return self._cycles(1) + Counter({RuntimeResult.AAP: 1})
+
+    def _ambit_tra(self) -> Counter:
+        return self._cycles(1) + Counter({RuntimeResult.TRA: 1})
+
+    def _ambit_logic(self) -> Counter:
+        """ambit_and or ambit_or; a control row copy followed by a TRA"""
+        return self._ambit_copy() + self._ambit_tra()
+
+    # Queries
+
+    def blimp_equality(self, pi_element_size_bytes: int, negate: bool) -> Counter:
+        """Operation counts of BlimpEqual/BlimpNotEqual"""
+        hardware = self.configuration.hardware_configuration
+        database = self.configuration.database_configuration
+        row_buffer_bytes = hardware.row_buffer_size_bytes
+        records = self.configuration.total_records_processable
+        record_base, _ = self.configuration.pi_location(0)
+
+        # The rows the scan loads; one per record for multi-row records, otherwise one per row of records, or of
+        # column packed PI/Keys. The query starts out assuming row 0 is loaded, so a scan starting at row 0 skips its
+        # first load
+        rows_per_record = database.total_record_size_bytes // row_buffer_bytes
+        if self.configuration.packed_pi_fields:
+            row_loads = int(math.ceil(records / (row_buffer_bytes // database.total_index_size_bytes)))
+        elif rows_per_record > 0:
+            row_loads = records
+        else:
+            row_loads = int(math.ceil(records / (row_buffer_bytes // database.total_record_size_bytes)))
+        if record_base == 0 and records > 0:
+            row_loads -= 1
+
+        full_bytes = records // 8
+        counts = self._begin() + self._cycles(5 + 1)
+
+        # Per record: row, offset and suboffset calculations, the row check, the memcmp and bookkeeping
+        counts += self._cycles(records * (3 + 3 + 2 + 3 + pi_element_size_bytes * 2 + 4))
+        counts += _repeat(self._register_transfer(), row_loads)
+
+        # Every filled hitmap byte, and every filled hitmap row saved during the scan
+        counts += self._cycles(full_bytes * 4)
+        counts += _repeat(self._register_transfer(), full_bytes // row_buffer_bytes)
+
+        # Pad out the last hitmap row one bit at a time, then save it
+        counts += self._cycles(1)
+        if full_bytes % row_buffer_bytes != 0:
+            padding_bytes = row_buffer_bytes - full_bytes % row_buffer_bytes
+            counts += self._cycles((padding_bytes * 8 - records % 8) * 3 + padding_bytes * 4)
+        counts += self._register_transfer()
+
+        return counts + self._end()
+
+    def _blimpv_bit(self, pi_element_size_bytes: int) -> Counter:
+        """One bit of a BLIMP-V equality, up to the inner loop return"""
+        return self._cycles(5 + 10) + self._register_transfer() + \
+            self._cycles(3) + self._register_transfer() + \
+            self._blimpv_alu(pi_element_size_bytes) + \
+            self._register_transfer() + \
+            self._blimpv_alu(pi_element_size_bytes) + \
+            self._register_transfer()
+
+    def _blimpv_negate(self, pi_element_size_bytes: int, negate: bool) -> Counter:
+        counts = self._cycles(3)
+        if negate:
+            counts += self._blimpv_alu(pi_element_size_bytes) + self._register_transfer()
+        return counts + self._cycles(2)
+
+    def blimpv_equality(self, pi_element_size_bytes: int, negate: bool) -> Counter:
+        """Operation counts of BlimpVEqual/BlimpVNotEqual"""
+        bits = pi_element_size_bytes * 8
+        row = self._cycles(3 + 1) + \
+            _repeat(self._blimpv_bit(pi_element_size_bytes) + self._cycles(2), bits) + \
+            self._blimpv_negate(pi_element_size_bytes, negate)
+        return self._begin() + self._cycles(1) + _repeat(row, self.rows_per_hitmap) + self._end()
+
+    def blimpv_et_equality(self, pi_element_size_bytes: int, negate: bool,
+                           early_termination_bit: int=None) -> Counter:
+        """Operation counts of BlimpVETEqual/BlimpVETNotEqual"""
+        sew = self.configuration.hardware_configuration.blimpv_sew_max_bytes
+        bit = self._blimpv_bit(pi_element_size_bytes) + self._blimpv_max(sew) + self._cycles(1)
+        row = self._cycles(3 + 1) + \
+            self._early_terminated_bits(bit, pi_element_size_bytes * 8, early_termination_bit) + \
+            self._blimpv_negate(pi_element_size_bytes, negate)
+        return self._begin() + self._cycles(1) + _repeat(row, self.rows_per_hitmap) + self._end()
+
+    def _ambit_bit(self) -> Counter:
+        """One bit of an Ambit equality, up to the inner loop return"""
+        # Bit and row calculation, AND with the value bit, NOR with the value bit, OR the two together
+        counts = self._cycles(5 + 10)
+        counts += self._ambit_copy() + self._cycles(3) + self._ambit_copy() + self._ambit_logic()
+        counts += self._ambit_copy() + self._cycles(3) + self._ambit_copy() + self._ambit_logic()
+        counts += self._ambit_logic()
+        # AND the result into the hitmap row
+        return counts + self._ambit_copy() + self._ambit_logic() + self._ambit_copy()
+
+    def _ambit_negate(self, negate: bool) -> Counter:
+        counts = self._cycles(3)
+        if negate:
+            counts += _repeat(self._ambit_copy(), 2)
+        return counts + self._cycles(2)
+
+    def ambit_equality(self, pi_element_size_bytes: int, negate: bool) -> Counter:
+        """Operation counts of AmbitEqual/AmbitNotEqual"""
+        row = self._cycles(3 + 1) + \
+            _repeat(self._ambit_bit() + self._cycles(2), pi_element_size_bytes * 8) + \
+            self._ambit_negate(negate)
+        return self._begin() + self._cycles(1) + _repeat(row, self.rows_per_hitmap) + self._end()
+
+    def ambit_et_equality(self, pi_element_size_bytes: int, negate: bool, early_termination_bit: int=None) -> Counter:
+        """Operation counts of AmbitETEqual/AmbitETNotEqual"""
+        hardware = self.configuration.hardware_configuration
+        bit_chunks = hardware.row_buffer_size_bytes // (hardware.processor_bit_architecture // 8)
+        # Load the hitmap row back and find its maximum processor word
+        bit = self._ambit_bit() + self._register_transfer() + self._cycles(3 + bit_chunks * 4) + self._cycles(1)
+        row = self._cycles(3 + 1) + \
+            self._early_terminated_bits(bit, pi_element_size_bytes * 8, early_termination_bit) + \
+            self._ambit_negate(negate)
+        return self._begin() + self._cycles(1) + _repeat(row, self.rows_per_hitmap) + self._end()
+
+    def _early_terminated_bits(self, bit: Counter, bits: int, early_termination_bit: int=None) -> Counter:
+        """The inner loop of an ET query; `bit` is one bit up to the termination check"""
+        if early_termination_bit is None:
+            return _repeat(bit + self._cycles(2), bits)
+        if not 1 <= early_termination_bit <= bits:
+            raise ValueError(f"early_termination_bit must be between 1 and {bits}")
+        # Every bit but the last takes the inner loop return, the last takes the ET return
+        return _repeat(bit + self._cycles(2), early_termination_bit - 1) + bit + self._cycles(1)
+
+
+def sweep(configurations: typing.Iterable[BlimpBankLayoutConfiguration], query_classes: list,
+          pi_element_size_bytes: int=None, early_termination_bit: int=None):
+    """
+    Model a set of queries over many layouts, yielding (configuration, query class, RuntimeResult) per point
+
+    @param configurations: The layouts to model
+    @param query_classes: The queries to model on every layout
+    @param pi_element_size_bytes: The PI/Key field size in bytes; defaults to each layout's total index size
+    @param early_termination_bit: The early termination point of ET queries, see QueryCostModel.estimate
+    """
+    for configuration in configurations:
+        model = QueryCostModel(configuration)
+        element_size = pi_element_size_bytes or configuration.database_configuration.total_index_size_bytes
+        for query_class in query_classes:
+            yield configuration, query_class, model.estimate(query_class, element_size, early_termination_bit)
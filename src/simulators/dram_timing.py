@@ -0,0 +1,121 @@
+import math
+
+from src.configurations.hardware import HardwareConfiguration
+from src.simulators.result import RuntimeResult
+
+
+class RowBufferTiming:
+    """
+    Defines the row buffer state of a bank and what accessing a row costs under the bank's row buffer policy
+
+    A bank is split into subarrays of consecutive rows, each with its own row buffer (one row open per subarray at a
+    time), so accesses to different subarrays do not close each other's rows. Rows are charged with the hardware
+    timings:
+        tRCD: time_to_row_activate_ns, opening a row into its subarray's row buffer
+        tRP: time_to_precharge_ns, closing the open row of a subarray
+        tCCD: time_to_column_activate_ns, a column access to a row that is already open
+
+    Under the closed page policy (the default) every access activates its row and precharges it again. Under the
+    open page policy rows stay open after an access; an access to the open row of its subarray (a hit) only costs a
+    column access, any other access precharges the open row of the subarray if there is one and activates its own.
+
+    Every subarray keeps its own timeline, the time it is ready for its next activation. The row commands of the
+    BLIMP program issue one after another, each after the previous one's data is in its row buffer, and start once
+    their subarray is ready; so a precharge left behind in one subarray (after a closed page access, or closing
+    several subarrays at once) overlaps the activations in others. Every call is charged how far it moves the
+    time every subarray is ready again, so a bank of one subarray is charged each operation in full. Only row
+    commands are on these timelines, the BLIMP cycles between them are not overlapped.
+
+    @param hardware_configuration: The hardware the bank is built from
+    """
+    CLOSED_PAGE = "closed"
+    OPEN_PAGE = "open"
+
+    def __init__(self, hardware_configuration: HardwareConfiguration):
+        if hardware_configuration.row_buffer_policy not in (self.CLOSED_PAGE, self.OPEN_PAGE):
+            raise ValueError(f"unknown row buffer policy '{hardware_configuration.row_buffer_policy}', "
+                             f"expected '{self.CLOSED_PAGE}' or '{self.OPEN_PAGE}'")
+        if hardware_configuration.subarrays_per_bank < 1:
+            raise ValueError("a bank has at least one subarray")
+
+        self.open_page = hardware_configuration.row_buffer_policy == self.OPEN_PAGE
+        self.rows_per_subarray = int(math.ceil(hardware_configuration.bank_rows /
+                                               hardware_configuration.subarrays_per_bank))
+        self._activate_ns = hardware_configuration.time_to_row_activate_ns
+        self._precharge_ns = hardware_configuration.time_to_precharge_ns
+        self._column_access_ns = hardware_configuration.time_to_column_activate_ns
+        self._open_rows = [None] * hardware_configuration.subarrays_per_bank
+        self.reset()
+
+    def subarray(self, row: int) -> int:
+        """The subarray a row belongs to"""
+        return row // self.rows_per_subarray
+
+    @property
+    def open_rows(self) -> list:
+        """The open row of every subarray, None for a precharged subarray"""
+        return list(self._open_rows)
+
+    def reset(self):
+        """Forget every open row, as if the bank was precharged without charging it"""
+        self._open_rows = [None] * len(self._open_rows)
+        self._ready_ns = [0.0] * len(self._open_rows)
+        self._issue_ns = 0.0
+        self._horizon_ns = 0.0
+
+    def _occupy(self, subarray: int, start_ns: float, busy_ns: float) -> float:
+        """Keep a subarray busy for busy_ns from start_ns, return how far that moves the time every subarray is ready"""
+        charged_ns = max(0.0, (start_ns - self._horizon_ns) + busy_ns)
+        self._ready_ns[subarray] = start_ns + busy_ns
+        self._horizon_ns += charged_ns
+        return charged_ns
+
+    def access(self, row: int, label: str="") -> RuntimeResult:
+        """Charge an access of a row through its subarray's row buffer"""
+        subarray = self.subarray(row)
+        start_ns = max(self._ready_ns[subarray], self._issue_ns)
+        if not self.open_page:
+            # The precharge closing the row runs on in its subarray while the next command issues
+            self._issue_ns = start_ns + self._activate_ns
+            return RuntimeResult(
+                self._occupy(subarray, start_ns, self._activate_ns + self._precharge_ns),
+                label,
+                (RuntimeResult.ROW_ACTIVATE, RuntimeResult.PRECHARGE)
+            )
+
+        open_row = self._open_rows[subarray]
+        self._open_rows[subarray] = row
+        if open_row == row:
+            busy_ns, categories = self._column_access_ns, (RuntimeResult.COLUMN_ACCESS,)
+        elif open_row is None:
+            busy_ns, categories = self._activate_ns, (RuntimeResult.ROW_ACTIVATE,)
+        else:
+            busy_ns, categories = self._precharge_ns + self._activate_ns, \
+                (RuntimeResult.PRECHARGE, RuntimeResult.ROW_ACTIVATE)
+        self._issue_ns = start_ns + busy_ns
+        return RuntimeResult(self._occupy(subarray, start_ns, busy_ns), label, categories)
+
+    def _close(self, subarrays, label: str) -> RuntimeResult:
+        """Precharge the open rows of the given subarrays together, the next command waits until all are closed"""
+        result = RuntimeResult(0, label)
+        issue_ns = self._issue_ns
+        for subarray in subarrays:
+            if self._open_rows[subarray] is not None:
+                self._open_rows[subarray] = None
+                start_ns = max(self._ready_ns[subarray], issue_ns)
+                result.step(self._occupy(subarray, start_ns, self._precharge_ns), categories=(RuntimeResult.PRECHARGE,))
+                self._issue_ns = max(self._issue_ns, self._ready_ns[subarray])
+        return result
+
+    def precharge(self, *rows: int, label: str="") -> RuntimeResult:
+        """
+        Close the subarrays of the given rows ahead of an operation that activates and precharges them itself, such
+        as an Ambit AAP or TRA; an open row is charged its precharge
+        """
+        if not self.open_page:
+            return RuntimeResult(0, label)
+        return self._close([self.subarray(row) for row in rows], label)
+
+    def precharge_all(self, label: str="") -> RuntimeResult:
+        """Close every open row of the bank, charging their precharge"""
+        return self._close(range(len(self._open_rows)), label)
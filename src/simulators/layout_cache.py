@@ -0,0 +1,129 @@
+import hashlib
+import json
+import logging
+import os
+import tempfile
+
+from src.configurations.bank_layout import BlimpBankLayoutConfiguration
+from src.utils import performance
+
+
+class LayoutCache:
+    """
+    A content-addressed directory of laid-out bank images and their record sets
+
+    Entries are named by a hash of everything that decides what a layout places where: the layout configuration and
+    simulator classes, the hardware fields that shape the bank, every database field, the layout keyword arguments,
+    and a key naming the record set (its generator, seed, constants...). Configurations that only differ in compute
+    or timing parameters, such as vALU counts, frequencies or row timings, share one entry, and every bank of such
+    a configuration maps the one image copy-on-write instead of generating and laying out its own.
+
+    @param directory: The directory holding the entries, created if missing
+    """
+    # The hardware fields that decide the geometry and row placement of a layout; every other hardware field only
+    # decides how fast queries run on it
+    PLACEMENT_HARDWARE_FIELDS = [
+        "bank_size_bytes",
+        "row_buffer_size_bytes",
+        "ambit_temporary_register_rows",
+        "ambit_dcc_rows",
+    ]
+
+    def __init__(self, directory: str):
+        self.directory = directory
+        self._logger = logging.getLogger(self.__class__.__name__)
+        os.makedirs(directory, exist_ok=True)
+
+    def key(self, configuration: BlimpBankLayoutConfiguration, records_key: str, simulator_class,
+            **layout_kwargs) -> str:
+        """The entry name of a layout of the record set named by records_key"""
+        return hashlib.sha256(
+            json.dumps(self.describe(configuration, records_key, simulator_class, **layout_kwargs),
+                       sort_keys=True).encode("utf-8")
+        ).hexdigest()[:32]
+
+    def describe(self, configuration: BlimpBankLayoutConfiguration, records_key: str, simulator_class,
+                 **layout_kwargs) -> dict:
+        """Everything hashed into an entry name, also saved next to the entry"""
+        hardware = configuration.hardware_configuration.dict()
+        return {
+            "layout": type(configuration).__name__,
+            "simulator": simulator_class.__name__,
+            "hardware": {field: hardware[field] for field in self.PLACEMENT_HARDWARE_FIELDS if field in hardware},
+            "database": configuration.database_configuration.dict(),
+            "layout_kwargs": layout_kwargs,
+            "records": records_key,
+        }
+
+    def image_path(self, key: str) -> str:
+        """The bank image of an entry"""
+        return os.path.join(self.directory, f"{key}.memdump")
+
+    def records_path(self, key: str) -> str:
+        """The saved record set of an entry"""
+        return os.path.join(self.directory, f"{key}.db")
+
+    def contains(self, key: str) -> bool:
+        return os.path.exists(self.image_path(key))
+
+    def prepare(self, configuration: BlimpBankLayoutConfiguration, records, records_key: str, simulator_class,
+                bank_class, regenerate: bool=False, save_records: bool=True, **layout_kwargs) -> str:
+        """
+        Lay a record set out into the cache unless it is already there, return the entry name
+
+        @param configuration: The layout configuration
+        @param records: A callable returning the record generator to lay out, only called on a cache miss
+        @param records_key: A name for the record set the callable generates; the same name must always generate
+                            the same records
+        @param simulator_class: The bank simulator doing the layout, e.g. SimulatedAmbitBank
+        @param bank_class: The bank hardware, e.g. AmbitBank
+        @param regenerate: Lay the record set out even if it is cached
+        @param save_records: Also save the record set into the entry
+        @kwarg layout_kwargs: Passed on to the simulator's layout
+        """
+        key = self.key(configuration, records_key, simulator_class, **layout_kwargs)
+        if self.contains(key) and not regenerate:
+            self._logger.info(f"layout cache hit {key}")
+            return key
+
+        self._logger.info(f"layout cache miss {key}, laying out")
+        performance.start_performance_tracking()
+        record_set = records()
+        bank = bank_class(configuration.hardware_configuration)
+        simulator_class(configuration, bank).layout(record_set, **layout_kwargs)
+
+        # Entries are written under temporary names and renamed into place, so concurrent writers of one entry
+        # (equal configurations across processes) each leave a whole image behind and readers never see a partial one
+        if save_records:
+            self._publish(key, ".db", record_set.save)
+        self._publish(key, ".json", lambda path: self._save_description(
+            path, self.describe(configuration, records_key, simulator_class, **layout_kwargs)
+        ))
+        self._publish(key, ".memdump", bank.save)
+        self._logger.info(f"layout cached in {performance.end_performance_tracking()}s")
+        return key
+
+    def bank(self, key: str, hardware_configuration, bank_class):
+        """Map an entry's bank image copy-on-write as a bank of the given hardware configuration"""
+        return bank_class.map(self.image_path(key), hardware_configuration)
+
+    def simulator(self, configuration: BlimpBankLayoutConfiguration, records, records_key: str, simulator_class,
+                  bank_class, **layout_kwargs):
+        """Return a simulator of the configuration over a cached layout of the record set, see :func:prepare"""
+        key = self.prepare(configuration, records, records_key, simulator_class, bank_class, **layout_kwargs)
+        return simulator_class(configuration, self.bank(key, configuration.hardware_configuration, bank_class))
+
+    def _publish(self, key: str, suffix: str, save):
+        descriptor, temporary = tempfile.mkstemp(prefix=f".{key}", suffix=suffix, dir=self.directory)
+        os.close(descriptor)
+        try:
+            save(temporary)
+            os.replace(temporary, os.path.join(self.directory, f"{key}{suffix}"))
+        except BaseException:
+            os.remove(temporary)
+            raise
+
+    @staticmethod
+    def _save_description(path: str, description: dict):
+        with open(path, "w") as fp:
+            json.dump(description, fp, indent=4)
@@ -0,0 +1,183 @@
+import logging
+
+from src.configurations.bank_layout import BlimpBankLayoutConfiguration
+from src.generators.records import DatabaseRecordGenerator
+from src.hardware.bank import AmbitBank
+from src.simulators.ambit import SimulatedAmbitBank
+from src.simulators.result import MultiBankResult, SimulationResult, BitmapResult, AggregateResult
+from src.utils import performance
+from src.utils.roaring import RoaringBitmap
+from src.utils.scheduler import WorkStealingPool
+
+
+class ShardedRecordGenerator(DatabaseRecordGenerator):
+    """
+    A contiguous window of another record generator, so each bank of a multi-bank system sees its own records
+    starting at index zero
+
+    @param record_generator: The record generator being sharded
+    @param first_record: The index in record_generator of this shard's record zero
+    @param total_records: The number of records in this shard
+    @param padded_records: Records past total_records, up to this many, are null records; used to fill the tail of
+                            the last, partially filled bank
+    """
+    def __init__(self, record_generator: DatabaseRecordGenerator, first_record: int, total_records: int,
+                 padded_records: int=None):
+        super().__init__(record_generator._pi_generator, record_generator._data_generator)
+        self._parent = record_generator
+        self._first_record = first_record
+        self._total_records = total_records
+        self._padded_records = max(total_records, padded_records or 0)
+
+    def get_record(self, index) -> tuple:
+        """Fetch a record from the shard given an index"""
+        if index >= self._padded_records:
+            raise IndexError(f"Attempted to fetch record {index} outside of shard limit {self._padded_records}")
+        if index >= self._total_records:
+            return self.get_null_record()
+        return self._parent.get_record(self._first_record + index)
+
+    def get_records(self) -> tuple:
+        """Generate the stream of records in this shard"""
+        for index in range(self._total_records):
+            yield self.get_record(index)
+
+
+class SimulatedMultiBank:
+    """
+    Defines a multi-bank system of identically configured banks running the same query at once. The record set is
+    sharded in order across banks, each holding up to total_records_processable records, and per-bank layout and
+    queries are run on a work-stealing pool.
+
+    @param layout_configuration: The layout configuration of every bank
+    @param bank_count: The number of banks in the system
+    @param bank_class: The bank hardware to simulate
+    @param simulator_class: The bank simulator to use for each bank
+    @param workers: The number of worker threads, defaults to the number of processors
+    """
+    def __init__(
+            self,
+            layout_configuration: BlimpBankLayoutConfiguration,
+            bank_count: int,
+            bank_class=AmbitBank,
+            simulator_class=SimulatedAmbitBank,
+            workers: int=None,
+            logger=None
+            ):
+        if bank_count < 1:
+            raise ValueError("a multi-bank system needs at least one bank")
+        self._logger = logger or logging.getLogger(self.__class__.__name__)
+        self.configuration = layout_configuration
+        self.pool = WorkStealingPool(workers)
+        self.banks = [
+            simulator_class(layout_configuration, bank_class(layout_configuration.hardware_configuration))
+            for _ in range(bank_count)
+        ]
+        self.records_per_bank = [0] * bank_count
+        self._logger.info(f"multi-bank simulator loaded with {bank_count} banks and {self.pool.workers} workers")
+
+    @property
+    def bank_count(self) -> int:
+        return len(self.banks)
+
+    def layout(self, record_set: DatabaseRecordGenerator, total_records: int=None, **kwargs):
+        """
+        Shard a record set across all banks and lay each bank out, see the bank simulator's layout for kwargs
+
+        @param record_set: The record generator to use for filling the banks
+        @param total_records: How many records to shard; defaults to filling every bank
+        """
+        self._logger.info(f"beginning multi-bank layout procedure")
+        performance.start_performance_tracking()
+
+        capacity = self.configuration.total_records_processable
+        total_records = capacity * self.bank_count if total_records is None else total_records
+        if total_records > capacity * self.bank_count:
+            raise ValueError(f"{total_records} records do not fit in {self.bank_count} banks of {capacity} records")
+
+        # Generate every record up front on this thread, so generation order (and any seeded randomness) does not
+        # depend on worker scheduling
+        if total_records > 0:
+            record_set.get_record(total_records - 1)
+
+        shards = []
+        for bank in range(self.bank_count):
+            first_record = min(bank * capacity, total_records)
+            self.records_per_bank[bank] = min(capacity, total_records - first_record)
+            shards.append(ShardedRecordGenerator(record_set, first_record, self.records_per_bank[bank], capacity))
+
+        def layout_bank(bank: int):
+            self.banks[bank].layout(shards[bank], **kwargs)
+
+        self.pool.map(layout_bank, range(self.bank_count))
+        self._logger.info(f"multi-bank layout completed in {performance.end_performance_tracking()}s")
+
+    def perform_operation(self, query_class, **kwargs) -> MultiBankResult:
+        """
+        Run a query on every bank, see the query's perform_operation for kwargs
+
+        @param query_class: The query to perform, e.g. BlimpEqual
+        """
+        self._logger.info(f"performing {query_class.__name__} on {self.bank_count} banks")
+        performance.start_performance_tracking()
+
+        def query_bank(bank: int):
+            return query_class(self.banks[bank]).perform_operation(**kwargs)
+
+        # Banks that are not full hold null padding records past their last record; their hitmap bits are cleared
+        # before the query, so queries reading a hitmap (COUNT, SUM, MIN, MAX...) never count padding hits, and after
+        # it along with the hits the query reported for them
+        self._clear_padding_hits()
+        results = self.pool.map(query_bank, range(self.bank_count))
+        self._clear_padding_hits()
+        simulation_results = [
+            self._drop_padding_hits(simulation_result, records)
+            for (_, simulation_result), records in zip(results, self.records_per_bank)
+        ]
+
+        result = MultiBankResult([runtime for runtime, _ in results], simulation_results, self.records_per_bank)
+        self._logger.info(f"multi-bank query completed in {performance.end_performance_tracking()}s")
+        return result
+
+    def reset_all_hitmaps(self, value: bool=True):
+        """Reset/Initialize all hitmaps of every bank"""
+        self.pool.map(lambda bank: self.banks[bank].reset_all_hitmaps(value), range(self.bank_count))
+        self._clear_padding_hits()
+
+    def _clear_padding_hits(self):
+        """Clear the hitmap bits of the padding records of every bank that is not full, in every hitmap"""
+        capacity = self.configuration.total_records_processable
+        row_bits = self.configuration.hardware_configuration.row_buffer_size_bytes * 8
+        base_hitmap_row, hitmap_row_count = self.configuration.address_mapping["hitmaps"]
+        hitmap_count = self.configuration.database_configuration.hitmap_count
+        rows_per_hitmap = hitmap_row_count // hitmap_count
+        for bank, records in zip(self.banks, self.records_per_bank):
+            if records >= capacity:
+                continue
+            for hitmap_index in range(hitmap_count):
+                for hitmap_row in range(records // row_bits, (capacity + row_bits - 1) // row_bits):
+                    # Keep the bits of the records in this row, clear those of the padding records up to capacity
+                    first_bit, end_bit = hitmap_row * row_bits, (hitmap_row + 1) * row_bits
+                    row_index = base_hitmap_row + rows_per_hitmap * hitmap_index + hitmap_row
+                    row = bank.bank_hardware.get_raw_row(row_index)
+                    kept = max(0, records - first_bit)
+                    padding = min(capacity, end_bit) - first_bit - kept
+                    mask = ((1 << padding) - 1) << (row_bits - kept - padding)
+                    if row & mask:
+                        bank.bank_hardware.set_raw_row(row_index, row & ~mask)
+
+    @staticmethod
+    def _drop_padding_hits(simulation_result: SimulationResult, records: int) -> SimulationResult:
+        """A bank's result without the hits of its padding records, past its first `records` records"""
+        if isinstance(simulation_result, AggregateResult) or simulation_result.result_record_indexes is None:
+            # Reduced or counted over a hitmap whose padding bits were cleared before the query
+            return simulation_result
+        if isinstance(simulation_result, BitmapResult):
+            if simulation_result.result_count and max(simulation_result.bitmap) >= records:
+                return BitmapResult(RoaringBitmap.from_indexes(
+                    index for index in simulation_result.bitmap if index < records
+                ))
+            return simulation_result
+        if any(index >= records for index in simulation_result.result_record_indexes):
+            return SimulationResult([index for index in simulation_result.result_record_indexes if index < records])
+        return simulation_result
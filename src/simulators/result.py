@@ -1,69 +1,256 @@
 import typing
 
+from src.hardware import native
+from src.utils.roaring import RoaringBitmap
+
 
 class RuntimeResult:
-    """Defines a list of simulation steps, runtimes (in ns), and actions"""
-    def __init__(self, runtime: float=0, label: str=None):
-        self.history = list() if runtime == 0 and label is None else [(runtime, label)]
+    """
+    Defines a list of simulation steps, runtimes (in ns), and actions
+
+    Results always keep the total runtime and a count of the hardware operations they are made of, by category, in
+    constant space. The per-step history is only recorded when tracing; a result is traced when it is created with
+    a label (return_labels=True) or explicitly with trace, untraced results are pure counters.
+
+    @param runtime: The runtime of this step in ns
+    @param label: The trace label of this step, empty or None to not trace it
+    @param categories: The hardware operation categories this step counts towards
+    @param count: How many of each category this step performs
+    @param trace: Whether to record the history of this result; defaults to whether a label was given
+    """
+    ROW_ACTIVATE = "row_activate"
+    PRECHARGE = "precharge"
+    COLUMN_ACCESS = "column_access"
+    V0_TRANSFER = "v0_transfer"
+    BLIMP_CYCLE = "blimp_cycle"
+    TRA = "tra"
+    AAP = "aap"
+
+    def __init__(self, runtime: float=0, label: str=None, categories: tuple=(), count: int=1, trace: bool=None):
+        self.tracing = bool(label) if trace is None else trace
+        self.history = [(runtime, label)] if self.tracing else list()
         self.runtime = runtime
+        self.counters = {category: count for category in categories}
 
     def __add__(self, other):
         if isinstance(other, self.__class__):
             self.runtime += other.runtime
-            self.history += other.history
+            if other.history:
+                self.history += other.history
+            for category, count in other.counters.items():
+                self.counters[category] = self.counters.get(category, 0) + count
             del other
             return self
         raise NotImplemented()
 
-    def step(self, runtime: int, label: str=None):
+    def step(self, runtime: int, label: str=None, categories: tuple=(), count: int=1):
         """Perform a simulation step, similar to adding two results"""
-        self.history.append((runtime, label))
+        if self.tracing:
+            self.history.append((runtime, label))
         self.runtime += runtime
+        for category in categories:
+            self.counters[category] = self.counters.get(category, 0) + count
         return self
 
+    def count(self, category: str) -> int:
+        """How many operations of a category this result performed"""
+        return self.counters.get(category, 0)
+
     def save(self, path: str):
         """Save the runtime result"""
         with open(path, 'w') as fp:
             fp.write(f"runtime: {self.runtime}ns\n")
+            fp.write(f"counters: \n")
+            for category in sorted(self.counters):
+                fp.write(f"\t{category}\t{self.counters[category]}\n")
             fp.write(f"history: \n")
             for runtime, label in self.history:
                 fp.write(f"\t{runtime}\t{label or ''}\n")
 
 
+# The record offsets, most significant bit first, of the 1-bits of every byte value
+_BYTE_HITS = tuple(tuple(b for b in range(8) if (1 << (7 - b)) & value) for value in range(256))
+
+
 class SimulationResult:
-    """Defines the return of the query. Returns the indexes of query-hit records"""
-    def __init__(self, result_record_indexes: typing.List[int]=list):
+    """
+    Defines the return of the query. Returns the indexes of query-hit records
+
+    @param result_record_indexes: The sorted indexes of the hit records, None if only the hits were counted
+    @param result_count: The number of hits; defaults to the number of indexes
+    """
+    def __init__(self, result_record_indexes: typing.List[int]=list, result_count: int=None):
         self.result_record_indexes = result_record_indexes
-        self.result_count = len(self.result_record_indexes)
+        self.result_count = len(self.result_record_indexes) if result_count is None else result_count
 
     def save(self, path: str):
         """Save the simulation result"""
         with open(path, 'w') as fp:
             fp.write(f"hits: {self.result_count}\n")
-            fp.write(f"indices: {self.result_record_indexes}\n")
+            if self.result_record_indexes is not None:
+                fp.write(f"indices: {self.result_record_indexes}\n")
 
     @staticmethod
-    def from_hitmap_byte_array(hitmap_byte_array: list, num_bits: int):
-        """Given a byte array, fetch all indexes that have a 1-bit"""
-        bitmaps_processed = 0
-        bit_indexes = []
+    def from_hitmap_byte_array(hitmap_byte_array, num_bits: int, count_only: bool=False):
+        """
+        Given a byte array (a list of bytes or any bytes-like object), fetch all indexes that have a 1-bit within the
+        first num_bits bits. When only counting, no indexes are produced.
+        """
+        if isinstance(hitmap_byte_array, list):
+            hitmap_byte_array = bytearray(hitmap_byte_array)
+
+        decoded = native.decode_hitmap(hitmap_byte_array, num_bits, count_only)
+        if decoded is not None:
+            count, indexes = decoded
+            return SimulationResult(indexes, count)
+
+        # Decode the hitmap bytes that hold records, masking off the padding bits of a final partial byte
+        hitmap = bytes(memoryview(hitmap_byte_array).cast('B')[:(num_bits + 7) // 8])
+        num_bits = min(num_bits, len(hitmap) * 8)
+        if num_bits % 8:
+            hitmap = hitmap[:-1] + bytes([hitmap[-1] & (0xFF << (8 - num_bits % 8)) & 0xFF])
+
+        if count_only:
+            return SimulationResult(None, int.from_bytes(hitmap, 'big').bit_count())
 
-        # Iterate over all bytes
-        for byte in hitmap_byte_array:
-            # Have we exhausted all bitmaps in the hitmap?
-            if bitmaps_processed >= num_bits:
-                break
-
-            # Can this entire byte be processed?
-            if bitmaps_processed + 8 <= num_bits:
-                for b in range(8):
-                    if (1 << (7 - b)) & byte > 0:
-                        bit_indexes.append(bitmaps_processed)
-                    bitmaps_processed += 1
-            # Only a partial bit of the byte is processable
-            else:
-                for b in range(8 - (num_bits - bitmaps_processed)):
-                    if (1 << (7 - b)) & byte > 0:
-                        bit_indexes.append(bitmaps_processed)
-                    bitmaps_processed += 1
+        bit_indexes = []
+        for index, byte in enumerate(hitmap):
+            if byte:
+                base = index * 8
+                bit_indexes += [base + offset for offset in _BYTE_HITS[byte]]
         return SimulationResult(bit_indexes)
+
+    @staticmethod
+    def from_hitmap_rows(bank, first_row: int, rows: int, num_bits: int, count_only: bool=False):
+        """
+        Fetch all indexes that have a 1-bit within the first num_bits bits of a hitmap held in consecutive bank rows,
+        reading the rows in place
+        """
+        return SimulationResult.from_hitmap_byte_array(bank.get_rows_view(first_row, rows), num_bits, count_only)
+
+
+class BitmapResult(SimulationResult):
+    """
+    Defines the return of the query as a compressed (Roaring) bitmap of the query-hit records. Indexes are only
+    materialized when asked for; results held in different hitmaps combine with & (AND), | (OR) and - (ANDNOT)
+    without re-scanning the records.
+
+    @param bitmap: The hit records
+    """
+    def __init__(self, bitmap: RoaringBitmap):
+        self.bitmap = bitmap
+        self.result_count = len(bitmap)
+
+    @property
+    def result_record_indexes(self) -> typing.List[int]:
+        return self.bitmap.to_list()
+
+    def __and__(self, other):
+        return BitmapResult(self.bitmap & other.bitmap)
+
+    def __or__(self, other):
+        return BitmapResult(self.bitmap | other.bitmap)
+
+    def __sub__(self, other):
+        return BitmapResult(self.bitmap - other.bitmap)
+
+    def andnot(self, other):
+        """The hits of this result that are not hits of the other"""
+        return self - other
+
+    def save(self, path: str):
+        """Save the hit bitmap in the portable Roaring format"""
+        self.bitmap.save(path)
+
+    @staticmethod
+    def load(path: str):
+        """Load a result saved with save"""
+        return BitmapResult(RoaringBitmap.load(path))
+
+    @staticmethod
+    def from_hitmap_rows(bank, first_row: int, rows: int, num_bits: int):
+        """Compress the first num_bits bits of a hitmap held in consecutive bank rows, reading the rows in place"""
+        return BitmapResult(RoaringBitmap.from_hitmap(bank.get_rows_view(first_row, rows), num_bits))
+
+
+class AggregateResult(SimulationResult):
+    """
+    Defines the return of an aggregation query; the reduced value of a field over the records hit in a hitmap
+
+    @param value: The aggregate (COUNT, SUM, MIN or MAX), None for a MIN or MAX over no records
+    @param result_count: The number of records the aggregate was reduced over
+    """
+    def __init__(self, value: typing.Optional[int], result_count: int):
+        super().__init__(None, result_count)
+        self.value = value
+
+    def save(self, path: str):
+        """Save the aggregation result"""
+        with open(path, 'w') as fp:
+            fp.write(f"hits: {self.result_count}\n")
+            fp.write(f"value: {self.value}\n")
+
+
+class MultiBankResult:
+    """
+    Defines the return of a query run on every bank of a multi-bank system. Banks run the query concurrently, so
+    the query finishes with its slowest bank.
+
+    @param runtime_results: The runtime result of each bank, in bank order
+    @param simulation_results: The simulation result of each bank, in bank order
+    @param records_per_bank: The number of records held by each bank, in bank order
+    """
+    def __init__(self, runtime_results: typing.List[RuntimeResult], simulation_results: typing.List[SimulationResult],
+                 records_per_bank: typing.List[int]):
+        self.runtime_results = runtime_results
+        self.simulation_results = simulation_results
+        self.records_per_bank = records_per_bank
+
+        # Merge the hits, translating each bank's record indexes back into the sharded record set
+        if any(result.result_record_indexes is None for result in simulation_results):
+            self.simulation_result = SimulationResult(None, sum(result.result_count for result in simulation_results))
+        else:
+            merged_indexes = []
+            bank_base = 0
+            for result, records in zip(simulation_results, records_per_bank):
+                merged_indexes += [bank_base + index for index in result.result_record_indexes]
+                bank_base += records
+            self.simulation_result = SimulationResult(merged_indexes)
+
+    @property
+    def bank_count(self) -> int:
+        return len(self.runtime_results)
+
+    @property
+    def total_records(self) -> int:
+        return sum(self.records_per_bank)
+
+    @property
+    def slowest_bank_index(self) -> int:
+        """The bank that finished last"""
+        return max(range(self.bank_count), key=lambda bank: self.runtime_results[bank].runtime)
+
+    @property
+    def slowest_bank_latency(self) -> float:
+        """The query latency (in ns), the runtime of the slowest bank"""
+        return self.runtime_results[self.slowest_bank_index].runtime
+
+    @property
+    def aggregate_throughput(self) -> float:
+        """Records processed per second across all banks"""
+        latency = self.slowest_bank_latency
+        return self.total_records / (latency * 1e-9) if latency > 0 else 0.0
+
+    def save(self, path: str):
+        """Save the multi-bank result"""
+        with open(path, 'w') as fp:
+            fp.write(f"banks: {self.bank_count}\n")
+            fp.write(f"records: {self.total_records}\n")
+            fp.write(f"slowest bank: {self.slowest_bank_index}\n")
+            fp.write(f"latency: {self.slowest_bank_latency}ns\n")
+            fp.write(f"throughput: {self.aggregate_throughput} records/s\n")
+            fp.write(f"hits: {self.simulation_result.result_count}\n")
+            for bank, (runtime, result) in enumerate(zip(self.runtime_results, self.simulation_results)):
+                fp.write(f"\tbank {bank}\t{runtime.runtime}ns\t{result.result_count} hits\n")
+            if self.simulation_result.result_record_indexes is not None:
+                fp.write(f"indices: {self.simulation_result.result_record_indexes}\n")
@@ -1,10 +1,17 @@
 import logging
 
 from src.configurations.bank_layout import BankLayoutConfiguration
-from src.hardware.bank import Bank
+from src.hardware.bank import Bank, BankSnapshot
 from src.generators.records import DatabaseRecordGenerator
 
 
+class SimulatorSnapshot:
+    """A bank simulator's state, its bank memory and any simulator state, see :func:SimulatedBank.snapshot"""
+    def __init__(self, bank: BankSnapshot, state: dict):
+        self.bank = bank
+        self.state = state
+
+
 class SimulatedBank:
     """Defines base simulation parameters for a generic DRAM Bank"""
     def __init__(
@@ -23,3 +30,30 @@ class SimulatedBank:
         Given a record generator, perform data layout in this bank
         """
         raise NotImplemented("This bank has no implementation for data layout")
+
+    def snapshot(self) -> SimulatorSnapshot:
+        """
+        Take a snapshot of the simulator, for example after layout, to restore between queries instead of resetting
+        and re-laying out the bank. Restoring only rewrites the bank rows written since, see :func:Bank.snapshot
+        """
+        return SimulatorSnapshot(self.bank_hardware.snapshot(), self._save_state())
+
+    def restore(self, snapshot: SimulatorSnapshot) -> int:
+        """Restore the simulator to a snapshot, return how many bank rows were rewritten"""
+        rows = self.bank_hardware.restore(snapshot.bank)
+        self._load_state(snapshot.state)
+        return rows
+
+    def _save_state(self) -> dict:
+        """
+        @implementable
+        Copy any simulator state besides the bank memory into a snapshot
+        """
+        return {}
+
+    def _load_state(self, state: dict):
+        """
+        @implementable
+        Restore simulator state saved by :func:_save_state
+        """
+        pass
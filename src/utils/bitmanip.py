@@ -10,28 +10,71 @@ def msb_bit(value: int, most_significant_bit_index: int, bit_width: int):
 
 def int_to_byte_array(value: int, value_byte_size: int) -> [int]:
     """Given a value, deconstruct it to a byte array with the size specified"""
-    byte_array = []
-    # Construct a byte array byte-by-byte
-    while value > 0:
-        byte = value & 0xFF
-        value >>= 8
-        byte_array.append(byte)
-    # 0-pad the value
-    byte_array += [0] * (value_byte_size - len(byte_array))
-    # Reverse the endianness
-    byte_array.reverse()
-    return byte_array
+    if 0 <= value < 1 << (8 * value_byte_size):
+        return list(value.to_bytes(value_byte_size, 'big'))
+    elif value < 0:
+        return [0] * value_byte_size
+    # Wider values keep all of their bytes
+    return list(value.to_bytes((value.bit_length() + 7) // 8, 'big'))
 
 
 def byte_array_to_int(byte_array: [int]) -> int:
     """Given a byte array, construct an integer value representing its bytes"""
+    if isinstance(byte_array, (bytes, bytearray, memoryview)):
+        return int.from_bytes(byte_array, 'big')
 
     # Ensure this is byte compliant
-    if any(byte < 0 or byte >= 256 for byte in byte_array):
+    try:
+        return int.from_bytes(bytes(byte_array), 'big')
+    except ValueError:
         raise ValueError("all values in the byte array must be byte-sized")
 
-    raw_result = 0
-    for byte in byte_array:
-        raw_result <<= 8
-        raw_result += byte
-    return raw_result
+
+def int_to_row(value: int, row_byte_size: int) -> bytearray:
+    """Given a value of at most row_byte_size bytes, deconstruct it to a mutable row of bytes, see :func:row_to_int"""
+    return bytearray(value.to_bytes(row_byte_size, 'big'))
+
+
+def row_to_int(row) -> int:
+    """
+    Given a row of bytes (a bytes, bytearray or memoryview), construct the integer value of the whole row, its first
+    byte the most significant; every element of a row can then be operated on at once as lanes of the integer
+    """
+    return int.from_bytes(row, 'big')
+
+
+def lane_mask(lane_bits: int, lane_byte_size: int, row_byte_size: int) -> int:
+    """
+    The bits of one lane repeated in every lane_byte_size lane of a row of row_byte_size bytes, the lanes dividing
+    the row evenly
+    """
+    return lane_bits * (((1 << (8 * row_byte_size)) - 1) // ((1 << (8 * lane_byte_size)) - 1))
+
+
+def _lane_masks(lane_byte_size: int, row_byte_size: int) -> (int, int):
+    """The high bit and the low bits of every lane of a row"""
+    lane_bits = 8 * lane_byte_size
+    return lane_mask(1 << (lane_bits - 1), lane_byte_size, row_byte_size), \
+        lane_mask((1 << (lane_bits - 1)) - 1, lane_byte_size, row_byte_size)
+
+
+def lanes_add(a: int, b: int, lane_byte_size: int, row_byte_size: int) -> int:
+    """Add the lanes of two rows (as from :func:row_to_int) lane by lane, dropping the carry out of every lane"""
+    high, low = _lane_masks(lane_byte_size, row_byte_size)
+    # The low bits can not carry out of their lane, the high bits are the sum of the lanes' high bits and that carry
+    return ((a & low) + (b & low)) ^ ((a ^ b) & high)
+
+
+def lanes_sub(a: int, b: int, lane_byte_size: int, row_byte_size: int) -> int:
+    """Subtract the lanes of row b from the lanes of row a lane by lane, dropping the borrow into every lane"""
+    high, low = _lane_masks(lane_byte_size, row_byte_size)
+    # Setting the high bits of a keeps the low bits from borrowing out of their lane
+    return ((a | high) - (b & low)) ^ ((a ^ b ^ high) & high)
+
+
+def lanes_zero(a: int, lane_byte_size: int, row_byte_size: int) -> int:
+    """Set every lane of a row to 1 where the lane is zero and to 0 otherwise"""
+    high, low = _lane_masks(lane_byte_size, row_byte_size)
+    # The high bit of a lane ends up set when any bit of the lane is, the low bits can not carry out of the lane
+    nonzero = (((a & low) + low) | a) & high
+    return (nonzero ^ high) >> (8 * lane_byte_size - 1)
@@ -1,19 +1,26 @@
+import threading
 from timeit import default_timer as timer
-from queue import LifoQueue
 
-_performance_trackers = LifoQueue()
+# Timers nest per thread, so simulators running on worker threads do not pop each other's trackers
+_performance_trackers = threading.local()
+
+
+def _trackers() -> list:
+    if not hasattr(_performance_trackers, "stack"):
+        _performance_trackers.stack = []
+    return _performance_trackers.stack
 
 
 def start_performance_tracking():
     """Start a performance timer"""
     tracker = timer()
-    _performance_trackers.put(tracker)
+    _trackers().append(tracker)
     return tracker
 
 
 def end_performance_tracking() -> float:
     """End a performance timer and return the difference in seconds"""
-    tracker = _performance_trackers.get()
+    tracker = _trackers().pop()
     difference = timer() - tracker
     return difference
 
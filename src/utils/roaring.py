@@ -0,0 +1,304 @@
+"""
+A Roaring bitmap of record indexes
+
+Indexes are split on their upper 16 bits into containers of up to 65536 records, each held in whichever of three
+forms is smallest: an array of its sorted lower 16 bits (sparse chunks), a 65536-bit integer (dense chunks), or a
+list of runs (near-universal or clustered chunks). Bitmaps serialize to the portable Roaring format
+(https://github.com/RoaringBitmap/RoaringFormatSpec), so results can be read back by any Roaring implementation.
+"""
+import struct
+import typing
+from array import array
+
+_CHUNK_BITS = 1 << 16
+_CHUNK_BYTES = _CHUNK_BITS // 8
+_ARRAY_MAX_CARDINALITY = 4096
+
+_ARRAY = 0
+_BITMAP = 1
+_RUN = 2
+
+_SERIAL_COOKIE_NO_RUNCONTAINER = 12346
+_SERIAL_COOKIE = 12347
+_NO_OFFSET_THRESHOLD = 4
+
+# Hitmaps hold their first record in the MSB of a byte, bitmap containers in the LSB
+_REVERSE_BITS = bytes(int(f"{value:08b}"[::-1], 2) for value in range(256))
+# The bit offsets, least significant first, of the 1-bits of every byte value
+_BYTE_BITS = tuple(tuple(b for b in range(8) if value & (1 << b)) for value in range(256))
+
+
+def _set_bits(value: int) -> typing.List[int]:
+    """The sorted positions of the 1-bits of a container integer"""
+    positions = []
+    for index, byte in enumerate(value.to_bytes(_CHUNK_BYTES + 1, 'little')):
+        if byte:
+            base = index * 8
+            positions += [base + offset for offset in _BYTE_BITS[byte]]
+    return positions
+
+
+class _Container:
+    """The records of one 65536 record chunk, in array, bitmap (integer) or run form"""
+    __slots__ = ("kind", "values", "cardinality")
+
+    def __init__(self, kind: int, values, cardinality: int):
+        self.kind = kind
+        self.values = values
+        self.cardinality = cardinality
+
+    @staticmethod
+    def from_int(value: int):
+        """Hold the 1-bits of a container integer in the smallest form, None if there are none"""
+        cardinality = value.bit_count()
+        if cardinality == 0:
+            return None
+        # Every run starts and ends with a transition between neighbouring bits
+        transitions = value ^ (value << 1)
+        runs = transitions.bit_count() // 2
+        if 2 + 4 * runs < min(2 * cardinality, _CHUNK_BYTES):
+            edges = _set_bits(transitions)
+            return _Container(_RUN, [(edges[r], edges[r + 1] - edges[r] - 1) for r in range(0, len(edges), 2)],
+                              cardinality)
+        if cardinality <= _ARRAY_MAX_CARDINALITY:
+            return _Container(_ARRAY, array('H', _set_bits(value)), cardinality)
+        return _Container(_BITMAP, value, cardinality)
+
+    @staticmethod
+    def from_sorted(values: typing.List[int]):
+        """Hold a sorted list of lower 16-bit values, None if it is empty"""
+        if not values:
+            return None
+        if len(values) <= _ARRAY_MAX_CARDINALITY:
+            return _Container(_ARRAY, array('H', values), len(values))
+        return _Container.from_int(_Container(_ARRAY, values, len(values)).to_int())
+
+    def to_int(self) -> int:
+        if self.kind == _BITMAP:
+            return self.values
+        if self.kind == _RUN:
+            value = 0
+            for start, length in self.values:
+                value |= ((1 << (length + 1)) - 1) << start
+            return value
+        bits = bytearray(_CHUNK_BYTES)
+        for low in self.values:
+            bits[low >> 3] |= 1 << (low & 7)
+        return int.from_bytes(bits, 'little')
+
+    def to_list(self) -> typing.List[int]:
+        if self.kind == _ARRAY:
+            return list(self.values)
+        if self.kind == _RUN:
+            values = []
+            for start, length in self.values:
+                values += range(start, start + length + 1)
+            return values
+        return _set_bits(self.values)
+
+    def contains(self, low: int) -> bool:
+        if self.kind == _BITMAP:
+            return bool(self.values >> low & 1)
+        if self.kind == _RUN:
+            return any(start <= low <= start + length for start, length in self.values)
+        return low in self.values
+
+
+class RoaringBitmap:
+    """A compressed, sorted set of record indexes"""
+    def __init__(self):
+        # Chunk key (upper 16 bits) to its container, only non-empty chunks are held
+        self._containers = dict()
+
+    @classmethod
+    def from_indexes(cls, indexes: typing.Iterable[int]):
+        """Build a bitmap from record indexes, in any order"""
+        chunks = dict()
+        for index in indexes:
+            chunks.setdefault(index >> 16, set()).add(index & 0xFFFF)
+        bitmap = cls()
+        for key in sorted(chunks):
+            bitmap._containers[key] = _Container.from_sorted(sorted(chunks[key]))
+        return bitmap
+
+    @classmethod
+    def from_hitmap(cls, hitmap, num_bits: int):
+        """Build a bitmap from the first num_bits records of a bytes-like hitmap, first record in the MSB"""
+        view = memoryview(hitmap).cast('B')
+        num_bits = min(num_bits, len(view) * 8)
+        bitmap = cls()
+        for key in range((num_bits + _CHUNK_BITS - 1) // _CHUNK_BITS):
+            chunk = bytes(view[key * _CHUNK_BYTES:(key + 1) * _CHUNK_BYTES]).translate(_REVERSE_BITS)
+            records = min(_CHUNK_BITS, num_bits - key * _CHUNK_BITS)
+            container = _Container.from_int(int.from_bytes(chunk, 'little') & ((1 << records) - 1))
+            if container is not None:
+                bitmap._containers[key] = container
+        return bitmap
+
+    def __len__(self):
+        return sum(container.cardinality for container in self._containers.values())
+
+    def __contains__(self, index: int):
+        container = self._containers.get(index >> 16)
+        return container is not None and container.contains(index & 0xFFFF)
+
+    def __iter__(self):
+        for key in sorted(self._containers):
+            base = key << 16
+            for low in self._containers[key].to_list():
+                yield base + low
+
+    def __eq__(self, other):
+        if not isinstance(other, RoaringBitmap):
+            return NotImplemented
+        return self._containers.keys() == other._containers.keys() and all(
+            self._containers[key].to_int() == other._containers[key].to_int() for key in self._containers)
+
+    def to_list(self) -> typing.List[int]:
+        """The sorted record indexes"""
+        return list(self)
+
+    def _combine(self, other, keys, operation):
+        result = RoaringBitmap()
+        for key in sorted(keys):
+            a = self._containers.get(key)
+            b = other._containers.get(key)
+            container = operation(a, b)
+            if container is not None:
+                result._containers[key] = container
+        return result
+
+    @staticmethod
+    def _and(a: _Container, b: _Container):
+        if a is None or b is None:
+            return None
+        # Filter the smaller array through the other container
+        if a.kind == _ARRAY or b.kind == _ARRAY:
+            small, large = (a, b) if a.kind == _ARRAY and (b.kind != _ARRAY or a.cardinality <= b.cardinality) \
+                else (b, a)
+            if large.kind == _ARRAY:
+                members = set(large.values)
+                return _Container.from_sorted([low for low in small.values if low in members])
+            large_bits = large.to_int().to_bytes(_CHUNK_BYTES + 1, 'little')
+            return _Container.from_sorted([low for low in small.values if large_bits[low >> 3] >> (low & 7) & 1])
+        return _Container.from_int(a.to_int() & b.to_int())
+
+    @staticmethod
+    def _or(a: _Container, b: _Container):
+        if a is None or b is None:
+            return a or b
+        if a.kind == _ARRAY and b.kind == _ARRAY and a.cardinality + b.cardinality <= _ARRAY_MAX_CARDINALITY:
+            return _Container.from_sorted(sorted(set(a.values).union(b.values)))
+        return _Container.from_int(a.to_int() | b.to_int())
+
+    @staticmethod
+    def _andnot(a: _Container, b: _Container):
+        if a is None or b is None:
+            return a
+        if a.kind == _ARRAY:
+            b_bits = b.to_int().to_bytes(_CHUNK_BYTES + 1, 'little')
+            return _Container.from_sorted([low for low in a.values if not b_bits[low >> 3] >> (low & 7) & 1])
+        return _Container.from_int(a.to_int() & ~b.to_int())
+
+    def __and__(self, other):
+        return self._combine(other, self._containers.keys() & other._containers.keys(), self._and)
+
+    def __or__(self, other):
+        return self._combine(other, self._containers.keys() | other._containers.keys(), self._or)
+
+    def __sub__(self, other):
+        return self._combine(other, self._containers.keys(), self._andnot)
+
+    def andnot(self, other):
+        """The records in this bitmap but not in the other"""
+        return self - other
+
+    def serialize(self) -> bytes:
+        """Serialize the bitmap in the portable Roaring format"""
+        keys = sorted(self._containers)
+        containers = [self._containers[key] for key in keys]
+        has_runs = any(container.kind == _RUN for container in containers)
+
+        if has_runs:
+            header = struct.pack("<I", _SERIAL_COOKIE | ((len(keys) - 1) << 16))
+            run_flags = bytearray((len(keys) + 7) // 8)
+            for index, container in enumerate(containers):
+                if container.kind == _RUN:
+                    run_flags[index // 8] |= 1 << (index % 8)
+            header += bytes(run_flags)
+        else:
+            header = struct.pack("<II", _SERIAL_COOKIE_NO_RUNCONTAINER, len(keys))
+        for key, container in zip(keys, containers):
+            header += struct.pack("<HH", key, container.cardinality - 1)
+
+        bodies = []
+        for container in containers:
+            if container.kind == _RUN:
+                body = struct.pack("<H", len(container.values))
+                body += b"".join(struct.pack("<HH", start, length) for start, length in container.values)
+            elif container.kind == _ARRAY:
+                body = struct.pack(f"<{container.cardinality}H", *container.values)
+            else:
+                body = container.values.to_bytes(_CHUNK_BYTES, 'little')
+            bodies.append(body)
+
+        if not has_runs or len(keys) >= _NO_OFFSET_THRESHOLD:
+            offset = len(header) + 4 * len(keys)
+            offsets = b""
+            for body in bodies:
+                offsets += struct.pack("<I", offset)
+                offset += len(body)
+            header += offsets
+        return header + b"".join(bodies)
+
+    @classmethod
+    def deserialize(cls, data: bytes):
+        """Read a bitmap serialized in the portable Roaring format"""
+        view = memoryview(data)
+        cookie, = struct.unpack_from("<I", view, 0)
+        position = 4
+        run_flags = None
+        if cookie & 0xFFFF == _SERIAL_COOKIE:
+            size = (cookie >> 16) + 1
+            run_flags = bytes(view[position:position + (size + 7) // 8])
+            position += (size + 7) // 8
+        elif cookie == _SERIAL_COOKIE_NO_RUNCONTAINER:
+            size, = struct.unpack_from("<I", view, position)
+            position += 4
+        else:
+            raise ValueError("not a serialized Roaring bitmap")
+
+        descriptions = [struct.unpack_from("<HH", view, position + 4 * index) for index in range(size)]
+        position += 4 * size
+        if run_flags is None or size >= _NO_OFFSET_THRESHOLD:
+            position += 4 * size
+
+        bitmap = cls()
+        for index, (key, cardinality) in enumerate(descriptions):
+            cardinality += 1
+            if run_flags is not None and run_flags[index // 8] >> (index % 8) & 1:
+                runs, = struct.unpack_from("<H", view, position)
+                values = [struct.unpack_from("<HH", view, position + 2 + 4 * run) for run in range(runs)]
+                container = _Container(_RUN, values, cardinality)
+                position += 2 + 4 * runs
+            elif cardinality <= _ARRAY_MAX_CARDINALITY:
+                container = _Container(_ARRAY, array('H', struct.unpack_from(f"<{cardinality}H", view, position)),
+                                       cardinality)
+                position += 2 * cardinality
+            else:
+                container = _Container(_BITMAP, int.from_bytes(view[position:position + _CHUNK_BYTES], 'little'),
+                                       cardinality)
+                position += _CHUNK_BYTES
+            bitmap._containers[key] = container
+        return bitmap
+
+    def save(self, path: str):
+        """Save the bitmap in the portable Roaring format"""
+        with open(path, 'wb') as fp:
+            fp.write(self.serialize())
+
+    @classmethod
+    def load(cls, path: str):
+        """Load a bitmap saved in the portable Roaring format"""
+        with open(path, 'rb') as fp:
+            return cls.deserialize(fp.read())
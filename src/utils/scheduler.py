@@ -0,0 +1,67 @@
+import collections
+import os
+import threading
+
+
+class WorkStealingPool:
+    """
+    A fixed set of worker threads, each owning a deque of tasks. Workers take their own tasks from the front and,
+    once empty, steal from the back of another worker's deque, so uneven tasks (banks with more records, slower
+    queries) keep every worker busy until the whole batch is done.
+
+    @param workers: The number of worker threads, defaults to the number of processors
+    """
+    def __init__(self, workers: int=None):
+        self.workers = max(1, workers or os.cpu_count() or 1)
+
+    def map(self, function, items) -> list:
+        """Apply function to every item, return the results in item order; the first task exception is re-raised"""
+        items = list(items)
+        if not items:
+            return []
+        results = [None] * len(items)
+        errors = []
+
+        worker_count = min(self.workers, len(items))
+        queues = [collections.deque() for _ in range(worker_count)]
+        for index, item in enumerate(items):
+            queues[index % worker_count].append((index, item))
+
+        def next_task(worker: int):
+            try:
+                return queues[worker].popleft()
+            except IndexError:
+                pass
+            # Steal starting from the next worker rather than in a random order, so the pool never draws from the
+            # global random state seeded data generators share
+            for offset in range(1, worker_count):
+                victim = (worker + offset) % worker_count
+                try:
+                    return queues[victim].pop()
+                except IndexError:
+                    continue
+            return None
+
+        def work(worker: int):
+            while not errors:
+                task = next_task(worker)
+                if task is None:
+                    return
+                index, item = task
+                try:
+                    results[index] = function(item)
+                except BaseException as e:
+                    errors.append(e)
+
+        if worker_count == 1:
+            work(0)
+        else:
+            threads = [threading.Thread(target=work, args=(worker,)) for worker in range(worker_count)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+
+        if errors:
+            raise errors[0]
+        return results
@@ -0,0 +1,92 @@
+import logging
+import math
+import os
+
+from src.configurations.bank_layout import AmbitBankLayoutConfiguration
+from src.generators.records import IncrementalKeyRandomDataRecordGenerator
+from src.hardware.bank import AmbitBank
+from src.simulators.ambit import SimulatedAmbitBank
+
+from src.queries.ambit_range import AmbitLessThan
+from src.queries.blimp_range import BlimpLessThan
+from src.queries.blimpv_range import BlimpVLessThan
+from src.queries.blimpv_aggregate import BlimpVCount, BlimpVSum, BlimpVMin, BlimpVMax
+
+logging.basicConfig(level=logging.INFO)
+study_name = input("Enter the study name: ")
+study_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), study_name)
+
+if not os.path.exists(study_dir):
+    print("no study found; use the setup script to generate one first")
+    exit()
+
+print("Reading configuration file")
+configuration = AmbitBankLayoutConfiguration.load(os.path.join(study_dir, "configuration.json"))
+configuration.display()
+print("Configuration loaded")
+
+# EDIT BENCHMARK PARAMETERS HERE PRIOR TO THE RUN
+selectivities = [0.001, 0.01, 0.1, 0.5, 1.0]
+field_offset_bytes = configuration.database_configuration.total_index_size_bytes  # the first data bytes
+field_size_bytes = min(8, configuration.hardware_configuration.blimpv_sew_max_bytes)
+
+# Keys count up from zero, so PI/Key < threshold selects the first threshold records
+print("generating database and bank layout")
+records = configuration.total_records_processable
+database = IncrementalKeyRandomDataRecordGenerator(
+    configuration.database_configuration.total_index_size_bytes,
+    configuration.database_configuration.total_record_size_bytes,
+    records
+)
+simulator = SimulatedAmbitBank(configuration, AmbitBank(configuration.hardware_configuration))
+simulator.layout(database)
+
+selection_map = {
+    "blimp_less_than": BlimpLessThan,
+    "blimp_v_less_than": BlimpVLessThan,
+    "ambit_less_than": AmbitLessThan,
+}
+aggregate_map = {
+    "blimp_v_count": BlimpVCount,
+    "blimp_v_sum": BlimpVSum,
+    "blimp_v_min": BlimpVMin,
+    "blimp_v_max": BlimpVMax,
+}
+
+# Every selection query fills the same hitmap, the aggregates then reduce the field over the last one's hits
+print("Simulator loaded, starting queries")
+results = {}
+for selectivity in selectivities:
+    threshold = min(records, math.ceil(selectivity * records))
+    for query in selection_map:
+        print(f"performing {query} at selectivity {selectivity}")
+        simulator.reset_all_hitmaps()
+        runtime_result, simulation_result = selection_map[query](simulator).perform_operation(
+            pi_subindex_offset_bytes=0,
+            pi_element_size_bytes=configuration.database_configuration.total_index_size_bytes,
+            value=threshold,
+            hitmap_index=0
+        )
+        print(f"query simulated runtime was: {runtime_result.runtime}")
+        print(f"query simulated hits was: {simulation_result.result_count}")
+        results[f"{selectivity}_{query}"] = runtime_result.runtime
+
+    for query in aggregate_map:
+        print(f"performing {query} at selectivity {selectivity}")
+        if query == "blimp_v_count":
+            runtime_result, aggregate_result = aggregate_map[query](simulator).perform_operation(hitmap_index=0)
+        else:
+            runtime_result, aggregate_result = aggregate_map[query](simulator).perform_operation(
+                field_offset_bytes=field_offset_bytes,
+                field_size_bytes=field_size_bytes,
+                hitmap_index=0
+            )
+        print(f"query simulated runtime was: {runtime_result.runtime}")
+        print(f"query simulated value was: {aggregate_result.value} over {aggregate_result.result_count} hits")
+        results[f"{selectivity}_{query}"] = runtime_result.runtime
+
+print("Saving benchmark results")
+with open(os.path.join(study_dir, "aggregate_result.tsv"), 'w') as fp:
+    for k, v in results.items():
+        fp.write(f"{k}\t{v}\n")
+print("done")
@@ -0,0 +1,293 @@
+"""
+Non-interactive, parallel study runner; the batch counterpart of simulate.py and collect_results.py
+
+Every study's database is generated and laid out once into a content-addressed layout cache (see
+src/simulators/layout_cache.py), shared by every study whose configuration only differs in compute or timing
+parameters, such as the _quarter_alus variants; after which each (study, query, case) job is simulated in its own
+process, on the cached bank image mapped copy-on-write. Results are streamed, as jobs finish, into one TSV with a
+column per result field, and every job also saves its runtime.sim and result.sim files into its study as
+simulate.py does, so collect_results.py keeps working.
+
+Studies can be derived from existing ones with --grid, every combination of the values given becoming its own
+study directory next to the base study; on a cluster, --shard splits the job list so every node runs its own part
+into its own results file, and a --cache on shared storage lets nodes reuse each other's layouts.
+
+    python studies/equal_runtime/batch.py 32mb_1kb_bank_8B_512B_record --workers 8
+    python studies/equal_runtime/batch.py 32mb_1kb_bank_8B_512B_record \
+        --grid row_buffer_size_bytes=1024,2048,4096 number_of_vALUs=8,32 --queries blimp_equal ambit_equal
+    python studies/equal_runtime/batch.py --all --shard 2/4 --output nightly_2.tsv
+"""
+import argparse
+import concurrent.futures
+import itertools
+import json
+import logging
+import os
+import random
+
+from src.configurations.bank_layout import AmbitBankLayoutConfiguration
+from src.configurations.database import AmbitDatabaseConfiguration
+from src.configurations.hardware import AmbitHardwareConfiguration
+from src.generators.records import ConstantKeyRandomDataRecordGenerator
+from src.hardware.bank import AmbitBank
+from src.simulators.ambit import SimulatedAmbitBank
+from src.simulators.layout_cache import LayoutCache
+from src.simulators.result import RuntimeResult
+
+from src.queries.ambit_equality import AmbitEqual, AmbitNotEqual
+from src.queries.blimp_equality import BlimpEqual, BlimpNotEqual
+from src.queries.blimpv_equality import BlimpVEqual, BlimpVNotEqual
+from src.queries.blimpv_et_equality import BlimpVETEqual, BlimpVETNotEqual
+from src.queries.ambit_et_equality import AmbitETEqual, AmbitETNotEqual
+
+STUDIES_DIR = os.path.dirname(os.path.abspath(__file__))
+
+QUERY_MAP = {
+    "ambit_equal": AmbitEqual,
+    "ambit_not_equal": AmbitNotEqual,
+    "blimp_equal": BlimpEqual,
+    "blimp_not_equal": BlimpNotEqual,
+    "blimp_v_equal": BlimpVEqual,
+    "blimp_v_not_equal": BlimpVNotEqual,
+    "blimp_v_et_equal": BlimpVETEqual,
+    "blimp_v_et_not_equal": BlimpVETNotEqual,
+    "ambit_et_equal": AmbitETEqual,
+    "ambit_et_not_equal": AmbitETNotEqual,
+}
+CASES = ["best_case", "worst_case"]
+
+COUNTERS = [
+    RuntimeResult.ROW_ACTIVATE,
+    RuntimeResult.PRECHARGE,
+    RuntimeResult.COLUMN_ACCESS,
+    RuntimeResult.V0_TRANSFER,
+    RuntimeResult.BLIMP_CYCLE,
+    RuntimeResult.TRA,
+    RuntimeResult.AAP,
+]
+COLUMNS = [
+    "study", "query", "case", "row_buffer_size_bytes", "total_record_size_bytes", "number_of_vALUs", "records",
+    "runtime_ns", "hits",
+] + COUNTERS
+
+
+def study_path(study: str) -> str:
+    """A study directory by its name under this directory, or by path"""
+    return study if os.path.isabs(study) or os.path.sep in study else os.path.join(STUDIES_DIR, study)
+
+
+def all_studies() -> list:
+    """Every study directory under this directory with a configuration"""
+    return sorted(
+        name for name in os.listdir(STUDIES_DIR)
+        if os.path.exists(os.path.join(STUDIES_DIR, name, "configuration.json"))
+    )
+
+
+def parse_grid(grid: list) -> list:
+    """Parse key=value,value,... grid parameters into (key, [values]) pairs"""
+    parameters = []
+    for parameter in grid:
+        key, _, values = parameter.partition("=")
+        if not key or not values:
+            raise ValueError(f"grid parameter {parameter} is not of the form key=value,value,...")
+        parameters.append((key, [parse_value(value) for value in values.split(",")]))
+    return parameters
+
+
+def parse_value(value: str):
+    """A grid value as the integer, float or string it reads as"""
+    for kind in (int, float):
+        try:
+            return kind(value)
+        except ValueError:
+            continue
+    return value
+
+
+def derive_studies(base_study: str, grid: list) -> list:
+    """
+    Create (or update) a study directory for every combination of grid values around a base study, return their
+    paths; combinations that do not fit a layout are skipped
+    """
+    base = AmbitBankLayoutConfiguration.load(os.path.join(study_path(base_study), "configuration.json"))
+    hardware_fields = base.hardware_configuration.dict()
+    database_fields = base.database_configuration.dict()
+    for key, _ in grid:
+        if key not in hardware_fields and key not in database_fields:
+            raise ValueError(f"{key} is neither a hardware nor a database configuration parameter")
+
+    studies = []
+    for values in itertools.product(*(values for _, values in grid)):
+        hardware = dict(hardware_fields)
+        database = dict(database_fields)
+        for (key, _), value in zip(grid, values):
+            (hardware if key in hardware else database)[key] = value
+        try:
+            configuration = AmbitBankLayoutConfiguration(AmbitHardwareConfiguration(**hardware),
+                                                         AmbitDatabaseConfiguration(**database))
+        except ValueError as e:
+            logging.warning(f"skipping {dict(zip((key for key, _ in grid), values))}: {e}")
+            continue
+
+        # Derived studies sit next to their base study, named after it and their grid values
+        path = os.path.normpath(study_path(base_study)) + "".join(
+            f"_{key}_{value}" for (key, _), value in zip(grid, values)
+        )
+        os.makedirs(path, exist_ok=True)
+
+        # Only rewrite changed configurations, a rewrite invalidates the cached bank and database
+        configuration_path = os.path.join(path, "configuration.json")
+        if os.path.exists(configuration_path):
+            with open(configuration_path, "r") as fp:
+                saved = json.load(fp)
+            unchanged = saved["hardware"] == configuration.hardware_configuration.dict() and \
+                saved["database"] == configuration.database_configuration.dict()
+        else:
+            unchanged = False
+        if not unchanged:
+            configuration.save(configuration_path)
+        studies.append(path)
+    return studies
+
+
+def records_key(seed: int) -> str:
+    """The layout cache name of the record set every study lays out"""
+    return f"ConstantKeyRandomDataRecordGenerator(constant=0x0, seed={seed})"
+
+
+def prepare_layout(path: str, cache_directory: str, regenerate: bool, seed: int) -> str:
+    """Generate and lay out a study's database into the layout cache unless it is there already, return its key"""
+    configuration = AmbitBankLayoutConfiguration.load(os.path.join(path, "configuration.json"))
+
+    def records():
+        if seed is not None:
+            random.seed(seed)
+        return ConstantKeyRandomDataRecordGenerator(
+            configuration.database_configuration.total_index_size_bytes,
+            configuration.database_configuration.total_record_size_bytes,
+            0x0
+        )
+
+    return LayoutCache(cache_directory).prepare(
+        configuration, records, records_key(seed), SimulatedAmbitBank, AmbitBank, regenerate
+    )
+
+
+# The simulator of the last study a worker process ran a job of, with a snapshot of its freshly reset state; jobs
+# are handed out study by study, so workers mostly keep their bank mapped between jobs and only restore the rows
+# the previous query wrote
+_loaded = {}
+
+
+def load_simulator(path: str, cache_directory: str, key: str) -> SimulatedAmbitBank:
+    if path not in _loaded:
+        _loaded.clear()
+        configuration = AmbitBankLayoutConfiguration.load(os.path.join(path, "configuration.json"))
+        bank = LayoutCache(cache_directory).bank(key, configuration.hardware_configuration, AmbitBank)
+        simulator = SimulatedAmbitBank(configuration, bank)
+        simulator.reset_all_hitmaps()
+        _loaded[path] = simulator, simulator.snapshot()
+    else:
+        simulator, snapshot = _loaded[path]
+        simulator.restore(snapshot)
+    return _loaded[path][0]
+
+
+def run_job(job: tuple) -> dict:
+    """Simulate one query case on a study's bank, save its result files into the study and return its result row"""
+    path, cache_directory, key, query, case = job
+    simulator = load_simulator(path, cache_directory, key)
+    configuration = simulator.configuration
+    index_size_bytes = configuration.database_configuration.total_index_size_bytes
+
+    runtime_result, simulation_result = QUERY_MAP[query](simulator).perform_operation(
+        pi_subindex_offset_bytes=0,
+        pi_element_size_bytes=index_size_bytes,
+        value=2 ** (index_size_bytes * 8) - 1 if case == "best_case" else 0,
+        return_labels=False,
+        hitmap_index=0
+    )
+    runtime_result.save(os.path.join(path, f"{case}_{query}.runtime.sim"))
+    simulation_result.save(os.path.join(path, f"{case}_{query}.result.sim"))
+
+    row = {
+        "study": os.path.basename(os.path.normpath(path)),
+        "query": query,
+        "case": case,
+        "row_buffer_size_bytes": configuration.hardware_configuration.row_buffer_size_bytes,
+        "total_record_size_bytes": configuration.database_configuration.total_record_size_bytes,
+        "number_of_vALUs": configuration.hardware_configuration.number_of_vALUs,
+        "records": configuration.total_records_processable,
+        "runtime_ns": runtime_result.runtime,
+        "hits": simulation_result.result_count,
+    }
+    row.update({counter: runtime_result.count(counter) for counter in COUNTERS})
+    return row
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Run equality studies in parallel, without prompting")
+    parser.add_argument("studies", nargs="*", help="study names under this directory, or study paths")
+    parser.add_argument("--all", action="store_true", help="run every study under this directory")
+    parser.add_argument("--grid", nargs="+", default=[], metavar="KEY=VALUES",
+                        help="derive a study for every combination of these comma separated configuration values")
+    parser.add_argument("--queries", nargs="+", default=list(QUERY_MAP), choices=list(QUERY_MAP))
+    parser.add_argument("--cases", nargs="+", default=CASES, choices=CASES)
+    parser.add_argument("--workers", type=int, default=None, help="worker processes, defaults to the processors")
+    parser.add_argument("--shard", default="0/1", metavar="INDEX/COUNT",
+                        help="only run every COUNT-th job starting at INDEX, to split the jobs over nodes")
+    parser.add_argument("--cache", default=os.path.join(STUDIES_DIR, "layout_cache"),
+                        help="the layout cache directory, shared by every run")
+    parser.add_argument("--regenerate", action="store_true", help="regenerate every database and bank layout")
+    parser.add_argument("--seed", type=int, default=None, help="seed the database generation of every study")
+    parser.add_argument("--output", default=os.path.join(STUDIES_DIR, "equal_batch_result.tsv"),
+                        help="the results file, rewritten by every run")
+    arguments = parser.parse_args(argv)
+
+    logging.basicConfig(level=logging.INFO)
+    shard_index, _, shard_count = arguments.shard.partition("/")
+    shard_index, shard_count = int(shard_index), int(shard_count or 1)
+    if not 0 <= shard_index < shard_count:
+        parser.error(f"shard {arguments.shard} is not of the form INDEX/COUNT with 0 <= INDEX < COUNT")
+
+    studies = arguments.studies or (all_studies() if arguments.all else [])
+    if not studies:
+        parser.error("no studies given; name them or use --all")
+    paths = []
+    for study in studies:
+        if not os.path.exists(os.path.join(study_path(study), "configuration.json")):
+            parser.error(f"no study found at {study_path(study)}; use the setup script to generate one first")
+        paths += derive_studies(study, parse_grid(arguments.grid)) if arguments.grid else [study_path(study)]
+
+    jobs = list(itertools.product(paths, arguments.queries, arguments.cases))[shard_index::shard_count]
+    paths = sorted({path for path, _, _ in jobs}, key=paths.index)
+
+    # Studies sharing a layout share a cache entry; lay each entry out once, from the first study using it
+    cache = LayoutCache(arguments.cache)
+    keys = {}
+    for path in paths:
+        configuration = AmbitBankLayoutConfiguration.load(os.path.join(path, "configuration.json"))
+        keys[path] = cache.key(configuration, records_key(arguments.seed), SimulatedAmbitBank)
+    layouts = {key: path for path, key in reversed(keys.items())}
+    logging.info(f"running {len(jobs)} jobs over {len(paths)} studies sharing {len(layouts)} layouts")
+
+    with concurrent.futures.ProcessPoolExecutor(max_workers=arguments.workers) as pool:
+        list(pool.map(prepare_layout, layouts.values(), itertools.repeat(arguments.cache),
+                      itertools.repeat(arguments.regenerate), itertools.repeat(arguments.seed)))
+
+        jobs = [(path, arguments.cache, keys[path], query, case) for path, query, case in jobs]
+        with open(arguments.output, "w") as fp:
+            fp.write("\t".join(COLUMNS) + "\n")
+            fp.flush()
+            for future in concurrent.futures.as_completed([pool.submit(run_job, job) for job in jobs]):
+                row = future.result()
+                fp.write("\t".join(str(row[column]) for column in COLUMNS) + "\n")
+                fp.flush()
+                logging.info(f"{row['study']} {row['case']} {row['query']}: {row['runtime_ns']}ns, "
+                             f"{row['hits']} hits")
+    logging.info(f"results saved to {arguments.output}")
+
+
+if __name__ == "__main__":
+    main()
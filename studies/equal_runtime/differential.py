@@ -0,0 +1,159 @@
+"""
+Differential compliance runner; checks a simulator query against the native equality kernel on the same bank
+
+A study's bank is laid out once into the layout cache, as batch.py does, then the native kernel
+(compliance/blimp_equality) scans the cached bank image into a bank image of its own while the chosen simulator query
+runs on the cached image mapped copy-on-write. The two hitmaps are compared in memory, a popcount of the XOR of every
+pair of words counting the records they disagree on, natively when the bank engine is built (compliance/native) so
+multi-GB banks compare in seconds. The records the hitmaps disagree on are reported, the first of them by index, and
+the run exits with a non-zero status on any mismatch, so it can gate simulator changes on full size banks.
+
+Build the native kernel first, next to its source where this runner looks for it:
+    g++ -O3 -march=native -pthread -o compliance/blimp_equality/blimp_equality \
+        compliance/blimp_equality/blimp_equality.cpp
+
+    python studies/equal_runtime/differential.py 32mb_1kb_bank_8B_512B_record
+    python studies/equal_runtime/differential.py 32mb_1kb_bank_8B_512B_record --query blimp_v_not_equal \
+        --case worst_case --threads 0 --mismatches 20
+"""
+import argparse
+import logging
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+from src.configurations.bank_layout import AmbitBankLayoutConfiguration
+from src.hardware import native
+from src.hardware.bank import AmbitBank
+from src.simulators.layout_cache import LayoutCache
+from src.utils import performance
+
+from batch import QUERY_MAP, CASES, STUDIES_DIR, study_path, records_key, prepare_layout, load_simulator
+
+NATIVE_KERNEL = os.path.join(STUDIES_DIR, "..", "..", "compliance", "blimp_equality", "blimp_equality")
+
+
+def case_value(case: str, index_size_bytes: int) -> int:
+    """The value a case compares every PI/Key against, as batch.py runs it"""
+    return 2 ** (index_size_bytes * 8) - 1 if case == "best_case" else 0
+
+
+def diff_hitmaps(hitmap_a, hitmap_b, num_bits: int, limit: int) -> (int, list):
+    """
+    Compare the first num_bits records of two hitmap buffers, return how many records differ and the first limit
+    differing record indexes
+    """
+    compared = native.diff_hitmaps(hitmap_a, hitmap_b, num_bits, limit)
+    if compared is not None:
+        return compared
+
+    # Compare a chunk of words at a time as Python integers, peeling the first mismatches off the difference
+    view_a, view_b = memoryview(hitmap_a).cast('B'), memoryview(hitmap_b).cast('B')
+    num_bits = min(num_bits, len(view_a) * 8, len(view_b) * 8)
+    chunk_bytes = 1 << 20
+    differing, mismatches = 0, []
+    for start in range(0, (num_bits + 7) // 8, chunk_bytes):
+        end = min(start + chunk_bytes, (num_bits + 7) // 8)
+        difference = int.from_bytes(view_a[start:end], 'big') ^ int.from_bytes(view_b[start:end], 'big')
+        chunk_bits = min(num_bits - start * 8, (end - start) * 8)
+        difference >>= (end - start) * 8 - chunk_bits
+        if not difference:
+            continue
+        differing += difference.bit_count()
+        while difference and len(mismatches) < limit:
+            bit = difference.bit_length() - 1
+            mismatches.append(start * 8 + chunk_bits - 1 - bit)
+            difference ^= 1 << bit
+    return differing, mismatches
+
+
+def run_native(kernel: str, configuration_path: str, image_path: str, output_image_path: str, value: int,
+               index_size_bytes: int, negate: bool, threads: int):
+    """Scan a bank image with the native equality kernel into hitmap 0, saving the bank after the scan"""
+    command = [
+        kernel, configuration_path,
+        "--image", image_path,
+        "--output-image", output_image_path,
+        "--no-dump",
+        "--value", f"{value:0{2 * index_size_bytes}x}",
+        "--hitmap", "0",
+        "--threads", str(threads),
+    ] + (["--negate"] if negate else [])
+    completed = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    if completed.returncode != 0:
+        raise RuntimeError(f"the native kernel failed: {completed.stderr.strip()}")
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Compare a simulator query's hitmap against the native kernel's")
+    parser.add_argument("study", help="a study name under this directory, or a study path")
+    parser.add_argument("--query", default="blimp_equal", choices=list(QUERY_MAP))
+    parser.add_argument("--case", default="best_case", choices=CASES)
+    parser.add_argument("--kernel", default=NATIVE_KERNEL, help="the native equality kernel binary")
+    parser.add_argument("--threads", type=int, default=1, help="native scan threads, 0 uses every hardware thread")
+    parser.add_argument("--mismatches", type=int, default=10, help="how many mismatching records to report")
+    parser.add_argument("--cache", default=os.path.join(STUDIES_DIR, "layout_cache"),
+                        help="the layout cache directory, shared with batch.py")
+    parser.add_argument("--regenerate", action="store_true", help="regenerate the database and bank layout")
+    parser.add_argument("--seed", type=int, default=None, help="seed the database generation")
+    arguments = parser.parse_args(argv)
+
+    logging.basicConfig(level=logging.INFO)
+    path = study_path(arguments.study)
+    configuration_path = os.path.join(path, "configuration.json")
+    if not os.path.exists(configuration_path):
+        parser.error(f"no study found at {path}; use the setup script to generate one first")
+    if not os.path.exists(arguments.kernel):
+        parser.error(f"no native kernel found at {arguments.kernel}; build compliance/blimp_equality first")
+
+    key = prepare_layout(path, arguments.cache, arguments.regenerate, arguments.seed)
+    configuration = AmbitBankLayoutConfiguration.load(configuration_path)
+    index_size_bytes = configuration.database_configuration.total_index_size_bytes
+    value = case_value(arguments.case, index_size_bytes)
+    negate = arguments.query.endswith("not_equal")
+
+    # Both sides scan the cached bank image; the native kernel writes its bank out next to the cache entry
+    with tempfile.TemporaryDirectory(dir=arguments.cache) as directory:
+        native_image_path = os.path.join(directory, "native.memdump")
+        performance.start_performance_tracking()
+        run_native(arguments.kernel, configuration_path, LayoutCache(arguments.cache).image_path(key),
+                   native_image_path, value, index_size_bytes, negate, arguments.threads)
+        logging.info(f"native kernel finished in {performance.end_performance_tracking()}s")
+
+        performance.start_performance_tracking()
+        simulator = load_simulator(path, arguments.cache, key)
+        _, simulation_result = QUERY_MAP[arguments.query](simulator).perform_operation(
+            pi_subindex_offset_bytes=0,
+            pi_element_size_bytes=index_size_bytes,
+            value=value,
+            return_labels=False,
+            hitmap_index=0
+        )
+        logging.info(f"{arguments.query} finished in {performance.end_performance_tracking()}s")
+
+        # Compare the hitmap rows holding records, in place in both banks
+        performance.start_performance_tracking()
+        native_bank = AmbitBank.map(native_image_path, configuration.hardware_configuration)
+        records = configuration.total_records_processable
+        first_row = configuration.address_mapping["hitmaps"][0]
+        rows = int(math.ceil(records / (8 * configuration.hardware_configuration.row_buffer_size_bytes)))
+        differing, mismatches = diff_hitmaps(
+            simulator.bank_hardware.get_rows_view(first_row, rows),
+            native_bank.get_rows_view(first_row, rows),
+            records,
+            arguments.mismatches
+        )
+        logging.info(f"hitmaps compared in {performance.end_performance_tracking()}s")
+        del native_bank
+
+    print(f"{os.path.basename(os.path.normpath(path))} {arguments.case} {arguments.query}: {records} records, "
+          f"{simulation_result.result_count} simulated hits, {differing} mismatching records")
+    if differing:
+        print(f"first mismatching records: {', '.join(str(index) for index in mismatches)}")
+    return 1 if differing else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
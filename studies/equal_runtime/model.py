@@ -0,0 +1,64 @@
+import os
+
+from src.configurations.bank_layout import AmbitBankLayoutConfiguration
+from src.simulators.cost_model import QueryCostModel
+
+from src.queries.ambit_equality import AmbitEqual, AmbitNotEqual
+from src.queries.blimp_equality import BlimpEqual, BlimpNotEqual
+from src.queries.blimpv_equality import BlimpVEqual, BlimpVNotEqual
+from src.queries.blimpv_et_equality import BlimpVETEqual, BlimpVETNotEqual
+from src.queries.ambit_et_equality import AmbitETEqual, AmbitETNotEqual
+
+study_name = input("Enter the study name: ")
+study_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), study_name)
+
+if not os.path.exists(study_dir):
+    print("no study found; use the setup script to generate one first")
+    exit()
+
+print("Reading configuration file")
+configuration = AmbitBankLayoutConfiguration.load(os.path.join(study_dir, "configuration.json"))
+model = QueryCostModel(configuration)
+
+query_map = {
+    "ambit_equal": AmbitEqual,
+    "ambit_not_equal": AmbitNotEqual,
+    "blimp_equal": BlimpEqual,
+    "blimp_not_equal": BlimpNotEqual,
+    "blimp_v_equal": BlimpVEqual,
+    "blimp_v_not_equal": BlimpVNotEqual,
+    "blimp_v_et_equal": BlimpVETEqual,
+    "blimp_v_et_not_equal": BlimpVETNotEqual,
+    "ambit_et_equal": AmbitETEqual,
+    "ambit_et_not_equal": AmbitETNotEqual,
+}
+
+# The simulate script's best case looks up an all-ones value no key has, so every hitmap row of an ET query empties
+# after its first bit; its worst case looks up the key every record has, so no row terminates early
+print("Modeling queries")
+model_results = {}
+for query in query_map:
+    for case in ["best_case", "worst_case"]:
+        runtime_result = model.estimate(
+            query_map[query],
+            pi_element_size_bytes=configuration.database_configuration.total_index_size_bytes,
+            early_termination_bit=1 if case == "best_case" else None
+        )
+        model_results[f"{case}_{query}"] = runtime_result.runtime
+
+# Validate against the functional simulation, if the study has been simulated
+result_tsv_file = os.path.join(study_dir, "equal_result.tsv")
+if os.path.exists(result_tsv_file):
+    print("Validating against equal_result.tsv")
+    with open(result_tsv_file, "r") as fp:
+        for line in fp:
+            key, simulated = line.strip().split("\t")
+            simulated = float(simulated)
+            error = abs(model_results[key] - simulated) / simulated if simulated else abs(model_results[key])
+            print(f"    {key:<32} simulated {simulated:>20.3f} modeled {model_results[key]:>20.3f} error {error:.3e}")
+
+print("Saving model results")
+with open(os.path.join(study_dir, "equal_model.tsv"), 'w') as fp:
+    for k, v in model_results.items():
+        fp.write(f"{k}\t{v}\n")
+print("done")
@@ -79,6 +79,9 @@ if overwrite_memdump or overwrite_database:
     print("saving bank memory")
     bank.save(os.path.join(study_dir, "bank.memdump"))
 
+# Every query starts from this state, only the rows a query writes are rewritten between queries
+snapshot = simulator.snapshot()
+
 print("Simulator loaded, starting queries")
 query_map = {
     "ambit_equal": AmbitEqual,
@@ -142,7 +145,7 @@ for query in query_map:
             simulation_result.save(query_sim_result_directory)
 
             print(f"cleaning up")
-            simulator.reset_all_hitmaps()
+            simulator.restore(snapshot)
 
         else:
             print(f"skipping {case} {query}")
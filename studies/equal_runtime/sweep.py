@@ -0,0 +1,61 @@
+import itertools
+import os
+import time
+
+from src.configurations.bank_layout import AmbitBankLayoutConfiguration
+from src.configurations.database import AmbitDatabaseConfiguration
+from src.configurations.hardware import AmbitHardwareConfiguration
+from src.simulators.cost_model import sweep
+
+from src.queries.ambit_equality import AmbitEqual
+from src.queries.blimp_equality import BlimpEqual
+from src.queries.blimpv_equality import BlimpVEqual
+from src.queries.blimpv_et_equality import BlimpVETEqual
+from src.queries.ambit_et_equality import AmbitETEqual
+
+study_name = input("Enter the study name to sweep around: ")
+study_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), study_name)
+
+if not os.path.exists(study_dir):
+    print("no study found; use the setup script to generate one first")
+    exit()
+
+print("Reading configuration file")
+base = AmbitBankLayoutConfiguration.load(os.path.join(study_dir, "configuration.json"))
+
+# EDIT SWEEP PARAMETERS HERE PRIOR TO SWEEP RUN
+row_buffer_sizes = [2 ** p for p in range(9, 16)]
+record_sizes = [2 ** p for p in range(3, 13)]
+valu_counts = [2 ** p for p in range(0, 9)]
+queries = [BlimpEqual, BlimpVEqual, BlimpVETEqual, AmbitEqual, AmbitETEqual]
+
+
+def configurations():
+    for row_buffer_size, record_size, valus in itertools.product(row_buffer_sizes, record_sizes, valu_counts):
+        hardware = base.hardware_configuration.dict()
+        hardware.update(row_buffer_size_bytes=row_buffer_size, number_of_vALUs=valus)
+        database = base.database_configuration.dict()
+        database.update(total_record_size_bytes=record_size)
+        try:
+            yield AmbitBankLayoutConfiguration(AmbitHardwareConfiguration(**hardware),
+                                               AmbitDatabaseConfiguration(**database))
+        except ValueError:
+            # This point does not fit a layout, skip it
+            continue
+
+
+print("Sweeping")
+start = time.time()
+points = 0
+with open(os.path.join(study_dir, "equal_sweep.tsv"), 'w') as fp:
+    fp.write("row_buffer_size_bytes\ttotal_record_size_bytes\tnumber_of_vALUs\tquery\trecords\tworst_case_runtime\n")
+    for configuration, query, runtime_result in sweep(configurations(), queries):
+        fp.write(f"{configuration.hardware_configuration.row_buffer_size_bytes}\t"
+                 f"{configuration.database_configuration.total_record_size_bytes}\t"
+                 f"{configuration.hardware_configuration.number_of_vALUs}\t"
+                 f"{query.__name__}\t"
+                 f"{configuration.total_records_processable}\t"
+                 f"{runtime_result.runtime}\n")
+        points += 1
+print(f"modeled {points} points in {time.time() - start:.2f}s")
+print("done")